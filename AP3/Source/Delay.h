@@ -8,6 +8,7 @@
 */
 
 #pragma once
+#include <vector>
 
 class Delay
 {
@@ -54,13 +55,10 @@ public:
 	void setSize(int sizeInSamples)
 	{
 		size = sizeInSamples;
-		buffer = new float[size];
-
-		// initialise all values to zero
-		for (int i = 0; i < size; i++)
-		{
-			buffer[i] = 0.0;
-		}
+		memory.assign(size, 0.0f);	// the memory is reused if it is already big enough
+		buffer = memory.data();
+		readPos = 0;
+		writePos = 0;
 	}
 
 	void setDelayTime(int _delayTimeInSamples) //set the delay time in samples
@@ -79,8 +77,9 @@ public:
 	}
 
 private:
-	float* buffer;
-	int size;
+	std::vector<float> memory;
+	float* buffer = nullptr;
+	int size = 0;
 
 	int readPos = 0;
 	int writePos = 0;
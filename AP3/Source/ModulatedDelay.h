@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    ModulatedDelay.h
+
+    Contains class ModulatedDelay
+
+    Stereo delay effect with fractional delay times, feedback and an lfo on the
+    delay time ( chorus / flanger when the delay is short ). The delay time is
+    read with linear interpolation and glides towards a new value, so automation
+    of the delay time bends the pitch instead of clicking
+
+    The delay is processed in sub-blocks of rampLength samples. The delay time
+    and the lfo are evaluated once per sub-block and ramp linearly in between,
+    and the delay is never shorter than a sub-block, so every read of a
+    sub-block comes before its writes. A sub-block is then a few plain loops
+    ( positions, interpolation, write, mix ) that the compiler vectorises, apart
+    from the reads out of the delay line
+
+    Requires <JuceHeader.h> for AudioBuffer and MathConstants
+    Requires <vector> for the delay lines
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <cmath>
+
+/**
+* stereo delay with interpolated reads, feedback and lfo modulation of the delay time
+*
+* @param sampleRate (double) sample rate in Hz
+* @param seconds (float) delay time in seconds
+* @param feedback (float) level of the echoes fed back into the delay (0 - maxFeedback)
+* @param level (float) level of the delayed signal added to the input (0 - 1)
+* @param rate (float) frequency of the lfo in Hz
+* @param depthSeconds (float) range of the lfo on the delay time in seconds, 0 - no modulation
+* @param buffer (juce::AudioBuffer<float>&) audio to process ( in place )
+* @param numSamples (int) number of samples
+*/
+class ModulatedDelay
+{
+public:
+    static constexpr int rampLength = 32;               // samples between two evaluations of the delay time and the lfo
+    static constexpr float maxDelaySeconds = 1.0f;
+    static constexpr float maxDepthSeconds = 0.01f;
+    static constexpr float maxFeedback = 0.95f;
+    static constexpr float glideSeconds = 0.05f;        // time constant of the delay time when it changes
+    static constexpr float silenceThreshold = 0.0001f;
+
+    /**
+    * returns how long the echoes last in seconds
+    *
+    * @param seconds (float) delay time in seconds
+    * @param feedback (float) level of the echoes fed back into the delay
+    */
+    static float getTailSeconds(float seconds, float feedback)
+    {
+        float numEchoes = 1.0f;
+
+        if (feedback > 0.0f)
+            numEchoes += std::log(silenceThreshold) / std::log(juce::jmin(feedback, maxFeedback));
+
+        return seconds * numEchoes;
+    }
+
+    /**
+    * allocate the delay lines ( or reuse them ) and clear them - called in prepareToPlay()
+    *
+    * @param _sampleRate (double) sample rate in Hz
+    */
+    void prepare(double _sampleRate)
+    {
+        sampleRate = (float) _sampleRate;
+
+        // a power of two, so the positions wrap with a mask
+        int longest = (int) std::ceil((maxDelaySeconds + maxDepthSeconds) * sampleRate) + rampLength + 2;
+        int size = 1;
+
+        while (size < longest)
+            size *= 2;
+
+        for (auto& line : lines)
+        {
+            line.assign(size, 0.0f);    // keeps the memory if it is already big enough
+        }
+
+        mask = size - 1;
+        writePos = 0;
+        lfoPhase = 0.0f;
+        glideCoefficient = 1.0f - std::exp(-rampLength / (glideSeconds * sampleRate));
+        currentDelay = targetDelay = getDelayInSamples(delaySeconds);
+    }
+
+    /**
+    * set the delay time, the delay glides to it
+    *
+    * @param seconds (float) delay time in seconds ( maxDelaySeconds at most )
+    */
+    void setDelayTime(float seconds)
+    {
+        delaySeconds = seconds;
+        targetDelay = getDelayInSamples(seconds);
+    }
+
+    /**
+    * set the level of the echoes fed back into the delay
+    *
+    * @param _feedback (float) 0 - a single echo, up to maxFeedback
+    */
+    void setFeedback(float _feedback)
+    {
+        feedback = juce::jlimit(0.0f, maxFeedback, _feedback);
+    }
+
+    /**
+    * set the level of the delayed signal added to the input
+    *
+    * @param _level (float) 0 - no delay, 1 - as loud as the input
+    */
+    void setLevel(float _level)
+    {
+        level = _level;
+    }
+
+    /**
+    * set the lfo on the delay time, the left and right channels are a quarter of a cycle apart
+    *
+    * @param rate (float) frequency of the lfo in Hz
+    * @param depthSeconds (float) range of the lfo on the delay time in seconds ( maxDepthSeconds at most ), 0 - no modulation
+    */
+    void setModulation(float rate, float depthSeconds)
+    {
+        lfoIncrement = rate * rampLength / sampleRate;
+        depth = juce::jlimit(0.0f, maxDepthSeconds, depthSeconds) * sampleRate;
+    }
+
+    /**
+    * add the delayed signal to the first two channels of the buffer
+    *
+    * @param buffer (juce::AudioBuffer<float>&) audio to process ( in place )
+    * @param numSamples (int) number of samples
+    */
+    void process(juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        int numChannels = juce::jmin(buffer.getNumChannels(), 2);
+
+        for (int start = 0; start < numSamples; start += rampLength)
+        {
+            int length = juce::jmin(rampLength, numSamples - start);
+
+            // delay time and lfo at the end of the sub-block
+            float nextDelay = currentDelay + (targetDelay - currentDelay) * glideCoefficient * length / rampLength;
+            float nextPhase = lfoPhase + lfoIncrement * length / rampLength;
+            nextPhase -= std::floor(nextPhase);
+
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                float channelPhase = (float) chan * 0.25f;
+                float startDelay = currentDelay + getModulation(lfoPhase + channelPhase);
+                float endDelay = nextDelay + getModulation(nextPhase + channelPhase);
+
+                processChannel(lines[chan].data(), buffer.getWritePointer(chan, start), length, startDelay, endDelay);
+            }
+
+            writePos = (writePos + length) & mask;
+            currentDelay = nextDelay;
+            lfoPhase = nextPhase;
+        }
+    }
+
+private:
+    /**
+    * returns the delay in samples, never shorter than a sub-block
+    *
+    * @param seconds (float) delay time in seconds
+    */
+    float getDelayInSamples(float seconds) const
+    {
+        return juce::jlimit((float) (rampLength + 1), maxDelaySeconds * sampleRate, seconds * sampleRate);
+    }
+
+    /**
+    * returns the lfo part of the delay in samples (0 - depth)
+    *
+    * @param phase (float) phase of the lfo, any number of cycles
+    */
+    float getModulation(float phase) const
+    {
+        return depth * 0.5f * (1.0f + std::sin(phase * juce::MathConstants<float>::twoPi));
+    }
+
+    /**
+    * delay one channel of a sub-block, the delay time ramps from startDelay to endDelay
+    *
+    * @param line (float*) delay line of the channel
+    * @param io (float*) samples of the channel, the delayed signal is added to them
+    * @param numSamples (int) number of samples, rampLength at most
+    * @param startDelay (float) delay in samples before the first sample
+    * @param endDelay (float) delay in samples at the last sample
+    */
+    void processChannel(float* line, float* io, int numSamples, float startDelay, float endDelay)
+    {
+        float step = (endDelay - startDelay) / numSamples;
+        int whole[rampLength];
+        float fractions[rampLength];
+        float newer[rampLength];
+        float older[rampLength];
+        float delayed[rampLength];
+
+        // split the delay of every sample into whole samples and a fraction
+        for (int i = 0; i < numSamples; i++)
+        {
+            float delay = startDelay + step * (i + 1);
+            whole[i] = (int) delay;
+            fractions[i] = delay - (float) whole[i];
+        }
+
+        // the two samples around each read position, written before this sub-block
+        for (int i = 0; i < numSamples; i++)
+        {
+            int readPos = writePos + i - whole[i];
+            newer[i] = line[readPos & mask];
+            older[i] = line[(readPos - 1) & mask];
+        }
+
+        // linear interpolation
+        for (int i = 0; i < numSamples; i++)
+        {
+            delayed[i] = newer[i] + (older[i] - newer[i]) * fractions[i];
+        }
+
+        // write the input and the feedback, in at most two contiguous spans
+        int firstSpan = juce::jmin(numSamples, mask + 1 - writePos);
+        float* dest = line + writePos;
+
+        for (int i = 0; i < firstSpan; i++)
+        {
+            dest[i] = io[i] + delayed[i] * feedback;
+        }
+
+        for (int i = firstSpan; i < numSamples; i++)
+        {
+            line[i - firstSpan] = io[i] + delayed[i] * feedback;
+        }
+
+        // add the delayed signal to the output
+        for (int i = 0; i < numSamples; i++)
+        {
+            io[i] += delayed[i] * level;
+        }
+    }
+
+    std::vector<float> lines[2];    // left and right
+    int mask = 0;                   // size of the delay lines - 1
+    int writePos = 0;
+    float sampleRate = 44100.0f;
+
+    // delay time in samples, glides from currentDelay towards targetDelay
+    float delaySeconds = 0.25f;
+    float currentDelay = (float) rampLength + 1.0f;
+    float targetDelay = (float) rampLength + 1.0f;
+    float glideCoefficient = 1.0f;
+
+    float feedback = 0.0f;
+    float level = 0.0f;
+
+    // lfo on the delay time, evaluated once per sub-block
+    float lfoPhase = 0.0f;          // cycles
+    float lfoIncrement = 0.0f;      // cycles per sub-block
+    float depth = 0.0f;             // samples
+};
@@ -3,10 +3,12 @@
 
     Oscillator.h
 
-    Contains class Oscillator and its subclasses : 
-    SineOsc, TriOsc, LinearIncrease, PhaseModulationSineOsc, SquareOsc
+    Contains the template OscillatorStack and its aliases : 
+    Oscillator, SineOsc, TriOsc, PhaseModulationSineOsc, SquareOsc
 
     All the classes generates an oscillator with a different type of wave
+    The oscillators are built from policies (wave shape, frequency modulation,
+    phase modulation) at compile time, there are no virtual calls
 
     Requires <cmath> library for sin() function
     Requires <math.h> library for M_PI (value of pi)
@@ -21,327 +23,377 @@
 #define _USE_MATH_DEFINES     // for M_PI
 #include <math.h>             // for M_PI
 
+// ===========================
+// wave shapes - turn the phase (0 - 1) into the output
+
 /**
-* Oscillator class : generates phasor
-* 
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @return process() (float) output of the phase
+* phasor, outputs the phase
 */
-class Oscillator
+struct PhasorShape
 {
-public:
-    
-    /**
-     * update the phase and output signal 
-     *
-     * @return phaseOutput(phase) the phase output
-     */
-    virtual float process() 
+    float operator()(float p) const
     {
-        phase += phaseDelta;
+        return p;
+    }
+};
 
-        if (phase > 1.0f)
-            phase -= 1.0f;
+/**
+* sine wave, the power of the sine wave is shaped with sinPower
+*/
+struct SineShape
+{
+    float operator()(float p) const
+    {
+        float s = (float) sin(p * 2 * M_PI);
+        return (sinPower == 1) ? s : (float) pow(s, sinPower);
+    }
+
+    int sinPower = 1;   // default value = 1
+};
 
-        return phaseOutput(phase);
+/**
+* triangular wave
+*/
+struct TriShape
+{
+    float operator()(float p) const
+    {
+        return fabs(p - 0.5f) - 0.25f;
     }
+};
 
-    /**
-    * virtual function to be manipulated in subclasses
-    */
-    virtual float phaseOutput(float p) 
+/**
+* square wave
+*/
+struct SquareShape
+{
+    float operator()(float p) const
     {
-        return p;    
+        return (p > pulseWidth) ? -0.5f : 0.5f;
     }
-    
-    /**
-     * set the sample rate - needs to be called before setting frequency or using process
-     * 
-     * @param _sampleRate (float) samplerate in Hz
-     */
-    void setSampleRate(float _sampleRate)
+
+    float pulseWidth = 0.5f; // default value
+};
+
+// ===========================
+// frequency modulations - return the change of the phase delta for the next sample
+
+/**
+* no frequency modulation
+*/
+struct NoFrequencyModulation
+{
+    float next()
     {
-        sampleRate = _sampleRate;
+        return 0.0f;
     }
-    
-    /**
-     * set the oscillator frequency - The sample rate has to be set first
-     *
-     * @param _frequency (float) oscillator frequency in Hz
-     */
-    void setFrequency(float _frequency)
+};
+
+/**
+* sinusoidal frequency modulation (vibrato)
+*
+* @param sampleRate (float) sample rate in Hz
+* @param modulationRate (float) frequency of the modulation in Hz
+* @param modulationDepth (float) depth of the modulation in Hz
+*/
+struct SineFrequencyModulation
+{
+    void setParams(float sampleRate, float modulationRate, float modulationDepth)
     {
-        frequency = _frequency;
-        phaseDelta = frequency / sampleRate;
+        phaseDelta = modulationRate / sampleRate;
+        depth = modulationDepth / sampleRate;
     }
 
-    /**
-    * function to output a sinusoidal wave to be used for subclasses for modulation 
-    */
-    float sinModulation()
+    float next()
     {
         phase += phaseDelta;
 
         if (phase > 1.0f)
             phase -= 1.0f;
 
-        return sin(phase * 2 * M_PI);
+        return depth * (float) sin(phase * 2 * M_PI);
     }
 
-    /**
-    * returns the phase delta (float)
-    */
-    float getPhaseDelta()
+    float phase = 0.0f;
+    float phaseDelta = 0.0f;
+    float depth = 0.0f;     // depth in Hz / sample rate, default value = 0
+};
+
+// ===========================
+// phase modulations - return the phase offset (in cycles) for the next sample
+
+/**
+* no phase modulation
+*/
+struct NoPhaseModulation
+{
+    float next()
     {
-        return phaseDelta;
+        return 0.0f;
     }
-
-protected:
-    float frequency;
-    float sampleRate;
-    float phase = 0.0f;
-    float phaseDelta;
 };
 
 /**
-* SineOsc class : generates sine oscillator
-* Inherits from Oscillator class
+* LinearIncrease class : generates phasor oscillator
+* resets in a custom set time
 *
 * @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @param _modulationRate (float) the rate of the frequency modulation 
-* @param _freqModulationDepth (float) the depth of the frequency modulation
-* @param _sinPower (int) the power of the sine wave
-* @return process() (float) output of the sine phase
+* @param _frequency (float) frequency in Hz ( unused, the phase increases by 1 every sample )
+* @param durationInSeconds (int) duration to reset the phase in seconds
+* @return process() (float) output of the phasor phase
 */
-class SineOsc : public Oscillator
+class LinearIncrease
 {
 public:
-
-    /**
-    * output the phase as a sinusoidal wave with possible pase modulation, the power of the sine wave is shaped with variable sinPower
-    */
-    float phaseOutput(float p) override 
+    void setSampleRate(float _sampleRate)
     {
-        return pow(sin(p * 2 * M_PI), sinPower);
+        sampleRate = _sampleRate;
     }
 
+    void setFrequency(float) {}
 
     /**
-    * set the depth and frequency of the modulation 
-    * 
-    * @param _modulationRate frequency of modulation
-    * @param _modulationDepth depth of modulation
+    * resets the phase to zero every durationInSeconds
+    *
+    * @param durationInSeconds (int) the duration to reset the phase in seconds
     */
-    void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
+    float process(int durationInSeconds)
     {
-        freqModulationDepth = _freqModulationDepth;
-        modulatingOsc.setSampleRate(sampleRate);
-        modulatingOsc.setFrequency(_modulationRate);
+        phase += 1;
+
+        if (phase == (sampleRate * durationInSeconds)) // duration in samples
+        {
+            phase = 0;
+        }
+
+        return phase;
     }
 
-    /**
-    * output the value taken from phaseOutput by inputting the phase, manipulate the wave with modulations
-    * 
-    * @return phaseOutput(phase) processed phase
-    */
-    float process() override
+private:
+    float sampleRate;
+    float phase = 0.0f;
+};
+
+/**
+* phase modulation with a sinusoidal modulation index which grows over a ramp
+*
+* @param _sampleRate (float) sample rate in Hz
+* @param _frequency (float) frequency of the modulating oscillator in Hz
+* @param _durationInSeconds (int) duration to reset the ramp in seconds
+*/
+class RampPhaseModulation
+{
+public:
+    void setParams(float _sampleRate, float _frequency, int _durationInSeconds)
     {
-        modulation = freqModulationDepth * modulatingOsc.sinModulation();
+        sampleRate = _sampleRate;
+        linearIncrease.setSampleRate(_sampleRate);
+        rampDelta = _frequency / _sampleRate;
+        durationInSeconds = _durationInSeconds;
+    }
 
-        phaseDelta = (frequency + modulation) / sampleRate;
+    float next()
+    {
+        // linIncrease - variable that increases in value linearly
+        float linIncrease = linearIncrease.process(durationInSeconds * sampleRate) / (float)(durationInSeconds * sampleRate);
 
-        phase += phaseDelta;
+        // cycle - scale linIncrease into range -1 to 1
+        float cycle = (float) sin(linIncrease * M_PI);
 
-        if (phase > 1.0f)
-            phase -= 1.0f;
+        // modulationIndex - sinusoidal modulation index which increases in amplitude every cycle
+        float modulationIndex = linIncrease * 10 * cycle;
 
-        return phaseOutput(phase);
+        // output of modulating oscillator ( in cycles )
+        rampPhase += rampDelta;
 
-    }
+        if (rampPhase > 1.0f)
+            rampPhase -= 1.0f;
 
-    /**
-    * set the power of the sine wave
-    * 
-    * @param _sinPower integer value for the power
-    */
-    void setPower(int _sinPower)
-    {
-        sinPower = _sinPower;
+        return modulationIndex * (float) sin(rampPhase * 2 * M_PI) / (float) (2 * M_PI);
     }
 
 private:
-    // variables for frequency modulation, default values = 0
-    float freqModulationDepth = 0;
-    float modulation = 0;
-    // variable for the power of the sine wave, default value = 1
-    int sinPower = 1;
-    // oscillator used to modulate frequency
-    Oscillator modulatingOsc;
+    float sampleRate = 44100.0f;
+    int durationInSeconds = 1;
+    LinearIncrease linearIncrease;  // phasor for phase modulation
+    float rampPhase = 0.0f;         // phasor for phase modulation
+    float rampDelta = 0.0f;
 };
 
+// ===========================
+// oscillator built from the policies
+
 /**
-* TriOsc class : generates triangle wave oscillator
-* Inherits from Oscillator class
+* OscillatorStack class : oscillator built from a wave shape, a frequency modulation and a phase modulation
+* every call is resolved at compile time
 *
 * @param _sampleRate (float) sample rate in Hz
 * @param _frequency (float) frequency in Hz
-* @return process() (float) output of the triangle wave phase
+* @param dest (float*) block to write the output into
+* @param numSamples (int) number of samples
+* @return process() (float) output of the oscillator
 */
-class TriOsc : public Oscillator
+template <typename Shape, typename FrequencyModulation = NoFrequencyModulation, typename PhaseModulation = NoPhaseModulation>
+class OscillatorStack
 {
+public:
+
     /**
-    * output triangular wave
+     * update the phase and output signal
+     *
+     * @return the output of the wave shape
+     */
+    float process()
+    {
+        phase += phaseDelta + frequencyModulation.next();
+
+        if (phase > 1.0f)
+            phase -= 1.0f;
+
+        return shape(phase + phaseModulation.next());
+    }
+
+    /**
+     * render a block of samples
+     *
+     * @param dest (float*) block to write the output into
+     * @param numSamples (int) number of samples
+     */
+    void process(float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            dest[i] = process();
+        }
+    }
+
+    /**
+     * set the sample rate - needs to be called before setting frequency or using process
+     *
+     * @param _sampleRate (float) samplerate in Hz
+     */
+    void setSampleRate(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+    }
+
+    /**
+     * set the oscillator frequency - The sample rate has to be set first
+     *
+     * @param _frequency (float) oscillator frequency in Hz
+     */
+    void setFrequency(float _frequency)
+    {
+        frequency = _frequency;
+        phaseDelta = frequency / sampleRate;
+    }
+
+    /**
+    * returns the phase delta (float)
     */
-    float phaseOutput(float p) override
+    float getPhaseDelta()
     {
-        return fabs(p - 0.5) - 0.25;
+        return phaseDelta;
     }
 
+protected:
+    float frequency;
+    float sampleRate;
+    float phase = 0.0f;
+    float phaseDelta;
+
+    // policies
+    Shape shape;
+    FrequencyModulation frequencyModulation;
+    PhaseModulation phaseModulation;
 };
 
 /**
-* LinearIncrease class : generates phasor oscillator 
-* resets in a custom set time 
-* Inherits from Oscillator class
+* Oscillator class : generates phasor
+*/
+using Oscillator = OscillatorStack<PhasorShape>;
+
+/**
+* TriOsc class : generates triangle wave oscillator
+*/
+using TriOsc = OscillatorStack<TriShape>;
+
+/**
+* SineOsc class : generates sine oscillator
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @param durationInSeconds (int) duration to reset the phase in seconds
-* @return process() (float) output of the phasor phase
+* @param _modulationRate (float) the rate of the frequency modulation
+* @param _freqModulationDepth (float) the depth of the frequency modulation
+* @param _sinPower (int) the power of the sine wave
 */
-class LinearIncrease : public Oscillator
+class SineOsc : public OscillatorStack<SineShape, SineFrequencyModulation>
 {
 public:
 
     /**
-    * resets the phase to zero every durationInSeconds
-    * 
-    * @param durationInSeconds (int) the duration to reset the phase in seconds
+    * set the depth and frequency of the modulation
+    *
+    * @param _modulationRate frequency of modulation
+    * @param _modulationDepth depth of modulation
     */
-    float process(int durationInSeconds)
+    void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
     {
-        phase += 1;
-        
-        if (phase == (sampleRate * durationInSeconds)) // duration in samples
-        {
-            phase = 0;
-        }
+        frequencyModulation.setParams(sampleRate, _modulationRate, _freqModulationDepth);
+    }
 
-        return phaseOutput(phase);
+    /**
+    * set the power of the sine wave
+    *
+    * @param _sinPower integer value for the power
+    */
+    void setPower(int _sinPower)
+    {
+        shape.sinPower = _sinPower;
     }
 };
 
-
 /**
 * PhaseModulationSineOsc class : generates phase modulate sine oscillator
-* Inherits from Oscillator class
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
 * @param _durationInSeconds (int) duration to reset the phase in seconds
-* @return process() (float) output of the phase modulated sine phase
 */
-class PhaseModulationSineOsc : public Oscillator
+class PhaseModulationSineOsc : public OscillatorStack<SineShape, SineFrequencyModulation, RampPhaseModulation>
 {
 public:
-    float phaseOutput(float p) override
-    {
-        phaseModulate();
-        return (sin(finalModulation + (p * 2 * M_PI)));
-    }
 
     /**
     * sets the parameters for the oscillator used to modulate the phase
     * these parameters must be set in order to use this class
-    * 
+    *
     * @param _sampleRate (float) sample rate in Hz
     * @param _frequency (float) frequency in Hz
     * @param _durationInSeconds (int) duration to reset the phase in seconds
     */
     void setRampParams(float _sampleRate, float _frequency, int _durationInSeconds)
     {
-        linearIncrease.setSampleRate(_sampleRate);
-        linearIncrease.setFrequency(_frequency);
-        rampMod.setSampleRate(_sampleRate);
-        rampMod.setFrequency(_frequency);
-        durationInSeconds = _durationInSeconds;
+        phaseModulation.setParams(_sampleRate, _frequency, _durationInSeconds);
     }
 
     /**
-    * modulates the output, this function is called in phaseOutput() 
+    * set the depth and frequency of the modulation
+    *
+    * @param _modulationRate frequency of modulation
+    * @param _modulationDepth depth of modulation
     */
-    void phaseModulate()
-    {
-        // linIncrease - variable that increases in value linearly
-        float linIncrease = linearIncrease.process(durationInSeconds * sampleRate) / (float) (durationInSeconds * sampleRate); 
-
-        // cycle - scale linIncrease into range -1 to 1
-        float cycle = sin(linIncrease * M_PI);
-
-        // modulationIndex - sinusoidal modulation index which increases in amplitude every cycle 
-        float modulationIndex = linIncrease * 10 * cycle;
-
-        //output of modulating oscillator
-        finalModulation = modulationIndex * sin(rampMod.process() * 2 * M_PI);
-    }
-
-      /**
-      * set the depth and frequency of the modulation
-      *
-      * @param _modulationRate frequency of modulation
-      * @param _modulationDepth depth of modulation
-      */
     void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
     {
-        freqModulationDepth = _freqModulationDepth;
-        modulatingOsc.setSampleRate(sampleRate);
-        modulatingOsc.setFrequency(_modulationRate);
+        frequencyModulation.setParams(sampleRate, _modulationRate, _freqModulationDepth);
     }
-
-private:
-
-    // variables for phase modulation
-    float finalModulation;
-    int durationInSeconds;
-
-    // variables for frequency modulation, default values = 0
-    float freqModulationDepth = 0;
-    float modulation = 0;
-
-    // oscillators
-    Oscillator modulatingOsc;       // oscillator for frequency modulation
-    LinearIncrease linearIncrease; // phasor for phase modulation
-    Oscillator rampMod;            // phasor for phase modulation
 };
 
 /**
 * SquareOsc class : generates square wave oscillator
-* Inherits from Oscillator class
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
 * @param _pulseWidth (float) the pulse width (default value = 0.5)
-* @return process() (float) output of the phase modulated sine phase
 */
-class SquareOsc : public Oscillator
+class SquareOsc : public OscillatorStack<SquareShape>
 {
 public:
 
-    /**
-    * output square wave
-    */
-    float phaseOutput(float p) override
-    {
-        float outVal = 0.5;
-
-        if (p > pulseWidth)
-            outVal = -0.5;
-
-        return outVal;
-    }
-
     /**
     * set pulse width
     *
@@ -349,13 +401,8 @@ public:
     */
     void setPulseWidth(float _pulseWidth)
     {
-        pulseWidth = _pulseWidth;
+        shape.pulseWidth = _pulseWidth;
     }
-
-private:
-    float pulseWidth = 0.5f; // default value
 };
 
 #endif /* Oscillators_h */
-
-
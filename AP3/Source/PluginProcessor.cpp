@@ -28,29 +28,45 @@ AP3AudioProcessor::AP3AudioProcessor()
     std::make_unique < juce::AudioParameterFloat >("volume", " Volume ", 0.0f , 1.0f , 0.5f)
 , std::make_unique < juce::AudioParameterFloat >("cutoffFreq", "Cutoff Freq", 50.0f , 750.0f , 200.0f)
 , std::make_unique < juce::AudioParameterFloat >("delayTime", "Delay Time", 0.01f , 0.99f , 0.25f)
+, std::make_unique < juce::AudioParameterFloat >("delayFeedback", "Delay Feedback", 0.0f , (float) ModulatedDelay::maxFeedback , 0.3f)
+, std::make_unique < juce::AudioParameterFloat >("delayLevel", "Delay Level", 0.0f , 1.0f , 0.0f)
+, std::make_unique < juce::AudioParameterFloat >("delayModRate", "Delay Mod Rate (Hz)", 0.05f , 5.0f , 0.5f)
+, std::make_unique < juce::AudioParameterFloat >("delayModDepth", "Delay Mod Depth (ms)", 0.0f , 10.0f , 0.0f)
 , std::make_unique < juce::AudioParameterChoice >("direction", "Direction", juce::StringArray({"rampUp", "rampDown"}), 0)
 , std::make_unique < juce::AudioParameterFloat >("detune", "Detune (Hz)", 0.0f , 20.0f , 2.0f)
+, std::make_unique < juce::AudioParameterInt >("unisonVoices", "Unison Voices", 1 , (int) UnisonOscillator::maxVoices , 7)
+, std::make_unique < juce::AudioParameterFloat >("unisonWidth", "Unison Width", 0.0f , 1.0f , 0.8f)
+, std::make_unique < juce::AudioParameterFloat >("synthLevel", "Synth Level", 0.0f , 1.0f , 0.0f)
         })
 {
     volumeParameter = avpts.getRawParameterValue("volume");
     minMaxParameter = avpts.getRawParameterValue("cutoffFreq");
     delayParameter = avpts.getRawParameterValue("delayTime");
+    delayFeedbackParameter = avpts.getRawParameterValue("delayFeedback");
+    delayLevelParameter = avpts.getRawParameterValue("delayLevel");
+    delayModRateParameter = avpts.getRawParameterValue("delayModRate");
+    delayModDepthParameter = avpts.getRawParameterValue("delayModDepth");
     upDownParameter = avpts.getRawParameterValue("direction");
     detuneParameter = avpts.getRawParameterValue("detune");
+    unisonVoicesParameter = avpts.getRawParameterValue("unisonVoices");
+    unisonWidthParameter = avpts.getRawParameterValue("unisonWidth");
+    synthLevelParameter = avpts.getRawParameterValue("synthLevel");
 
     for (int i = 0; i < voiceCount; i++) // loop to add voice
     {
-        //synth.addVoice( new MySynthVoice() );
+        synth.addVoice( new MySynthVoice() );
         sampler.addVoice(new juce::SamplerVoice());
     }
     sampler.init();
-    //synth.addSound( new MySynthSound() );
+    synth.addSound( new MySynthSound() );
 
-    //for (int i = 0; i < voiceCount; i++) // set detune
-    //{
-    //    MySynthVoice* v = dynamic_cast<MySynthVoice*>(synth.getVoice(i));
-    //    v->setDetunePointer(detuneParameter);
-    //}
+    for (int i = 0; i < voiceCount; i++) // set detune, unison and level
+    {
+        MySynthVoice* v = dynamic_cast<MySynthVoice*>(synth.getVoice(i));
+        v->setDetunePointer(detuneParameter);
+        v->setUnisonPointers(unisonVoicesParameter, unisonWidthParameter);
+        v->setLevelPointer(synthLevelParameter);
+    }
 }
 
 AP3AudioProcessor::~AP3AudioProcessor()
@@ -59,22 +75,23 @@ AP3AudioProcessor::~AP3AudioProcessor()
 
 void AP3AudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    //synth.setCurrentPlaybackSampleRate(sampleRate); // set the sample rate of synth
+    synth.setCurrentPlaybackSampleRate(sampleRate); // set the sample rate of synth
     sampler.setCurrentPlaybackSampleRate(sampleRate); // set the sample rate of sampler
 
-    //for (int i = 0; i < voiceCount; i++) // set sample rate for each voice
-    //{
-    //    MySynthVoice* v = dynamic_cast<MySynthVoice*>(synth.getVoice(i));
-    //    v->init(sampleRate);
-    //}
+    for (int i = 0; i < voiceCount; i++) // set sample rate for each voice
+    {
+        MySynthVoice* v = dynamic_cast<MySynthVoice*>(synth.getVoice(i));
+        v->init(sampleRate);
+    }
 
-    //sr = sampleRate;
+    sr = sampleRate;
     //if (upDownParameter > 0) // if it is not the first choice
     //{
     //    // some code here
     //}
 
-    //delay.setDelayTime(sr * delayTimeInSeconds);
+    delay.setDelayTime(*delayParameter);
+    delay.prepare(sampleRate);
 
     //// smooth value setting
     //smoothVolume.reset(sampleRate, 1.0f);
@@ -87,24 +104,27 @@ void AP3AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mid
 
     int numSamples = buffer.getNumSamples();
 
-    float* left = buffer.getWritePointer(0);
-    float* right = buffer.getWritePointer(1);
+    // process entire block of samples for synths, the unison synth only plays while its level is up
+    // ( it is 0 by default, so sessions saved before it existed still play the sampler alone )
+    if (*synthLevelParameter > 0.0f)
+    {
+        synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
+        synthRunning = true;
+    }
+    else if (synthRunning)
+    {
+        synth.allNotesOff(0, false);
+        synthRunning = false;
+    }
 
-    //// process entire block of samples for synths
-    //synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
     sampler.renderNextBlock(buffer, midiMessages, 0, numSamples);
 
-    //delay.setDelayTime(*delayParameter * sr); // delay
-    //smoothVolume.setTargetValue(*volumeParameter); // smooth value
-
-    //for (int i = 0; i < numSamples; i++)
-    //{
-    //    float gainVal = smoothVolume.getNextValue();
-
-    //    //left[i] =
-    //    //right[i] =
-    //}
-
+    // delay, processed on the whole block after the synth and the sampler
+    delay.setDelayTime(*delayParameter);
+    delay.setFeedback(*delayFeedbackParameter);
+    delay.setLevel(*delayLevelParameter);
+    delay.setModulation(*delayModRateParameter, *delayModDepthParameter * 0.001f);
+    delay.process(buffer, numSamples);
 }
 //==============================================================================
 const juce::String AP3AudioProcessor::getName() const
@@ -141,7 +161,11 @@ bool AP3AudioProcessor::isMidiEffect() const
 
 double AP3AudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // echoes of the delay, none while the delay is muted
+    if (*delayLevelParameter <= 0.0f)
+        return 0.0;
+
+    return ModulatedDelay::getTailSeconds(*delayParameter + *delayModDepthParameter * 0.001f, *delayFeedbackParameter);
 }
 
 int AP3AudioProcessor::getNumPrograms()
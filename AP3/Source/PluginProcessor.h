@@ -9,7 +9,7 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "Delay.h"
+#include "ModulatedDelay.h"
 #include "YourSynthVoice.h"
 #include "TMSampler.h"
 
@@ -62,8 +62,15 @@ private:
     std::atomic<float>* volumeParameter;
     std::atomic<float>* minMaxParameter;
     std::atomic<float>* delayParameter;
+    std::atomic<float>* delayFeedbackParameter;
+    std::atomic<float>* delayLevelParameter;
+    std::atomic<float>* delayModRateParameter;
+    std::atomic<float>* delayModDepthParameter;
     std::atomic<float>* upDownParameter;
     std::atomic<float>* detuneParameter;
+    std::atomic<float>* unisonVoicesParameter;
+    std::atomic<float>* unisonWidthParameter;
+    std::atomic<float>* synthLevelParameter;
 
     // smooth values
     juce::SmoothedValue<float> smoothVolume;
@@ -71,11 +78,13 @@ private:
     // synthesiser class
     int voiceCount = 8;
     juce::Synthesiser synth;
+    bool synthRunning = false; // the synth has been given notes since its level was last 0
 
     // sample rate
     float sr;
-    Delay delay;
-    float delayTimeInSeconds = 0.25f;
+
+    // stereo delay after the synth and the sampler
+    ModulatedDelay delay;
 
     // TM sampler
     TMSampler sampler;
@@ -20,9 +20,13 @@ public:
         formatManager.registerBasicFormats();
 
         // load audio file
-        juce::File* file = new juce::File("C:/Users/s1859154/Documents/GitHub/composition.shakeTiming.wav");
+        juce::File file("C:/Users/s1859154/Documents/GitHub/composition.shakeTiming.wav");
         std::unique_ptr<juce::AudioFormatReader> reader;
-        reader.reset( formatManager.createReaderFor(*file) );
+        reader.reset( formatManager.createReaderFor(file) );
+
+        // no sample on this machine, the sampler stays silent
+        if (reader == nullptr)
+            return;
 
         juce::BigInteger allNotes;
         allNotes.setRange(0, 120, true);
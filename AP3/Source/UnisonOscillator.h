@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    UnisonOscillator.h
+
+    Contains class UnisonOscillator
+
+    Supersaw: up to maxVoices band-limited ( polyBLEP ) saws, detuned around the
+    note, with their phases spread at the start of a note and their stereo
+    positions spread across the field
+
+    The saws are kept as lanes of small arrays ( phase, phase increment, left and
+    right gain ), one array element per saw. Every sample runs the same plain
+    loop over all maxVoices lanes, which the compiler turns into a few vector
+    instructions, so 1 saw costs the same as 16. Unused lanes keep running with
+    a gain of 0, there is no branch per lane
+
+    Requires <JuceHeader.h> for jlimit and MathConstants
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+
+/**
+* stereo unison of detuned polyBLEP saws
+*
+* @param sampleRate (float) sample rate in Hz
+* @param numVoices (int) number of saws (1 - maxVoices)
+* @param frequency (float) frequency of the note in Hz
+* @param detune (float) frequency of the outer saws above and below the note in Hz
+* @param width (float) stereo spread of the saws, 0 - all centred, 1 - hard left to hard right
+* @param left (float*) left output
+* @param right (float*) right output
+* @param numSamples (int) number of samples
+*/
+class UnisonOscillator
+{
+public:
+    static constexpr int maxVoices = 16;
+
+    UnisonOscillator()
+    {
+        updateGains();
+        updateIncrements();
+        resetPhases();
+    }
+
+    /**
+    * set the sample rate
+    *
+    * @param _sampleRate (float) sample rate in Hz
+    */
+    void setSampleRate(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+        updateIncrements();
+    }
+
+    /**
+    * set the number of saws
+    *
+    * @param _numVoices (int) 1 - maxVoices
+    */
+    void setNumVoices(int _numVoices)
+    {
+        _numVoices = juce::jlimit(1, maxVoices, _numVoices);
+
+        if (_numVoices != numVoices)
+        {
+            numVoices = _numVoices;
+            updateGains();
+            updateIncrements();
+        }
+    }
+
+    /**
+    * set the stereo spread of the saws
+    *
+    * @param _width (float) 0 - all centred, 1 - hard left to hard right
+    */
+    void setStereoWidth(float _width)
+    {
+        _width = juce::jlimit(0.0f, 1.0f, _width);
+
+        if (_width != width)
+        {
+            width = _width;
+            updateGains();
+        }
+    }
+
+    /**
+    * set the frequency of the note and the detune of the saws, spaced evenly from frequency - detune to frequency + detune
+    *
+    * @param _frequency (float) frequency of the note in Hz
+    * @param _detune (float) frequency of the outer saws above and below the note in Hz
+    */
+    void setFrequency(float _frequency, float _detune)
+    {
+        frequency = _frequency;
+        detune = _detune;
+        updateIncrements();
+    }
+
+    /**
+    * spread the phases of the saws, called at the start of a note so that the saws do not start in phase
+    */
+    void resetPhases()
+    {
+        for (int v = 0; v < maxVoices; v++)
+        {
+            float phase = v * 0.618034f;   // golden ratio, never lines two saws up
+            phases[v] = phase - std::floor(phase);
+        }
+    }
+
+    /**
+    * render the saws, replaces the contents of left and right
+    *
+    * @param left (float*) left output
+    * @param right (float*) right output
+    * @param numSamples (int) number of samples
+    */
+    void process(float* left, float* right, int numSamples)
+    {
+        constexpr int groups = maxVoices / 4;
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            alignas(16) float saws[maxVoices];
+
+            // every lane at once: advance the phase, wrap it, saw minus the polyBLEP correction
+            for (int v = 0; v < maxVoices; v++)
+            {
+                float p = phases[v] + increments[v];
+                p -= (float) (int) p;
+                phases[v] = p;
+
+                // both corrections are worked out for every lane and masked by their region ( never both ),
+                // the masks are ints so that the compiler keeps the loop free of branches
+                float start = p * inverseIncrements[v];                 // 0 - 1 just after the wrap
+                float end = (p - 1.0f) * inverseIncrements[v];          // -1 - 0 just before the wrap
+                int afterWrap = (int) start == 0;
+                int beforeWrap = (int) end == 0;
+                float startCorrection = start + start - start * start - 1.0f;
+                float endCorrection = end * end + end + end + 1.0f;
+
+                saws[v] = p + p - 1.0f - startCorrection * (float) afterWrap - endCorrection * (float) beforeWrap;
+            }
+
+            // sum the lanes in groups of four, then the groups
+            float leftSums[groups];
+            float rightSums[groups];
+
+            for (int g = 0; g < groups; g++)
+            {
+                leftSums[g] = saws[g] * leftGains[g] + saws[g + 4] * leftGains[g + 4]
+                            + saws[g + 8] * leftGains[g + 8] + saws[g + 12] * leftGains[g + 12];
+                rightSums[g] = saws[g] * rightGains[g] + saws[g + 4] * rightGains[g + 4]
+                             + saws[g + 8] * rightGains[g + 8] + saws[g + 12] * rightGains[g + 12];
+            }
+
+            left[i] = (leftSums[0] + leftSums[1]) + (leftSums[2] + leftSums[3]);
+            right[i] = (rightSums[0] + rightSums[1]) + (rightSums[2] + rightSums[3]);
+        }
+    }
+
+private:
+    static_assert(maxVoices % 4 == 0, "the lanes are summed in groups of four");
+
+    /**
+    * returns the position of a saw in the unison, spaced evenly from -1 to 1
+    *
+    * @param v (int) index of the saw
+    */
+    float getSpread(int v) const
+    {
+        return numVoices > 1 ? v * 2.0f / (numVoices - 1) - 1.0f : 0.0f;
+    }
+
+    /**
+    * work out the phase increment of every lane, unused lanes run at the note frequency
+    */
+    void updateIncrements()
+    {
+        for (int v = 0; v < maxVoices; v++)
+        {
+            float laneFrequency = v < numVoices ? frequency + detune * getSpread(v) : frequency;
+            increments[v] = juce::jlimit(minIncrement, 0.5f, laneFrequency / sampleRate);
+            inverseIncrements[v] = 1.0f / increments[v];
+        }
+    }
+
+    /**
+    * work out the stereo gains of every lane (equal-power), unused lanes are silent
+    */
+    void updateGains()
+    {
+        float level = 1.0f / std::sqrt((float) numVoices);    // same loudness for any number of saws
+
+        for (int v = 0; v < maxVoices; v++)
+        {
+            float angle = (getSpread(v) * width + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+            float gain = v < numVoices ? level * juce::MathConstants<float>::sqrt2 : 0.0f;
+            leftGains[v] = std::cos(angle) * gain;
+            rightGains[v] = std::sin(angle) * gain;
+        }
+    }
+
+    static constexpr float minIncrement = 1.0e-6f;   // keeps the polyBLEP away from a division by 0
+
+    // lanes, one element per saw
+    alignas(16) float phases[maxVoices] = {};
+    alignas(16) float increments[maxVoices] = {};
+    alignas(16) float inverseIncrements[maxVoices] = {};
+    alignas(16) float leftGains[maxVoices] = {};
+    alignas(16) float rightGains[maxVoices] = {};
+
+    float sampleRate = 44100.0f;
+    float frequency = 440.0f;
+    float detune = 0.0f;
+    float width = 1.0f;
+    int numVoices = 1;
+};
@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    VoiceOutput.h
+
+    Contains class VoiceOutput
+
+    Mono scratch block for a synthesiser voice. The voice renders its samples into
+    the block, then the block is added to every output channel with one vectorised
+    gain-and-add per channel (instead of addSample() for every sample and channel)
+
+    A voice with a stereo output ( unison ) renders into the block and a second
+    block for the right channel, and mixes them with mixStereoInto()
+
+    Requires <JuceHeader.h> for AudioBuffer and FloatVectorOperations
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/**
+* mono ( or stereo ) scratch block with a stereo position, used by the voices to write their output
+*
+* @param pan (float) stereo position of the voice (-1 left, 0 centre, 1 right)
+* @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+* @param startSample (int) position of the first sample in outputBuffer
+* @param numSamples (int) number of samples rendered into the block
+* @param gain (float) gain applied while mixing
+* @return getBlock() (float*) the scratch block, holds maxBlockSize samples
+* @return getRightBlock() (float*) the scratch block of the right channel for stereo voices, holds maxBlockSize samples
+*/
+class VoiceOutput
+{
+public:
+    static constexpr int maxBlockSize = 256; // voices render in chunks of at most this many samples
+
+    /**
+    * returns the scratch block that the voice renders into
+    */
+    float* getBlock()
+    {
+        return block;
+    }
+
+    /**
+    * returns the scratch block of the right channel, for voices that render in stereo
+    */
+    float* getRightBlock()
+    {
+        return rightBlock;
+    }
+
+    /**
+    * set the stereo position of the voice (equal-power, centre is unity gain)
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        float angle = (juce::jlimit(-1.0f, 1.0f, pan) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+        targetGains[0] = std::cos(angle) * juce::MathConstants<float>::sqrt2;
+        targetGains[1] = std::sin(angle) * juce::MathConstants<float>::sqrt2;
+    }
+
+    /**
+    * add the rendered block to all the channels of the output buffer
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+    * @param startSample (int) position of the first sample in outputBuffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param gain (float) gain applied while mixing
+    */
+    void mixInto(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, float gain = 1.0f)
+    {
+        int numChannels = outputBuffer.getNumChannels();
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            addChannel(outputBuffer, chan, block, startSample, numSamples, gain);
+        }
+
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
+    }
+
+    /**
+    * add the rendered stereo blocks to the output buffer, the left block to the first channel and the right block
+    * to the others ( both halved into a mono output )
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+    * @param startSample (int) position of the first sample in outputBuffer
+    * @param numSamples (int) number of samples rendered into the blocks
+    * @param gain (float) gain applied while mixing
+    */
+    void mixStereoInto(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, float gain = 1.0f)
+    {
+        int numChannels = outputBuffer.getNumChannels();
+
+        if (numChannels == 1)
+        {
+            addChannel(outputBuffer, 0, block, startSample, numSamples, gain * 0.5f);
+            addChannel(outputBuffer, 0, rightBlock, startSample, numSamples, gain * 0.5f);
+        }
+        else
+        {
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                addChannel(outputBuffer, chan, chan == 0 ? block : rightBlock, startSample, numSamples, gain);
+            }
+        }
+
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
+    }
+
+private:
+    /**
+    * add a block to one channel with the gain of the stereo position, ramped if the position changed
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+    * @param chan (int) channel of outputBuffer
+    * @param source (const float*) block to add
+    * @param startSample (int) position of the first sample in outputBuffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param gain (float) gain applied while mixing
+    */
+    void addChannel(juce::AudioBuffer<float>& outputBuffer, int chan, const float* source, int startSample, int numSamples, float gain)
+    {
+        int numChannels = outputBuffer.getNumChannels();
+        float* out = outputBuffer.getWritePointer(chan, startSample);
+
+        if (numChannels == 1 || chan > 1) // no stereo position for mono or extra channels
+        {
+            juce::FloatVectorOperations::addWithMultiply(out, source, gain, numSamples);
+            return;
+        }
+
+        float start = currentGains[chan] * gain;
+        float end = targetGains[chan] * gain;
+
+        if (start == end)
+        {
+            juce::FloatVectorOperations::addWithMultiply(out, source, end, numSamples);
+        }
+        else // the position changed, ramp over this block
+        {
+            float increment = (end - start) / numSamples;
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                out[i] += source[i] * (start + increment * i);
+            }
+        }
+    }
+
+    alignas(16) float block[maxBlockSize] = {};
+    alignas(16) float rightBlock[maxBlockSize] = {};
+    float currentGains[2] = { 1.0f, 1.0f };
+    float targetGains[2] = { 1.0f, 1.0f };
+};
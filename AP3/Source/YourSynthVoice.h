@@ -9,7 +9,8 @@
 
 #pragma once
 #include <JuceHeader.h>
-#include "Oscillator.h"
+#include "UnisonOscillator.h"
+#include "VoiceOutput.h"
 
 /**
 * YourSynthVoice class : generates sythesiser
@@ -42,9 +43,8 @@ public:
 
     void init(float sampleRate)
     {
-        // set sample rate for oscillators and envelop
-        osc.setSampleRate(sampleRate);
-        detuneOsc.setSampleRate(sampleRate);
+        // set sample rate for oscillator and envelop
+        unison.setSampleRate(sampleRate);
         env.setSampleRate(sampleRate);
 
         juce::ADSR::Parameters envParams;// create insatnce of ADSR envelop
@@ -60,6 +60,38 @@ public:
         detuneAmount = detuneInput;
     }
 
+    /**
+    * link the unison parameters
+    *
+    * @param voicesInput (std::atomic<float>*) number of detuned saws (1 - UnisonOscillator::maxVoices)
+    * @param widthInput (std::atomic<float>*) stereo spread of the saws (0 - 1)
+    */
+    void setUnisonPointers(std::atomic<float>* voicesInput, std::atomic<float>* widthInput)
+    {
+        unisonVoices = voicesInput;
+        unisonWidth = widthInput;
+    }
+
+    /**
+    * link the level parameter
+    *
+    * @param levelInput (std::atomic<float>*) output level of the voice (0 - 1)
+    */
+    void setLevelPointer(std::atomic<float>* levelInput)
+    {
+        level = levelInput;
+    }
+
+    /**
+    * set the stereo position of the voice
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        output.setStereoPosition(pan);
+    }
+
     //--------------------------------------------------------------------------
     /**
      What should be done when a note starts
@@ -76,9 +108,9 @@ public:
 
         freq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
 
-        // set freqeuncies 
-        osc.setFrequency(freq);
-        detuneOsc.setFrequency(freq - *detuneAmount);
+        // set freqeuncies, the saws start with their phases spread
+        updateUnison();
+        unison.resetPhases();
 
         env.reset(); // can delete this if we dont want it to reset
         env.noteOn();
@@ -117,26 +149,24 @@ public:
      */
     void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
     {
+        // if we modulate the detune amount with an lfo, we need to put this inside the dsp loop
+        updateUnison();
+        float gain = 0.5f * (level != nullptr ? (float) *level : 1.0f);
 
-        if (playing) // check to see if this voice should be playing
+        // render in chunks of the scratch block size, as long as this voice should be playing
+        while (playing && numSamples > 0)
         {
-            // if we modulate the detune amount with an lfo, we need to put this inside the dsp loop
-            detuneOsc.setFrequency(freq - *detuneAmount); 
-
-            // DSP loop (from startSample up to startSample + numSamples)
-            for (int sampleIndex = startSample;   sampleIndex < (startSample+numSamples);   sampleIndex++)
+            int blockSize = juce::jmin(numSamples, VoiceOutput::maxBlockSize);
+            float* left = output.getBlock();
+            float* right = output.getRightBlock();
+            float envelope[VoiceOutput::maxBlockSize];
+            int rendered = 0;
+
+            // envelope loop, stops where the note ends
+            for (; rendered < blockSize && playing; rendered++)
             {
-
                 float envVal = env.getNextSample();
-
-                float currentSample = (osc.process() + detuneOsc.process()) * 0.5f * envVal; // apply envelop to oscillator
-                
-                // for each channel, write the currentSample float to the output
-                for (int chan = 0; chan<outputBuffer.getNumChannels(); chan++)
-                {
-                    // The output sample is scaled by 0.2 so that it is not too loud by default
-                    outputBuffer.addSample (chan, sampleIndex, currentSample * 0.5);
-                }
+                envelope[rendered] = envVal;
 
                 if (ending)
                 {
@@ -147,6 +177,16 @@ public:
                     }
                 }
             }
+
+            // all the saws at once (stereo, into the scratch blocks), then apply envelop
+            unison.process(left, right, rendered);
+            juce::FloatVectorOperations::multiply(left, envelope, rendered);
+            juce::FloatVectorOperations::multiply(right, envelope, rendered);
+
+            // add the blocks to the channels, scaled by the level and by 0.5 so that it is not too loud
+            output.mixStereoInto(outputBuffer, startSample, rendered, gain);
+            startSample += rendered;
+            numSamples -= rendered;
         }
     }
     //--------------------------------------------------------------------------
@@ -162,7 +202,7 @@ public:
      */
     bool canPlaySound (juce::SynthesiserSound* sound) override
     {
-        return dynamic_cast<MySynthVoice*> (sound) != nullptr;
+        return dynamic_cast<MySynthSound*> (sound) != nullptr;
     }
 
     void linkParameters(std::atomic<float>* ptrToParam)
@@ -171,6 +211,20 @@ public:
     }
     //--------------------------------------------------------------------------
 private:
+    /**
+    * read the unison parameters into the oscillator, once per block
+    */
+    void updateUnison()
+    {
+        if (unisonVoices != nullptr)
+            unison.setNumVoices((int) *unisonVoices);
+
+        if (unisonWidth != nullptr)
+            unison.setStereoWidth(*unisonWidth);
+
+        unison.setFrequency(freq, detuneAmount != nullptr ? (float) *detuneAmount : 0.0f);
+    }
+
     //--------------------------------------------------------------------------
     bool playing = false; // set default value for playing to be false
     bool ending = false; // bool to determine the moment the note is released
@@ -180,10 +234,13 @@ private:
     juce::Random random; //a random object for use in our test noise function
     std::atomic<float>* releaseParam;
 
-    // Oscillators
-    SineOsc osc;
-    TriOsc detuneOsc;
+    // Oscillator
+    UnisonOscillator unison; // detuned saws, all processed together
+    VoiceOutput output; // stereo scratch blocks the voice renders into
 
-    std::atomic<float>* detuneAmount;
-    float freq;
+    std::atomic<float>* detuneAmount = nullptr;
+    std::atomic<float>* unisonVoices = nullptr;
+    std::atomic<float>* unisonWidth = nullptr;
+    std::atomic<float>* level = nullptr;
+    float freq = 440.0f;
 };
@@ -0,0 +1,378 @@
+/*
+  ==============================================================================
+
+    BlockEnvelope.h
+
+    Contains class BlockEnvelope
+
+    ADSR envelope generator that renders whole blocks. A stage is a segment of
+    known length from a start level to an end level, so there is no state check
+    for every sample as with juce::ADSR, only at the ends of the segments
+
+    The state of several envelopes is stored as arrays ( lanes ), one lane per
+    voice of a layer, and process() renders the envelopes of several voices
+    together. Every sample runs the same plain loop over all maxLanes lanes,
+    which the compiler turns into a few vector instructions. Both curves are one
+    formula, level = (level - target) * coefficient + target + step ( a linear
+    segment has a coefficient of 1, an exponential one a step of 0 ), and lanes
+    that do not move ( idle, sustaining or not rendered ) are masked by running
+    with a coefficient of 1 and a step of 0, so there is no branch per lane. The
+    block is cut where the next segment of a rendered lane ends, and the stage
+    changes are made between the cuts
+
+    A released envelope knows in advance the sample where it drops below the
+    silence threshold, process() returns it so a voice stops there without
+    checking its samples. The linear curves follow juce::ADSR ( the release takes
+    the release time from any level )
+
+    Requires <JuceHeader.h> for jassert and jmin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+
+/**
+* block based ADSR envelopes, one per lane
+*
+* @param lane (int) index of the envelope
+* @param sampleRate (double) sample rate in Hz
+* @param parameters (const BlockEnvelope::Parameters&) times in seconds, sustain level and curves
+* @param lanes (const int*) indices of the envelopes to render
+* @param dests (float* const*) one block per rendered envelope
+* @param ends (int*) samples until each rendered envelope is silent, numSamples if it is still playing
+* @param numSamples (int) number of samples
+*/
+class BlockEnvelope
+{
+public:
+    static constexpr int maxLanes = 8;
+    static constexpr float silenceThreshold = 0.0001f;  // a released envelope ends below this level
+    static constexpr float attackRatio = 0.3f;          // overshoot of the exponential attack ( a larger ratio is closer to linear )
+    static constexpr float decayRatio = 0.001f;         // overshoot of the exponential decay and release
+
+    enum Curve { linear = 0, exponential };
+
+    struct Parameters
+    {
+        float attack = 0.1f;    // seconds
+        float decay = 0.1f;     // seconds
+        float sustain = 1.0f;   // level (0 - 1)
+        float release = 0.1f;   // seconds
+        Curve attackCurve = linear;
+        Curve decayCurve = linear;
+        Curve releaseCurve = linear;
+    };
+
+    /**
+    * set the sample rate of a lane
+    *
+    * @param lane (int) index of the envelope
+    * @param sampleRate (double) sample rate in Hz
+    */
+    void setSampleRate(int lane, double sampleRate)
+    {
+        jassert(lane < maxLanes);
+        sampleRates[lane] = (float) sampleRate;
+    }
+
+    /**
+    * set the parameters of a lane, used from the next stage on
+    *
+    * @param lane (int) index of the envelope
+    * @param _parameters (const Parameters&) times in seconds, sustain level and curves
+    */
+    void setParameters(int lane, const Parameters& _parameters)
+    {
+        parameters[lane] = _parameters;
+    }
+
+    /**
+    * stop a lane and set its level to zero
+    *
+    * @param lane (int) index of the envelope
+    */
+    void reset(int lane)
+    {
+        stages[lane] = idle;
+        levels[lane] = 0.0f;
+        remaining[lane] = 0;
+    }
+
+    /**
+    * start the attack of a lane from its current level
+    *
+    * @param lane (int) index of the envelope
+    */
+    void noteOn(int lane)
+    {
+        startStage(lane, attack);
+    }
+
+    /**
+    * start the release of a lane, it takes the release time from the current level
+    *
+    * @param lane (int) index of the envelope
+    */
+    void noteOff(int lane)
+    {
+        if (stages[lane] != idle)
+            startStage(lane, release);
+    }
+
+    /**
+    * returns true until a released lane is silent
+    *
+    * @param lane (int) index of the envelope
+    */
+    bool isActive(int lane) const
+    {
+        return stages[lane] != idle;
+    }
+
+    /**
+    * returns the level of the last sample of a lane
+    *
+    * @param lane (int) index of the envelope
+    */
+    float getLevel(int lane) const
+    {
+        return levels[lane];
+    }
+
+    /**
+    * render a block of several lanes together
+    *
+    * @param lanes (const int*) indices of the envelopes to render, each lane at most once
+    * @param numLanes (int) number of envelopes to render
+    * @param dests (float* const*) one block per rendered envelope, in the order of lanes
+    * @param ends (int*) for every rendered envelope: samples until it is silent ( the first sample below the
+    *        silence threshold is included ), numSamples if it plays to the end of the block
+    * @param numSamples (int) number of samples
+    */
+    void process(const int* lanes, int numLanes, float* const* dests, int* ends, int numSamples)
+    {
+        for (int a = 0; a < numLanes; a++)
+        {
+            ends[a] = stages[lanes[a]] == idle ? 0 : numSamples;
+        }
+
+        int i = 0;
+
+        while (i < numSamples)
+        {
+            // the moving lanes run their segment, every other lane keeps its level
+            // ( in double, a float level would drift over a long linear segment )
+            alignas(16) double runLevels[maxLanes];
+            alignas(16) double runTargets[maxLanes];
+            alignas(16) double runCoefficients[maxLanes];
+            alignas(16) double runSteps[maxLanes];
+            int length = numSamples - i;
+
+            for (int lane = 0; lane < maxLanes; lane++)
+            {
+                runLevels[lane] = levels[lane];
+                runTargets[lane] = 0.0;
+                runCoefficients[lane] = 1.0;
+                runSteps[lane] = 0.0;
+            }
+
+            for (int a = 0; a < numLanes; a++)
+            {
+                int lane = lanes[a];
+
+                if (isMoving(lane))
+                {
+                    runTargets[lane] = targets[lane];
+                    runCoefficients[lane] = coefficients[lane];
+                    runSteps[lane] = steps[lane];
+                    length = juce::jmin(length, remaining[lane]);
+                }
+            }
+
+            // every lane at once, up to the first end of a segment
+            for (int j = i; j < i + length; j++)
+            {
+                for (int lane = 0; lane < maxLanes; lane++)
+                {
+                    runLevels[lane] = (runLevels[lane] - runTargets[lane]) * runCoefficients[lane] + runTargets[lane] + runSteps[lane];
+                }
+
+                for (int a = 0; a < numLanes; a++)
+                {
+                    dests[a][j] = (float) runLevels[lanes[a]];
+                }
+            }
+
+            for (int lane = 0; lane < maxLanes; lane++)
+            {
+                levels[lane] = (float) runLevels[lane];
+            }
+
+            i += length;
+
+            // stage changes of the lanes whose segment ended
+            for (int a = 0; a < numLanes; a++)
+            {
+                int lane = lanes[a];
+
+                if (! isMoving(lane))
+                    continue;
+
+                remaining[lane] -= length;
+
+                if (remaining[lane] > 0)
+                    continue;
+
+                if (stages[lane] == release)
+                {
+                    stages[lane] = idle; // the last sample written is the first silent one
+                    levels[lane] = 0.0f;
+                    ends[a] = i;
+                    continue;   // the next samples of the lane are written at level 0
+                }
+
+                levels[lane] = endLevels[lane];
+                dests[a][i - 1] = endLevels[lane];
+                startStage(lane, stages[lane] + 1);
+            }
+        }
+    }
+
+    /**
+    * render a block of a lane
+    *
+    * @param lane (int) index of the envelope
+    * @param dest (float*) block to write the envelope into
+    * @param numSamples (int) number of samples
+    * @return samples until the lane is silent ( the first sample below the silence threshold is included ),
+    *         numSamples if the lane plays to the end of the block
+    */
+    int process(int lane, float* dest, int numSamples)
+    {
+        int end = 0;
+        process(&lane, 1, &dest, &end, numSamples);
+        return end;
+    }
+
+private:
+    enum Stage { idle = 0, attack, decay, sustain, release };
+
+    /**
+    * start a stage of a lane, stages with no time are skipped
+    *
+    * @param lane (int) index of the envelope
+    * @param stage (int) BlockEnvelope::Stage
+    */
+    void startStage(int lane, int stage)
+    {
+        const Parameters& p = parameters[lane];
+        float sampleRate = sampleRates[lane];
+        float level = levels[lane];
+        stages[lane] = stage;
+
+        if (stage == attack)
+        {
+            if (p.attack <= 0.0f || level >= 1.0f) // straight to the peak
+            {
+                levels[lane] = 1.0f;
+                startStage(lane, decay);
+                return;
+            }
+
+            // same rate as juce::ADSR, the attack takes its whole time from zero
+            startSegment(lane, 1.0f, (1.0f - level) * p.attack * sampleRate, p.attackCurve, attackRatio);
+        }
+        else if (stage == decay)
+        {
+            if (p.decay <= 0.0f || p.sustain >= 1.0f)
+            {
+                startStage(lane, sustain);
+                return;
+            }
+
+            startSegment(lane, p.sustain, p.decay * sampleRate, p.decayCurve, decayRatio);    // from the peak, as juce::ADSR
+        }
+        else if (stage == sustain)
+        {
+            levels[lane] = p.sustain;
+        }
+        else if (stage == release)
+        {
+            if (p.release <= 0.0f || level < silenceThreshold)
+            {
+                startSegment(lane, 0.0f, 1.0f, linear, decayRatio); // one silent sample
+                return;
+            }
+
+            startSegment(lane, 0.0f, p.release * sampleRate, p.releaseCurve, decayRatio);
+
+            // the release ends on the first sample below the silence threshold
+            if (curves[lane] == linear)
+            {
+                remaining[lane] = juce::jmin(remaining[lane], (int) ((level - silenceThreshold) / -steps[lane]) + 1);
+            }
+            else
+            {
+                float ratio = (silenceThreshold - targets[lane]) / (level - targets[lane]);
+                remaining[lane] = juce::jmin(remaining[lane], (int) (std::log(ratio) / std::log(coefficients[lane])) + 1);
+            }
+        }
+    }
+
+    /**
+    * start a segment from the current level of a lane
+    *
+    * @param lane (int) index of the envelope
+    * @param end (float) level at the end of the segment
+    * @param numSamples (float) length of the segment in samples
+    * @param curve (Curve) linear or exponential
+    * @param ratio (float) overshoot of the exponential curve, relative to the size of the segment
+    */
+    void startSegment(int lane, float end, float numSamples, Curve curve, float ratio)
+    {
+        float start = levels[lane];
+        int length = juce::jmax(1, (int) std::ceil(numSamples));
+
+        endLevels[lane] = end;
+        curves[lane] = curve;
+        remaining[lane] = length;
+
+        if (curve == linear) // a step every sample
+        {
+            steps[lane] = (end - start) / length;
+            targets[lane] = 0.0f;
+            coefficients[lane] = 1.0f;
+        }
+        else // the curve heads for a target beyond the end level and reaches the end level after length samples
+        {
+            steps[lane] = 0.0f;
+            targets[lane] = end + (end - start) * ratio;
+            coefficients[lane] = std::pow(ratio / (1.0f + ratio), 1.0f / length);
+        }
+    }
+
+    /**
+    * returns true while a lane is in a segment ( attack, decay or release )
+    *
+    * @param lane (int) index of the envelope
+    */
+    bool isMoving(int lane) const
+    {
+        return stages[lane] != idle && stages[lane] != sustain;
+    }
+
+    // state of the lanes
+    int stages[maxLanes] = {};
+    int remaining[maxLanes] = {};       // samples left in the current segment
+    int curves[maxLanes] = {};
+    alignas(16) float levels[maxLanes] = {};
+    alignas(16) float endLevels[maxLanes] = {};
+    alignas(16) float steps[maxLanes] = {};         // linear: change per sample ( 0 for exponential )
+    alignas(16) float targets[maxLanes] = {};       // exponential: level the curve heads for ( 0 for linear )
+    alignas(16) float coefficients[maxLanes] = {};  // exponential: distance to the target kept per sample ( 1 for linear )
+    float sampleRates[maxLanes] = { 44100.0f, 44100.0f, 44100.0f, 44100.0f, 44100.0f, 44100.0f, 44100.0f, 44100.0f };
+    Parameters parameters[maxLanes];
+};
@@ -0,0 +1,232 @@
+//  ControlRate.h
+//
+//  Control rate evaluation of slow modulators. A slow source (an lfo, a slow
+//  frequency or phase modulation) is evaluated once every interval samples and
+//  the samples in between are a linear ramp towards the next value, so the
+//  sin() and pow() calls of the source run once per interval instead of once
+//  per sample
+//
+//  A modulator is marked as control rate by its type:
+//  ControlRate<SineOsc> is an lfo with the SineOsc functions, and
+//  ControlRateModulation<RampPhaseModulation> is a modulation policy for
+//  OscillatorStack. The source needs skip(int numSamples), which moves it
+//  numSamples forward and returns its value at the new position
+//
+//  Requires nothing outside the standard library
+
+
+#ifndef ControlRate_h
+#define ControlRate_h
+
+/**
+* linear ramp between values of a source evaluated every interval samples
+*
+* @param numSamples (int) samples between two evaluations of the source
+* @param evaluate (Evaluate) moves the source forward by a number of samples and returns its value ( float(int) )
+* @param dest (float*) block to write the ramp into
+* @return next() (float) value of the ramp for the next sample
+*/
+class ControlRateRamp
+{
+public:
+    static constexpr int defaultInterval = 32;
+
+    /**
+    * set the number of samples between two evaluations of the source, a new ramp starts from the current value
+    *
+    * @param numSamples (int) samples between two evaluations
+    */
+    void setInterval(int numSamples)
+    {
+        interval = (numSamples > 1) ? numSamples : 1;
+        countdown = 0;
+    }
+
+    /**
+    * returns the number of samples between two evaluations of the source
+    */
+    int getInterval() const
+    {
+        return interval;
+    }
+
+    /**
+    * start again from the value of the source at its current position ( after the source was reset or moved )
+    */
+    void restart()
+    {
+        primed = false;
+        countdown = 0;
+    }
+
+    /**
+    * returns the value of the ramp for the next sample
+    *
+    * @param evaluate (Evaluate) moves the source forward by a number of samples and returns its value
+    */
+    template <typename Evaluate>
+    float next(Evaluate evaluate)
+    {
+        if (countdown == 0)
+            startSegment(evaluate);
+
+        countdown--;
+        value = (countdown == 0) ? target : value + step; // the end of a ramp is the exact value of the source
+        return value;
+    }
+
+    /**
+    * render a block of the ramp
+    *
+    * @param dest (float*) block to write the ramp into
+    * @param numSamples (int) number of samples
+    * @param evaluate (Evaluate) moves the source forward by a number of samples and returns its value
+    */
+    template <typename Evaluate>
+    void process(float* dest, int numSamples, Evaluate evaluate)
+    {
+        int i = 0;
+
+        while (i < numSamples)
+        {
+            if (countdown == 0)
+                startSegment(evaluate);
+
+            int length = (countdown < numSamples - i) ? countdown : numSamples - i;
+            float start = value;
+
+            for (int j = 0; j < length; j++)
+            {
+                dest[i + j] = start + step * (j + 1);
+            }
+
+            i += length;
+            countdown -= length;
+            value = (countdown == 0) ? target : start + step * length;
+        }
+    }
+
+private:
+    /**
+    * evaluate the source at the end of the next interval and ramp towards it
+    *
+    * @param evaluate (Evaluate) moves the source forward by a number of samples and returns its value
+    */
+    template <typename Evaluate>
+    void startSegment(Evaluate& evaluate)
+    {
+        if (! primed) // first value, the source is not moved
+        {
+            value = evaluate(0);
+            primed = true;
+        }
+
+        target = evaluate(interval);
+        step = (target - value) / interval;
+        countdown = interval;
+    }
+
+    int interval = defaultInterval;
+    int countdown = 0;      // samples left in the current ramp
+    bool primed = false;    // false until the first value of the source is known
+    float value = 0.0f;     // value of the last sample
+    float target = 0.0f;    // value of the source at the end of the current ramp
+    float step = 0.0f;      // change of the value for every sample
+};
+
+/**
+* control rate version of a frequency or phase modulation policy of OscillatorStack
+*
+* @param Modulation policy with next(), reset() and skip(int numSamples)
+* @param numSamples (int) samples between two evaluations of the modulation
+* @return next() (float) modulation for the next sample
+*/
+template <typename Modulation>
+struct ControlRateModulation : public Modulation
+{
+    float next()
+    {
+        return ramp.next([this] (int numSamples) { return Modulation::skip(numSamples); });
+    }
+
+    float skip(int numSamples)
+    {
+        ramp.restart();
+        return Modulation::skip(numSamples);
+    }
+
+    void reset()
+    {
+        Modulation::reset();
+        ramp.restart();
+    }
+
+    /**
+    * set the number of samples between two evaluations of the modulation
+    *
+    * @param numSamples (int) samples between two evaluations
+    */
+    void setInterval(int numSamples)
+    {
+        ramp.setInterval(numSamples);
+    }
+
+    ControlRateRamp ramp;
+};
+
+/**
+* control rate version of an oscillator used as a modulator ( lfo ), keeps the functions of the oscillator
+*
+* @param Osc oscillator with process(), reset() and skip(int numSamples), e.g. SineOsc
+* @param numSamples (int) samples between two evaluations of the oscillator
+* @param dest (float*) block to write the output into
+* @return process() (float) output of the oscillator, ramped between evaluations
+*/
+template <typename Osc>
+class ControlRate : public Osc
+{
+public:
+
+    /**
+    * outputs the ramp and moves one sample
+    */
+    float process()
+    {
+        return ramp.next([this] (int numSamples) { return Osc::skip(numSamples); });
+    }
+
+    /**
+    * render a block of the ramp
+    *
+    * @param dest (float*) block to write the output into
+    * @param numSamples (int) number of samples
+    */
+    void process(float* dest, int numSamples)
+    {
+        ramp.process(dest, numSamples, [this] (int n) { return Osc::skip(n); });
+    }
+
+    /**
+    * restart the oscillator from phase zero
+    */
+    void reset()
+    {
+        Osc::reset();
+        ramp.restart();
+    }
+
+    /**
+    * set the number of samples between two evaluations of the oscillator
+    *
+    * @param numSamples (int) samples between two evaluations
+    */
+    void setInterval(int numSamples)
+    {
+        ramp.setInterval(numSamples);
+    }
+
+private:
+    ControlRateRamp ramp;
+};
+
+#endif /* ControlRate_h */
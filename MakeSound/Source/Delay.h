@@ -5,10 +5,13 @@
     
 	Contains class Delay
 
+	Requires <vector> for the memory of the delay line
+
   ==============================================================================
 */
 
 #pragma once
+#include <vector>
 
 /**
 * outputs the delayed sample ( process() )
@@ -85,15 +88,81 @@ public:
 	void setSize(int sizeInSamples)
 	{
 		size = sizeInSamples;
-		buffer = new float[size];
+		memory.assign(size, 0.0f);	// the memory is reused if it is already big enough
+		buffer = memory.data();
+		readPos = 0;
+		writePos = 0;
+	}
+
+
+	/**
+	* use memory owned by someone else ( e.g. a slice of a DspArena ) for the delay line
+	* 
+	* @param memory (float*) sizeInSamples floats, set to zero
+	* @param sizeInSamples (int) size of the delay line in samples
+	*/
+	void setBuffer(float* memory, int sizeInSamples)
+	{
+		size = sizeInSamples;
+		buffer = memory;
+		readPos = 0;
+		writePos = 0;
+	}
 
-		// initialise all values to zero
+	/**
+	* set all the samples of the delay line to zero
+	*/
+	void clear()
+	{
 		for (int i = 0; i < size; i++)
 		{
 			buffer[i] = 0.0;
 		}
 	}
 
+	/**
+	* returns the size of the delay line in samples
+	*/
+	int getSize() const
+	{
+		return size;
+	}
+
+	/**
+	* copy the delay line and its positions ( dest holds getSize() samples )
+	* 
+	* @param dest (float*) samples of the delay line
+	* @param _readPos (int&) read position
+	* @param _writePos (int&) write position
+	*/
+	void copyTo(float* dest, int& _readPos, int& _writePos) const
+	{
+		for (int i = 0; i < size; i++)
+		{
+			dest[i] = buffer[i];
+		}
+
+		_readPos = readPos;
+		_writePos = writePos;
+	}
+
+	/**
+	* restore the delay line and its positions from a copy of the same size
+	* 
+	* @param source (const float*) samples of the delay line
+	* @param _readPos (int) read position
+	* @param _writePos (int) write position
+	*/
+	void copyFrom(const float* source, int _readPos, int _writePos)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			buffer[i] = source[i];
+		}
+
+		readPos = _readPos;
+		writePos = _writePos;
+	}
 
 	/**
 	* set the delay time 
@@ -113,8 +182,9 @@ public:
 	}
 
 private:
-	float* buffer;		// set the buffer size
-	int size;
+	std::vector<float> memory;	// memory of the delay line when it is not set with setBuffer()
+	float* buffer = nullptr;	// delay line
+	int size = 0;
 	int readPos = 0;
 	int writePos = 0;
 	int delayTimeInSamples;
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    DspArena.h
+
+    Contains class DspArena
+
+    One block of memory for the delay lines of a plugin instance. The processor
+    adds up what the delays need, the block is allocated once in
+    prepareToPlay() and each delay takes a slice of it. Every slice starts on a
+    cache line, so no two delay lines share a line
+
+    Preparing again with the same or a smaller size reuses the block
+
+    Requires <JuceHeader.h> for jassert
+    Requires <vector> for the memory
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <cstdint>
+
+/**
+* arena of float memory handed out in cache line aligned slices
+*
+* @param numFloats (size_t) number of floats of a slice, or of all the slices
+* @return take(size_t numFloats) (float*) slice of the arena, set to zero
+* @return getSizeInBytes() (size_t) memory held by the arena
+*/
+class DspArena
+{
+public:
+    static constexpr size_t alignment = 64;                         // bytes, one cache line
+    static constexpr size_t floatsPerLine = alignment / sizeof(float);
+
+    /**
+    * returns the number of floats a slice takes in the arena ( rounded up to whole cache lines )
+    *
+    * @param numFloats (size_t) number of floats of the slice
+    */
+    static size_t getSliceSize(size_t numFloats)
+    {
+        return (numFloats + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    }
+
+    /**
+    * allocate the arena for the slices ( or reuse it if it is big enough ) and hand out slices from the start again
+    * called in prepareToPlay(), the slices taken before are no longer valid
+    *
+    * @param numFloats (size_t) sum of getSliceSize() of all the slices
+    */
+    void prepare(size_t numFloats)
+    {
+        if (numFloats + floatsPerLine > memory.size())
+            memory.assign(numFloats + floatsPerLine, 0.0f); // room to align the start
+        else
+            std::fill(memory.begin(), memory.end(), 0.0f);
+
+        // first float on a cache line boundary
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(memory.data());
+        start = memory.data() + ((alignment - address % alignment) % alignment) / sizeof(float);
+
+        capacity = numFloats;
+        used = 0;
+    }
+
+    /**
+    * returns the next slice of the arena, set to zero
+    *
+    * @param numFloats (size_t) number of floats of the slice
+    */
+    float* take(size_t numFloats)
+    {
+        size_t sliceSize = getSliceSize(numFloats);
+        jassert(used + sliceSize <= capacity); // prepare() was called with less memory than the slices need
+
+        float* slice = start + used;
+        used += sliceSize;
+        return slice;
+    }
+
+    /**
+    * returns the memory held by the arena in bytes
+    */
+    size_t getSizeInBytes() const
+    {
+        return memory.capacity() * sizeof(float);
+    }
+
+private:
+    std::vector<float> memory;
+    float* start = nullptr;     // first aligned float of memory
+    size_t capacity = 0;        // floats available for the slices
+    size_t used = 0;            // floats handed out
+};
@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    FDNReverb.h
+
+    Contains class FDNReverb
+
+    8-line feedback delay network reverb. The delay lines are processed together
+    as lanes (one element per line) so the per-line maths is vectorised, the lines
+    are mixed with a Householder matrix and the room size is smoothed per sample
+
+    The network is bypassed while its input is silent and its tail has decayed
+
+    Requires <JuceHeader.h> for SmoothedValue
+    Requires <vector> for the delay memory
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+* feedback delay network reverb with 8 delay lines
+*
+* the room size only sets the feedback gain of the network, so it can be smoothed
+* every sample without recomputing any filter coefficients
+*
+* @return getTailLengthSeconds() (double) time for the tail to decay by 60 dB
+*
+* @param sampleRate (double) sample rate in Hz
+* @param _roomSize (float) size of the room (0 - 1)
+* @param _dryLevel (float) level of the dry signal
+* @param _wetLevel (float) level of the reverberated signal
+* @param left (float*) left channel, processed in place
+* @param right (float*) right channel, processed in place
+*/
+class FDNReverb
+{
+public:
+    static constexpr int numLines = 8;
+
+    /**
+    * set the sample rate and allocate the delay lines - needs to be called before processStereo()
+    *
+    * @param sampleRate (double) sample rate in Hz
+    */
+    void prepare(double sampleRate)
+    {
+        // mutually prime line lengths at 44.1 kHz, scaled to the current sample rate
+        const int baseLengths[numLines] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+
+        int totalLength = 0;
+        sr = sampleRate;
+
+        for (int i = 0; i < numLines; i++)
+        {
+            lengths[i] = juce::jmax(1, (int)(baseLengths[i] * sampleRate / 44100.0));
+            offsets[i] = totalLength;
+            totalLength += lengths[i];
+        }
+
+        meanLength = totalLength / (double) numLines;
+
+        memory.assign(totalLength, 0.0f); // one block of memory for all lines
+
+        smoothFeedback.reset(sampleRate, 1.0f);
+        smoothFeedback.setCurrentAndTargetValue(roomToFeedback(roomSize));
+
+        reset();
+    }
+
+    /**
+    * returns the memory of the delay lines in bytes
+    */
+    size_t getSizeInBytes() const
+    {
+        return memory.capacity() * sizeof(float);
+    }
+
+    /**
+    * clear the delay lines and the damping filters
+    */
+    void reset()
+    {
+        std::fill(memory.begin(), memory.end(), 0.0f);
+
+        for (int i = 0; i < numLines; i++)
+        {
+            positions[i] = 0;
+            damped[i] = 0.0f;
+        }
+
+        tailLevel = 0.0f;
+    }
+
+    /**
+    * returns the time in seconds for the tail to decay by 60 dB at the current room size
+    * ( the Householder matrix keeps the energy, so every pass through a line is scaled by the feedback gain )
+    */
+    double getTailLengthSeconds() const
+    {
+        double loopTime = meanLength / sr;
+        return loopTime * std::log(0.001) / std::log((double) smoothFeedback.getTargetValue());
+    }
+
+    /**
+    * set the room size, the change is smoothed per sample in processStereo()
+    *
+    * @param _roomSize (float) size of the room (0 - 1)
+    */
+    void setRoomSize(float _roomSize)
+    {
+        roomSize = _roomSize;
+        smoothFeedback.setTargetValue(roomToFeedback(roomSize));
+    }
+
+    /**
+    * set the dry and wet levels
+    *
+    * @param _dryLevel (float) level of the dry signal
+    * @param _wetLevel (float) level of the reverberated signal
+    */
+    void setDryWet(float _dryLevel, float _wetLevel)
+    {
+        dryLevel = _dryLevel * dryScale;
+        wetLevel = _wetLevel * wetScale;
+    }
+
+    /**
+    * set the damping of the high frequencies in the feedback path
+    *
+    * @param _damping (float) 0 - no damping, 1 - maximum damping
+    */
+    void setDamping(float _damping)
+    {
+        damping = juce::jlimit(0.0f, 0.95f, _damping * 0.4f);
+    }
+
+    /**
+    * add reverb to a stereo signal
+    *
+    * @param left (float*) left channel, processed in place
+    * @param right (float*) right channel, processed in place
+    * @param numSamples (int) number of samples to process
+    */
+    void processStereo(float* left, float* right, int numSamples)
+    {
+        // skip the network while the input is silent and the tail has died away
+        auto leftRange = juce::FloatVectorOperations::findMinAndMax(left, numSamples);
+        auto rightRange = juce::FloatVectorOperations::findMinAndMax(right, numSamples);
+        float inputLevel = juce::jmax(-leftRange.getStart(), leftRange.getEnd(), juce::jmax(-rightRange.getStart(), rightRange.getEnd()));
+
+        if (inputLevel < silenceThreshold && tailLevel < silenceThreshold)
+        {
+            if (! bypassed)
+            {
+                reset();
+                bypassed = true;
+            }
+
+            smoothFeedback.skip(numSamples);
+            return;
+        }
+
+        bypassed = false;
+        tailLevel = 0.0f;
+
+        alignas(16) float input[numLines];
+        alignas(16) float mixed[numLines];
+
+        for (int sample = 0; sample < numSamples; sample++)
+        {
+            float feedback = smoothFeedback.getNextValue();
+            float inL = left[sample] * inputGain;
+            float inR = right[sample] * inputGain;
+
+            // read the end of every line and damp it (one lane per line)
+            for (int i = 0; i < numLines; i++)
+            {
+                float lineOut = memory[offsets[i] + positions[i]];
+                damped[i] = lineOut + (damped[i] - lineOut) * damping;
+            }
+
+            // output taps - two orthogonal rows of a Hadamard matrix
+            float wetL = 0.0f;
+            float wetR = 0.0f;
+            float sum = 0.0f;
+
+            for (int i = 0; i < numLines; i++)
+            {
+                wetL += damped[i] * leftSigns[i];
+                wetR += damped[i] * rightSigns[i];
+                sum += damped[i];
+            }
+
+            // Householder mixing: mixed = damped - 2 / N * sum(damped)
+            float householder = sum * (2.0f / numLines);
+
+            for (int i = 0; i < numLines; i++)
+            {
+                input[i] = (i & 1) ? inR : inL; // left feeds the even lines, right feeds the odd lines
+                mixed[i] = (damped[i] - householder) * feedback + input[i];
+            }
+
+            // write back into the lines and advance
+            for (int i = 0; i < numLines; i++)
+            {
+                memory[offsets[i] + positions[i]] = mixed[i];
+                positions[i] = (positions[i] + 1 < lengths[i]) ? positions[i] + 1 : 0;
+            }
+
+            left[sample] = left[sample] * dryLevel + wetL * wetLevel;
+            right[sample] = right[sample] * dryLevel + wetR * wetLevel;
+            tailLevel = juce::jmax(tailLevel, std::abs(wetL) + std::abs(wetR));
+        }
+    }
+
+private:
+    /**
+    * maps the room size to the feedback gain of the network
+    *
+    * @param size (float) size of the room (0 - 1)
+    */
+    static float roomToFeedback(float size)
+    {
+        return size * 0.28f + 0.7f;
+    }
+
+    // parameters
+    float roomSize = 0.5f;
+    float damping = 0.2f;
+    float dryLevel = 0.8f * 2.0f;
+    float wetLevel = 0.3f * 3.0f;
+    juce::SmoothedValue<float> smoothFeedback; // feedback gain smoothed per sample
+
+    // same level scaling as juce::Reverb so the dry / wet values keep their balance
+    static constexpr float inputGain = 0.1f;
+    static constexpr float dryScale = 2.0f;
+    static constexpr float wetScale = 3.0f;
+    const float leftSigns[numLines] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+    const float rightSigns[numLines] = { 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+
+    // silence detection
+    static constexpr float silenceThreshold = 1.0e-5f;   // about -100 dB
+    float tailLevel = 0.0f;     // peak of the tail in the last block
+    bool bypassed = false;
+
+    // delay lines, one contiguous block shared by all lines
+    double sr = 44100.0;
+    double meanLength = 1.0;    // mean length of the lines in samples
+    std::vector<float> memory;
+    int lengths[numLines] = {};
+    int offsets[numLines] = {};
+    int positions[numLines] = {};
+    alignas(16) float damped[numLines] = {}; // state of the damping filter of each line
+};
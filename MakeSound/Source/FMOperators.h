@@ -0,0 +1,503 @@
+/*
+  ==============================================================================
+
+    FMOperators.h
+
+    Contains class OperatorEnvelope
+    Contains struct FMOperatorLanes
+    Contains the algorithm structs ( FMAlgorithmStack, FMAlgorithmBranch, ... )
+    Contains class FMEngine
+
+    4-operator FM engine. Every operator runs one lane for each note of a chord,
+    so the same operator graph plays all the notes of the chord at once
+
+    Each algorithm (the routing between the operators) is a struct, the render
+    loop is a template instantiated for every algorithm: the routing is fixed at
+    compile time and the inner loop has no branches. The algorithm is picked
+    once per note through a table of kernels
+
+    The operator envelopes are rendered a block at a time
+
+    Requires <JuceHeader.h> for FloatVectorOperations
+    Requires <cmath> for floor()
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+
+/**
+* attack / decay / sustain / release envelope rendered a block at a time
+* linear attack, exponential decay and release
+*
+* @param sampleRate (float) sample rate
+* @param attack (float) attack time in seconds
+* @param decay (float) decay time in seconds ( time constant )
+* @param sustain (float) sustain level (0 - 1)
+* @param release (float) release time in seconds ( time constant )
+* @param dest (float*) block to write the envelope into
+* @param numSamples (int) number of samples
+*/
+class OperatorEnvelope
+{
+public:
+    /**
+    * set the envelope parameters
+    *
+    * @param sampleRate (float) sample rate
+    * @param attack (float) attack time in seconds
+    * @param decay (float) decay time in seconds ( time constant )
+    * @param sustain (float) sustain level (0 - 1)
+    * @param release (float) release time in seconds ( time constant )
+    */
+    void setParameters(float sampleRate, float attack, float decay, float sustain, float release)
+    {
+        attackStep = 1.0f / juce::jmax(1.0f, attack * sampleRate);
+        decayCoeff = std::exp(-1.0f / juce::jmax(1.0f, decay * sampleRate));
+        releaseCoeff = std::exp(-1.0f / juce::jmax(1.0f, release * sampleRate));
+        sustainLevel = sustain;
+    }
+
+    /**
+    * start the attack from the current level
+    */
+    void noteOn()
+    {
+        state = attackState;
+    }
+
+    /**
+    * start the release
+    */
+    void noteOff()
+    {
+        state = releaseState;
+    }
+
+    /**
+    * silence the envelope
+    */
+    void reset()
+    {
+        state = idleState;
+        level = 0.0f;
+    }
+
+    /**
+    * render the envelope into a block
+    *
+    * @param dest (float*) block to write the envelope into
+    * @param numSamples (int) number of samples
+    */
+    void process(float* dest, int numSamples)
+    {
+        int i = 0;
+
+        while (i < numSamples)
+        {
+            if (state == attackState)
+            {
+                // number of samples left in the attack
+                int length = juce::jmin(numSamples - i, (int) std::ceil((1.0f - level) / attackStep));
+
+                for (int end = i + length; i < end; i++)
+                {
+                    level = juce::jmin(1.0f, level + attackStep);
+                    dest[i] = level;
+                }
+
+                if (level >= 1.0f || length <= 0)
+                {
+                    level = 1.0f;
+                    state = decayState;
+                }
+            }
+            else if (state == decayState) // exponential approach of the sustain level
+            {
+                for (; i < numSamples; i++)
+                {
+                    level = sustainLevel + (level - sustainLevel) * decayCoeff;
+                    dest[i] = level;
+                }
+            }
+            else if (state == releaseState) // exponential decay to zero
+            {
+                for (; i < numSamples; i++)
+                {
+                    level *= releaseCoeff;
+                    dest[i] = level;
+                }
+            }
+            else
+            {
+                juce::FloatVectorOperations::clear(dest + i, numSamples - i);
+                i = numSamples;
+            }
+        }
+    }
+
+private:
+    enum States { idleState, attackState, decayState, releaseState };
+    int state = idleState;
+    float level = 0.0f;
+    float attackStep = 0.001f;
+    float decayCoeff = 0.999f;
+    float sustainLevel = 1.0f;
+    float releaseCoeff = 0.999f;
+};
+
+/**
+* state of the operators, one lane per note of the chord
+*
+* @param op (int) index of the operator
+* @param lane (int) index of the note
+* @param i (int) index of the sample in the block
+* @param modulation (float) phase modulation in cycles
+*/
+struct FMOperatorLanes
+{
+    static constexpr int numOperators = 4;
+    static constexpr int numLanes = 4;
+
+    /**
+    * sine of a phase in cycles, branch free polynomial approximation ( error about 1e-6 )
+    *
+    * @param phase (float) phase in cycles ( any value )
+    */
+    static float fastSine(float phase)
+    {
+        float u = phase - std::floor(phase) - 0.5f;        // -0.5 to 0.5, sin(2 pi phase) = -sin(2 pi u)
+        float a = std::abs(u);
+        float r = (a > 0.25f) ? 0.5f - a : a;               // fold into -0.25 to 0.25
+        float x = ((u < 0.0f) ? -r : r) * juce::MathConstants<float>::twoPi;
+        float x2 = x * x;
+        float s = x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+        return -s;
+    }
+
+    /**
+    * run one sample of an operator and advance its phase
+    *
+    * @param op (int) index of the operator
+    * @param lane (int) index of the note
+    * @param i (int) index of the sample in the block
+    * @param modulation (float) phase modulation in cycles
+    */
+    float tick(int op, int lane, int i, float modulation)
+    {
+        float out = fastSine(phases[op][lane] * (1.0f / 4294967296.0f) + modulation) * gains[op][i];
+        phases[op][lane] += increments[op][lane]; // 32-bit fixed point, wraps around on its own
+        return out;
+    }
+
+    /**
+    * run one sample of the last operator, which modulates itself
+    *
+    * @param lane (int) index of the note
+    * @param i (int) index of the sample in the block
+    */
+    float feedbackTick(int lane, int i)
+    {
+        const int op = numOperators - 1;
+        float out = tick(op, lane, i, (feedbackHistory[0][lane] + feedbackHistory[1][lane]) * feedback);
+        feedbackHistory[1][lane] = feedbackHistory[0][lane];
+        feedbackHistory[0][lane] = out;
+        return out;
+    }
+
+    alignas(16) juce::uint32 phases[numOperators][numLanes] = {};       // phase, one cycle is the full range of juce::uint32
+    alignas(16) juce::uint32 increments[numOperators][numLanes] = {};   // frequency / sample rate in the same units
+    alignas(16) float feedbackHistory[2][numLanes] = {};        // last two outputs of the feedback operator
+    const float* gains[numOperators] = {};                      // envelope times level of every operator for the block
+    float feedback = 0.0f;                                      // self modulation of the last operator ( half the amount )
+};
+
+// algorithms - operator 1 is index 0, carriers are marked in carrierMask ( bit 0 - operator 1 )
+
+/** 4 -> 3 -> 2 -> 1 */
+struct FMAlgorithmStack
+{
+    static constexpr int carrierMask = 0x1;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        float op4 = ops.feedbackTick(lane, i);
+        float op3 = ops.tick(2, lane, i, op4);
+        float op2 = ops.tick(1, lane, i, op3);
+        return ops.tick(0, lane, i, op2);
+    }
+};
+
+/** 4 -> 3 -> 1, 2 -> 1 */
+struct FMAlgorithmBranch
+{
+    static constexpr int carrierMask = 0x1;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        float op4 = ops.feedbackTick(lane, i);
+        float op3 = ops.tick(2, lane, i, op4);
+        float op2 = ops.tick(1, lane, i, 0.0f);
+        return ops.tick(0, lane, i, op2 + op3);
+    }
+};
+
+/** 4 -> 3, 2 -> 1 */
+struct FMAlgorithmTwoStacks
+{
+    static constexpr int carrierMask = 0x5;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        float op4 = ops.feedbackTick(lane, i);
+        float op3 = ops.tick(2, lane, i, op4);
+        float op2 = ops.tick(1, lane, i, 0.0f);
+        return ops.tick(0, lane, i, op2) + op3;
+    }
+};
+
+/** 4 -> 1, 4 -> 2, 4 -> 3 */
+struct FMAlgorithmTripleCarrier
+{
+    static constexpr int carrierMask = 0x7;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        float op4 = ops.feedbackTick(lane, i);
+        return ops.tick(0, lane, i, op4) + ops.tick(1, lane, i, op4) + ops.tick(2, lane, i, op4);
+    }
+};
+
+/** 4 -> 3, 2, 1 */
+struct FMAlgorithmSingleModulator
+{
+    static constexpr int carrierMask = 0x7;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        float op4 = ops.feedbackTick(lane, i);
+        return ops.tick(0, lane, i, 0.0f) + ops.tick(1, lane, i, 0.0f) + ops.tick(2, lane, i, op4);
+    }
+};
+
+/** 4, 3, 2, 1 ( additive ) */
+struct FMAlgorithmAdditive
+{
+    static constexpr int carrierMask = 0xf;
+
+    static float process(FMOperatorLanes& ops, int lane, int i)
+    {
+        return ops.tick(0, lane, i, 0.0f) + ops.tick(1, lane, i, 0.0f) + ops.tick(2, lane, i, 0.0f) + ops.feedbackTick(lane, i);
+    }
+};
+
+/**
+* 4-operator FM engine playing up to 4 notes ( a chord ) with one operator graph
+*
+* @param sampleRate (float) sample rate of the engine
+* @param algorithm (int) index of the algorithm ( FMEngine::Algorithms )
+* @param frequencies (const float*) frequency of every note of the chord ( numLanes values )
+* @param ratios (const float*) frequency ratio of every operator ( numOperators values )
+* @param brightness (float) modulation index (0 - 1)
+* @param dest (float*) block to render into
+* @param numSamples (int) number of samples ( maxBlockSize at most )
+*/
+class FMEngine
+{
+public:
+    static constexpr int numOperators = FMOperatorLanes::numOperators;
+    static constexpr int numLanes = FMOperatorLanes::numLanes;
+    static constexpr int maxBlockSize = 1024;
+    enum Algorithms { stack = 0, branch, twoStacks, tripleCarrier, singleModulator, additive, numAlgorithms };
+
+    FMEngine()
+    {
+        setAlgorithm(twoStacks);
+    }
+
+    /**
+    * set the sample rate of the engine - called when the sample rate or the oversampling changes
+    *
+    * @param _sampleRate (float) sample rate of the engine
+    */
+    void prepare(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+        setEnvelopes();
+        reset();
+    }
+
+    /**
+    * clear the phases and the envelopes
+    */
+    void reset()
+    {
+        for (int op = 0; op < numOperators; op++)
+        {
+            envelopes[op].reset();
+
+            for (int lane = 0; lane < numLanes; lane++)
+                ops.phases[op][lane] = 0;
+        }
+
+        for (int lane = 0; lane < numLanes; lane++)
+        {
+            ops.feedbackHistory[0][lane] = 0.0f;
+            ops.feedbackHistory[1][lane] = 0.0f;
+        }
+    }
+
+    /**
+    * select the routing between the operators - called before noteOn()
+    *
+    * @param algorithm (int) index of the algorithm ( FMEngine::Algorithms )
+    */
+    void setAlgorithm(int algorithm)
+    {
+        switch (algorithm)
+        {
+            case stack:             useAlgorithm<FMAlgorithmStack>(); break;
+            case branch:            useAlgorithm<FMAlgorithmBranch>(); break;
+            case tripleCarrier:     useAlgorithm<FMAlgorithmTripleCarrier>(); break;
+            case singleModulator:   useAlgorithm<FMAlgorithmSingleModulator>(); break;
+            case additive:          useAlgorithm<FMAlgorithmAdditive>(); break;
+            default:                useAlgorithm<FMAlgorithmTwoStacks>(); break;
+        }
+
+        setEnvelopes();
+    }
+
+    /**
+    * set the notes of the chord and the frequency ratio of every operator
+    *
+    * @param frequencies (const float*) frequency of every note of the chord ( numLanes values )
+    * @param ratios (const float*) frequency ratio of every operator ( numOperators values )
+    */
+    void setFrequencies(const float* frequencies, const float* ratios)
+    {
+        for (int op = 0; op < numOperators; op++)
+        {
+            for (int lane = 0; lane < numLanes; lane++)
+                ops.increments[op][lane] = (juce::uint32) (juce::jmin(0.5, (double) frequencies[lane] * ratios[op] / sampleRate) * 4294967296.0);
+        }
+    }
+
+    /**
+    * set the modulation index of the modulators and the feedback of operator 4
+    *
+    * @param brightness (float) modulation index (0 - 1)
+    */
+    void setBrightness(float brightness)
+    {
+        modulationIndex = brightness * maxModulationIndex;
+        ops.feedback = brightness * 0.5f * maxFeedback;
+    }
+
+    /**
+    * start the envelopes of all the operators
+    */
+    void noteOn()
+    {
+        for (auto& envelope : envelopes)
+            envelope.noteOn();
+    }
+
+    /**
+    * release the envelopes of all the operators
+    */
+    void noteOff()
+    {
+        for (auto& envelope : envelopes)
+            envelope.noteOff();
+    }
+
+    /**
+    * render a block ( the sum of all the notes of the chord )
+    *
+    * @param dest (float*) block to render into
+    * @param numSamples (int) number of samples ( maxBlockSize at most )
+    */
+    void render(float* dest, int numSamples)
+    {
+        // envelopes for the whole block, scaled by the output level ( carriers ) or the modulation index ( modulators )
+        for (int op = 0; op < numOperators; op++)
+        {
+            float level = ((carrierMask >> op) & 1) ? carrierLevel : modulationIndex;
+            envelopes[op].process(gainBlocks[op], numSamples);
+            juce::FloatVectorOperations::multiply(gainBlocks[op], level, numSamples);
+            ops.gains[op] = gainBlocks[op];
+        }
+
+        kernel(ops, dest, numSamples);
+    }
+
+private:
+    using Kernel = void (*)(FMOperatorLanes&, float*, int);
+
+    /**
+    * render loop of one algorithm, the routing is resolved at compile time
+    *
+    * @param ops (FMOperatorLanes&) operator state
+    * @param dest (float*) block to render into
+    * @param numSamples (int) number of samples
+    */
+    template <typename Algorithm>
+    static void renderKernel(FMOperatorLanes& ops, float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            float sum = 0.0f;
+
+            for (int lane = 0; lane < numLanes; lane++)
+                sum += Algorithm::process(ops, lane, i);
+
+            dest[i] = sum;
+        }
+    }
+
+    /**
+    * select the kernel and the carriers of an algorithm
+    */
+    template <typename Algorithm>
+    void useAlgorithm()
+    {
+        kernel = &renderKernel<Algorithm>;
+        carrierMask = Algorithm::carrierMask;
+
+        int numCarriers = 0;
+
+        for (int op = 0; op < numOperators; op++)
+            numCarriers += (carrierMask >> op) & 1;
+
+        carrierLevel = 1.0f / (numCarriers * numLanes); // same level for every algorithm
+    }
+
+    /**
+    * carriers follow the amplitude ( short attack ), modulators open and close slowly to move the timbre
+    */
+    void setEnvelopes()
+    {
+        for (int op = 0; op < numOperators; op++)
+        {
+            if ((carrierMask >> op) & 1)
+                envelopes[op].setParameters(sampleRate, 0.01f, 1.0f, 1.0f, 3.0f);
+            else
+                envelopes[op].setParameters(sampleRate, 1.5f + 0.5f * op, 2.5f, 0.35f, 3.0f);
+        }
+    }
+
+    static constexpr float maxModulationIndex = 1.5f;   // in cycles ( about 9.4 radians )
+    static constexpr float maxFeedback = 0.3f;
+
+    float sampleRate = 44100.0f;
+    FMOperatorLanes ops;
+    OperatorEnvelope envelopes[numOperators];
+    alignas(16) float gainBlocks[numOperators][maxBlockSize];
+
+    Kernel kernel = nullptr;
+    int carrierMask = 0;
+    float carrierLevel = 0.25f;
+    float modulationIndex = 0.5f;
+};
@@ -4,24 +4,32 @@
     FMSynth.h
 
     Contains classes FMSynthSound, FMsynthVoice
+    Contains class FMVoiceBank, the FM engines, envelopes and filters of all the
+    voices, rendered stage by stage
 
-    Inherits from synthesiser class, this is a synthesiser for producing sine oscillators with frequency modulations
+    Inherits from synthesiser class, this is a 4-operator FM synthesiser playing chords
 
     Requires <JuceHeader.h>
-    Requires "OscillatorContainer.h" to generate oscillators (vectors of oscillators)
+    Requires "FMOperators.h" for the FM engine
     Requires "ModulatingFilter.h" to filter the output of oscillators
     Requires "KeySignatures.h" to set the key of the chords
-    Requires "Delay.h" for delays
+    Requires "VoiceBank.h" for the dsp state of the voices
+    Requires "Oversampling.h" to decimate the oversampled oscillators
+    Requires "RandomStream.h" for the random values
+    Requires "ModulationMatrix.h" for the modulation of the voice
 
   ==============================================================================
 */
 
 #pragma once
 #include <JuceHeader.h>
-#include "OscillatorContainer.h"
+#include "FMOperators.h"
 #include "ModulatingFilter.h"
 #include "KeySignatures.h"
-#include "Delay.h"
+#include "VoiceBank.h"
+#include "Oversampling.h"
+#include "RandomStream.h"
+#include "ModulationMatrix.h"
 
 // ===========================
 // ===========================
@@ -41,25 +49,278 @@ public:
 };
 
 
+/**
+* FM engines, decimators and filters of the FM voices, one entry per voice
+*
+* @param voice (int) index of the voice in the bank
+* @param renderRate (float) sample rate the voice renders at
+* @param factor (int) oversampling factor of the oscillators (1, 2 or 4)
+* @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to the synthesiser
+* @param firstVoice (int) index of the first voice to render
+* @param numVoices (int) number of voices to render
+*/
+class FMVoiceBank : public VoiceBank
+{
+public:
+
+    /**
+    * set the FM engine parameters shared by the voices
+    *
+    * @param _brightness modulation index of the FM engines (0 - 1)
+    */
+    void setBrightnessParameter(std::atomic<float>* _brightness)
+    {
+        brightness = _brightness;
+    }
+
+    /**
+    * set the filter parameters shared by the voices
+    *
+    * @param _cutoffMode (0 - low-pass, 1 - high-pass, 2 - band-pass, 3 - none)
+    * @param _minVal
+    * @param _maxVal
+    */
+    void setFilterParameters(std::atomic<float>* _cutoffMode, std::atomic<float>* _minVal, std::atomic<float>* _maxVal)
+    {
+        cutoffMode = _cutoffMode;
+        minVal = _minVal;
+        maxVal = _maxVal;
+    }
+
+    /**
+    * set the rate a voice renders at, does not allocate, only called while the voice is silent
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param renderRate (float) sample rate of the voice
+    */
+    void setRenderRate(int voice, float renderRate)
+    {
+        renderRates[voice] = renderRate;
+        envelopes.setSampleRate(voice, renderRate);
+        filters[voice].setParams(renderRate, 0.05f);
+        decimators[voice].setFactor(oversampling[voice]);
+        engines[voice].prepare(renderRate * oversampling[voice]); // the engine runs at the oversampled rate
+    }
+
+    /**
+    * set the oversampling factor of the oscillators of a voice, applied when its next note starts
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param factor (int) 1, 2 or 4
+    */
+    void setOversampling(int voice, int factor)
+    {
+        pendingOversampling[voice] = factor;
+    }
+
+    /**
+    * start a note, the envelope parameters are set by the voice
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param velocity (float) velocity of the note (0 - 1)
+    * @param algorithm (int) algorithm of the FM engine
+    * @param frequencies (const float*) notes of the chord, one per lane of the engine
+    * @param ratios (const float*) frequency ratio of each operator
+    */
+    void startNote(int voice, float velocity, int algorithm, const float* frequencies, const float* ratios)
+    {
+        if (pendingOversampling[voice] != oversampling[voice]) // change the oversampling factor between notes
+        {
+            oversampling[voice] = pendingOversampling[voice];
+            decimators[voice].setFactor(oversampling[voice]);
+            engines[voice].prepare(renderRates[voice] * oversampling[voice]);
+        }
+
+        noteVelocities[voice] = velocity;
+        engines[voice].setAlgorithm(algorithm);  // the algorithm only changes between notes
+
+        for (int i = 0; i < FMEngine::numLanes; i++)
+            chordFrequencies[i][voice] = frequencies[i];
+
+        for (int op = 0; op < FMEngine::numOperators; op++)
+            operatorRatios[op][voice] = ratios[op];
+
+        setPitchRatio(voice, 1.0f);
+        engines[voice].noteOn();
+        startVoice(voice, velocity);
+    }
+
+    /**
+    * release the note of a voice, the engine and the envelope fade out
+    *
+    * @param voice (int) index of the voice in the bank
+    */
+    void releaseNote(int voice)
+    {
+        releaseVoice(voice);
+        engines[voice].noteOff();
+    }
+
+    /**
+    * render the playing voices of a range, stage by stage, and add them to the output buffer
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to the synthesiser
+    * @param startSample (int) position of the first sample in the output buffer
+    * @param numSamples (int) number of samples
+    * @param firstVoice (int) index of the first voice to render
+    * @param numVoices (int) number of voices to render
+    */
+    void render(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, int firstVoice, int numVoices)
+    {
+        // render in chunks of the block size, as long as a voice of the range is playing
+        while (numSamples > 0 && collectActiveVoices(firstVoice, numVoices) > 0)
+        {
+            int blockSize = juce::jmin(numSamples, maxBlockSize);
+
+            updateModulation(startSample, blockSize);
+            updatePitchAndCutoff(startSample + blockSize - 1);
+            renderEngines(blockSize);
+            renderEnvelopes(blockSize);
+            applyEnvelopes(blockSize);
+            renderFilters(blockSize);
+            findTails();
+            mixInto(outputBuffer, startSample);
+
+            startSample += blockSize;
+            numSamples -= blockSize;
+        }
+    }
+
+private:
+    /**
+    * transpose the chord of a voice
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param pitchRatio (float) frequency ratio from the modulation matrix
+    */
+    void setPitchRatio(int voice, float pitchRatio)
+    {
+        appliedPitchRatios[voice] = pitchRatio;
+        float frequencies[FMEngine::numLanes];
+        float ratios[FMEngine::numOperators];
+
+        for (int i = 0; i < FMEngine::numLanes; i++)
+            frequencies[i] = chordFrequencies[i][voice] * pitchRatio;
+
+        for (int op = 0; op < FMEngine::numOperators; op++)
+            ratios[op] = operatorRatios[op][voice];
+
+        engines[voice].setFrequencies(frequencies, ratios);
+    }
+
+    /**
+    * read the pitch and cutoff modulation of the playing voices and the filter parameters ( once per block )
+    *
+    * @param lastSample (int) position of the last sample of the block in the output buffer
+    */
+    void updatePitchAndCutoff(int lastSample)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            float pitchRatio = modulations[v].getPitchRatio(lastSample);
+
+            if (pitchRatio != appliedPitchRatios[v])
+                setPitchRatio(v, pitchRatio);
+
+            filters[v].setCutoffScale(modulations[v].getCutoffScale(lastSample));
+            filters[v].setFilter(*cutoffMode, *minVal, *maxVal);
+        }
+    }
+
+    /**
+    * oscillator stage, the FM engine of every playing voice renders at the oversampled rate and is decimated into its block
+    *
+    * @param numSamples (int) number of samples
+    */
+    void renderEngines(int numSamples)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            engines[v].setBrightness(*brightness * (0.5f + 0.5f * noteVelocities[v])); // louder notes are brighter
+            engines[v].render(decimators[v].getInputBlock(), numSamples * oversampling[v]);
+            decimators[v].process(outputs[v].getBlock(), numSamples);
+        }
+    }
+
+    /**
+    * filter stage, the modulating filter of every playing voice ( after the envelope )
+    *
+    * @param numSamples (int) number of samples
+    */
+    void renderFilters(int numSamples)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            ModulatingFilter& filter = filters[v];
+            float* block = outputs[v].getBlock();
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                block[i] = filter.process(block[i]) / 2;
+            }
+        }
+    }
+
+    // parameters shared by the voices
+    std::atomic<float>* brightness = nullptr;
+    std::atomic<float>* cutoffMode = nullptr;
+    std::atomic<float>* minVal = nullptr;
+    std::atomic<float>* maxVal = nullptr;
+
+    // hot state, one entry per voice
+    FMEngine engines[maxVoices];
+    Decimator decimators[maxVoices];
+    ModulatingFilter filters[maxVoices];
+    int oversampling[maxVoices] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+
+    // state only read once per block or per note
+    int pendingOversampling[maxVoices] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+    float renderRates[maxVoices] = {};
+    float noteVelocities[maxVoices] = {};
+    float appliedPitchRatios[maxVoices] = {};                           // frequency ratio the engine is set to
+    float chordFrequencies[FMEngine::numLanes][maxVoices] = {};         // notes of the chord, without pitch modulation
+    float operatorRatios[FMEngine::numOperators][maxVoices] = {};
+};
+
 /**
 * a synthesiser voice class with frequency modulation
-* inherits from juce::SynthesiserVoice
+* inherits from juce::SynthesiserVoice, its FM engine, envelope and filter live in an FMVoiceBank
 *
 * @param sampleRate (float) sample rate
-* @param volumeInput (std::atomic<float>) pointer to volume
 * @param _cutoffMode (0 - low-pass, 1 - high-pass, 2 - band-pass)
 * @param _minVal 
 * @param _maxVal
+* @param _algorithm (0 - stack, 1 - branch, 2 - two stacks, 3 - triple carrier, 4 - single modulator, 5 - additive)
+* @param _brightness modulation index of the FM engine (0 - 1)
 * @param _selectedMode (setModeLimit(std::vector<int>) vector of modes (the number of each mode)
 * @output getMode() outputs the mode (int) ( this is set whenever a key is pressed )
 * @output getBaseNote() midi note number (int) 
 * @output getVoiceUsed() (int) returns 1 or 0 depending if the voice is used
 */
-class FMsynthVoice : public juce::SynthesiserVoice
+class FMsynthVoice : public juce::SynthesiserVoice, public BankedVoice
 {
 public:
     FMsynthVoice() {}
 
+    // release of the envelope ( 3 seconds ), the echoes are in the delay of the layer
+    static constexpr float maxTailSeconds = 3.0f;
+
+    /**
+    * connect the voice to its entry of the bank of the synthesiser - called before init()
+    *
+    * @param _bank (FMVoiceBank*) bank of the synthesiser
+    * @param _bankIndex (int) index of the voice in the bank
+    */
+    void setBank(FMVoiceBank* _bank, int _bankIndex)
+    {
+        bank = _bank;
+        bankIndex = _bankIndex;
+        bank->setOwner(bankIndex, this);
+    }
+
     /**
     * set sample rate
     *
@@ -67,43 +328,34 @@ public:
     */
     void init(float sampleRate)
     {
-        sr = sampleRate; // local reference of the sample rate to be used in setModulationParameters()
-
         // set sample rate
-        sineOscs.setSampleRate(sampleRate, 4); // the oscillator count can be changed here
-        env.setSampleRate(sampleRate);
-        modFilter.setParams(sampleRate, 0.05f);
         key.setOscillatorParams(sampleRate);
         key.generateNotesForModes(3); 
-        delay.setSize(sampleRate);
-        delay.setDelayTime(0.5 * sampleRate);
-        setModulationParameters(sampleRate); 
-
-        // smooth value setting for volume
-        smoothVolume.reset(sampleRate, 1.0f);
-        smoothVolume.setCurrentAndTargetValue(0.0);
+        bank->prepareVoice(bankIndex, sampleRate);
+        bank->setSendLevel(bankIndex, 0.5f);    // level of the echoes in the delay of the layer
 
         // ADSR envelope
-        juce::ADSR::Parameters envParams;// create instance of ADSR envelop
+        BlockEnvelope::Parameters envParams;// create instance of ADSR envelop
         envParams.attack = 2.0f;         // fade in 
         envParams.decay = 0.5f;         // fade down to sustain level
         envParams.sustain = 0.5f;       // vol level
         envParams.release = 3.0f;       // fade out 
-        env.setParameters(envParams);   // set the envelop parameters
+        bank->setEnvelopeParameters(bankIndex, envParams);   // set the envelop parameters
 
+        setRenderRate(sampleRate);
     }
 
     /**
-    * set volume, the input is from the interface (slider)
-    * 
-    * @param volumeInput (std::atomic<float>) pointer to volume
+    * set the rate the voice renders at, the host rate or a lower internal rate ( see MultiRateLayer )
+    * does not allocate, only called while the voice is silent
+    *
+    * @param renderRate (float) sample rate of the voice, at most the rate passed to init()
     */
-    void setVolumePointer(std::atomic<float>* volumeInput)
+    void setRenderRate(float renderRate)
     {
-        volume = volumeInput;
+        bank->setRenderRate(bankIndex, renderRate);
     }
 
-
     /**
     * set filter parameters
     * 
@@ -113,52 +365,93 @@ public:
     */
     void setModFilterParams(std::atomic<float>* _cutoffMode, std::atomic<float>* _minVal, std::atomic<float>* _maxVal)
     {
-        cutoffMode = _cutoffMode;
-        minVal = _minVal;
-        maxVal = _maxVal;
+        bank->setFilterParameters(_cutoffMode, _minVal, _maxVal);
     }
 
     /**
-    * set oscillator modulation parameters - randomly selected from a range of values
-    * 
-    * @param _sampleRate ( float )
+    * set the seed of the random streams of the voice ( the voice and its key signature use two streams )
+    *
+    * @param seed (juce::uint64) seed of the processor
+    * @param voiceIndex (int) index of the voice, every voice of every layer needs a different index
     */
-    void setModulationParameters(float _sampleRate)
+    void setRandomSeed(juce::uint64 seed, int voiceIndex)
     {
-        float phaseModFreq = juce::jmap(random.nextFloat(), 0.25f, 1.0f);  // phase modulation frequency
-        int sineOscsModDurations[4] = { 180, 240, 300, 360 };              // phase modulation cycle
-        int phaseModDuration = sineOscsModDurations[random.nextInt(4)];     
-        float modFreq[4] = { phaseModFreq, phaseModFreq, phaseModFreq,phaseModFreq };
-        int modDurations[4] = { phaseModDuration, phaseModDuration, phaseModDuration, phaseModDuration };
-        sineOscs.setPhaseModulationParams(sr, modFreq, modDurations, 4); // change the num of oscillators here
+        random.setSeed(seed, 2 * voiceIndex);
+        key.setRandomSeed(seed, 2 * voiceIndex + 1);
+    }
 
+    /**
+    * set the stereo position of the voice
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        bank->setStereoPosition(bankIndex, pan);
+    }
+
+    /**
+    * connect the voice to the modulation matrix ( cutoff, gain, pitch, pan and delay send )
+    *
+    * @param matrix (ModulationMatrix*) matrix of the processor
+    * @param voiceIndex (int) index of the voice in the matrix
+    */
+    void setModulation(ModulationMatrix* matrix, int voiceIndex)
+    {
+        bank->setModulation(bankIndex, matrix, voiceIndex);
+    }
 
-        float fmRate = juce::jmap(random.nextFloat(), 0.00166667f, 0.006666667f); // frequency modulation rate
-        float fmFreq[4] = { fmRate, fmRate, fmRate, fmRate };                     
-        float depths[4] = { 20, 30, 50, 70 };                                     // frequency modulation depth
-        float fmDepth = depths[random.nextInt(4)];
-        float modDepth[4] = { fmDepth, fmDepth, fmDepth, fmDepth };
-        sineOscs.setFrequencyModutions(fmFreq, modDepth, 4); // change the num of oscillators here
+    /**
+    * set the FM engine parameters
+    *
+    * @param _algorithm (0 - stack, 1 - branch, 2 - two stacks, 3 - triple carrier, 4 - single modulator, 5 - additive)
+    * @param _brightness modulation index of the FM engine (0 - 1)
+    */
+    void setFMParams(std::atomic<float>* _algorithm, std::atomic<float>* _brightness)
+    {
+        algorithm = _algorithm;
+        bank->setBrightnessParameter(_brightness);
+    }
 
+    /**
+    * set the oversampling factor of the oscillators, applied when the next note starts
+    *
+    * @param factor (int) 1, 2 or 4
+    */
+    void setOversampling(int factor)
+    {
+        bank->setOversampling(bankIndex, factor);
     }
 
     /**
-    * set frequencies of the oscillators - chosen notes from predefined chords
+    * set frequencies of the operators - chosen notes from predefined chords, random operator ratios
     * this is called whenever a key is pressed, in startNote()
+    *
+    * @param chordFrequencies (float*) notes of the chord, one per lane of the engine
+    * @param operatorRatios (float*) frequency ratio of each operator
     */
-    void setFrequencies()
+    void setFrequencies(float* chordFrequencies, float* operatorRatios)
     {
-        // various forms of seventh chords
-        std::vector<float> variation1 = { key.getNotes(0), key.getNotes(6), key.getNotes(11), key.getNotes(16) };   // 1, 7, 5, 3
-        std::vector<float> variation2 = { key.getNotes(14), key.getNotes(16), key.getNotes(18), key.getNotes(20) }; // 1, 3, 5, 7  
-        std::vector<float> variation3 = { key.getNotes(7), key.getNotes(12), key.getNotes(16), key.getNotes(20) };  // 1, 5, 3, 7
-        std::vector<float> variation4 = { key.getNotes(0), key.getNotes(4), key.getNotes(7), key.getNotes(9) };     // 1, 5, 1, 3
-        std::vector<float> variation5 = { key.getNotes(7), key.getNotes(9), key.getNotes(11), key.getNotes(13) };   // 1, 3, 5, 7
-        std::vector<float> variation6 = { key.getNotes(0), key.getNotes(4), key.getNotes(9), key.getNotes(13) };    // 1, 5, 3, 7
-        std::vector<std::vector<float>> notes = { variation1, variation2, variation3, variation4, variation5, variation6 };
+        // various forms of seventh chords ( degrees of the scale )
+        const int chords[6][4] = { { 0, 6, 11, 16 },      // 1, 7, 5, 3
+                                   { 14, 16, 18, 20 },    // 1, 3, 5, 7
+                                   { 7, 12, 16, 20 },     // 1, 5, 3, 7
+                                   { 0, 4, 7, 9 },        // 1, 5, 1, 3
+                                   { 7, 9, 11, 13 },      // 1, 3, 5, 7
+                                   { 0, 4, 9, 13 } };     // 1, 5, 3, 7
         int pickChord = random.nextInt(6);              // pick a random form 
-        sineOscs.setFrequencies(notes[pickChord], 4);   // set the frequency for the sine oscillators
 
+        for (int i = 0; i < FMEngine::numLanes; i++)
+        {
+            chordFrequencies[i] = key.getNotes(chords[pickChord][i]);
+        }
+
+        // carriers stay on the notes of the chord, the modulators pick a random harmonic ratio
+        const float modulatorRatios[4] = { 0.5f, 1.0f, 2.0f, 3.0f };
+        operatorRatios[0] = 1.0f;
+        operatorRatios[1] = modulatorRatios[random.nextInt(4)];
+        operatorRatios[2] = 1.0f;
+        operatorRatios[3] = modulatorRatios[random.nextInt(4)];
     }
 
 
@@ -217,18 +510,16 @@ public:
     {
         voiceUsed += 1; // called to change mode of the other synths every time a note is started
 
-        env.reset();
-        env.noteOn();
-
-        playing = true;
-        ending = false;
-
         baseNote = midiNoteNumber - 12;             // set the base note the define the key for the other synthesisers ( tranposed down an octave to get a wider range )
         int modeCount = selectedMode.size();        // the number of modes chosen
         int randomMode = random.nextInt(modeCount); 
         mode = selectedMode[randomMode];            // randomly select a mode from the enabled modes
         key.changeMode(midiNoteNumber, mode, 3);    // the mode is changed through this function
-        setFrequencies();                           // set freqeuncies of oscillators
+
+        float chordFrequencies[FMEngine::numLanes];
+        float operatorRatios[FMEngine::numOperators];
+        setFrequencies(chordFrequencies, operatorRatios);   // set freqeuncies of operators
+        bank->startNote(bankIndex, velocity, (int) *algorithm, chordFrequencies, operatorRatios);
          
     }
 
@@ -243,16 +534,26 @@ public:
     {
         if (allowTailOff)   // allow slow release of note
         {
-            env.noteOff();
-            ending = true;
-
+            bank->releaseNote(bankIndex);
         }
 
         else                // shut off note
         {
             clearCurrentNote();
-            playing = false;
+            bank->stopVoice(bankIndex);
+        }
+    }
+
+    /**
+    * called by the bank when the tail of the note has faded out
+    */
+    void noteFinished() override
+    {
+        clearCurrentNote();
 
+        if (voiceUsed > 0)
+        {
+            voiceUsed -= 1;
         }
     }
 
@@ -260,7 +561,7 @@ public:
     /**
      The Main DSP Block: Put your DSP code in here
 
-     If the sound that the voice is playing finishes during the course of this rendered block, it must call clearCurrentNote(), to tell the synthesiser that it has finished
+     If the sound that the voice is playing finishes during the course of this rendered block, the bank calls noteFinished(), which calls clearCurrentNote()
 
      @param outputBuffer pointer to output
      @param startSample position of first sample in buffer
@@ -268,52 +569,8 @@ public:
      */
     void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
     {
-        float* left = outputBuffer.getWritePointer(0); // access the left channel
-        float* right = outputBuffer.getWritePointer(1); // access the right channel
-
-        if (playing) // check to see if this voice should be playing
-        {
-
-            // DSP loop (from startSample up to startSample + numSamples)
-            for (int sampleIndex = startSample; sampleIndex < (startSample + numSamples); sampleIndex++)
-            {
-                
-                smoothVolume.setTargetValue(*volume); // smooth value
-                float gainVal = smoothVolume.getNextValue();
-
-                modFilter.setFilter(*cutoffMode, *minVal, *maxVal); // set filter values
-                float envVal = env.getNextSample();
-                float delayEnv = delay.process(envVal);
-
-                // outputs of oscillators
-                float totalOscs = (sineOscs.output(0) + sineOscs.output(1) + sineOscs.output(2) + sineOscs.output(3)) / 4;
-                float delayOutput = delay.process(totalOscs) * 0.5;
-
-                // apply filter to output
-                float currentSample = modFilter.process(totalOscs * envVal + delayOutput * delayEnv) / 2;
-
-
-                // for each channel, write the currentSample float to the output
-                for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
-                {
-                    outputBuffer.addSample(chan, sampleIndex, gainVal * currentSample);
-                }
-                
-                if (ending) // if it is entering the ending phase
-                {
-                    if (delayEnv < 0.0001 && envVal < 0.0001) // turn off the sound when both envelopes are < 0.0001
-                    {
-                        clearCurrentNote();
-                        playing = false;
-
-                        if (voiceUsed > 0)
-                        {
-                            voiceUsed -= 1;
-                        }
-                    }
-                }
-            }
-        }
+        // only this voice, a VoiceBankSynthesiser renders all its voices together instead
+        bank->render(outputBuffer, startSample, numSamples, bankIndex, 1);
     }
 
     //--------------------------------------------------------------------------
@@ -337,30 +594,17 @@ public:
 
 private:
     //--------------------------------------------------------------------------
-    bool playing = false;       // set default value for playing to be false
-    bool ending = false;        // bool to determine the moment the note is released
-    float sr;                   // sample rate
-
-    // Oscillators
-    OscillatorContainerPhaseSine sineOscs;
-    juce::ADSR env;             // envelope for synthesiser
-
-    // effects
-    ModulatingFilter modFilter;
-    std::atomic<float>* cutoffMode;         // filter parameter
-    std::atomic<float>* minVal;             // filter parameter
-    std::atomic<float>* maxVal;             // filter parameter
-    
-    std::atomic<float>* volume;             // volume parameter
-    juce::SmoothedValue<float> smoothVolume; // smooth value
+    // FM engine, envelope and filter of the voice
+    FMVoiceBank* bank = nullptr;
+    int bankIndex = 0;
+    std::atomic<float>* algorithm;          // engine parameter
 
     // variables for setting chords
     KeySignatures key;
     float baseNote;
     float mode;
 
-    Delay delay;            
-    juce::Random random;    // to generate random values
+    RandomStream random;    // to generate random values
     std::vector<int> selectedMode = { 0 }; // set default value ( ionian )
     int voiceUsed = 0;      // this is used to randomise the mode for other synths
 
@@ -10,8 +10,9 @@
 	Requires <cmath> library for pow() function
 	Requires <vector> to instantiate vectors
 	Requires "Oscillator.h" to generate oscillators
-	Requires <map> library for mapping the modes to the notes
-	Requires "MidiFrequencyConverter.h" to convert midi to frequency
+	Requires "SharedTables.h" for the modes and the frequencies of the midi notes
+	Requires "RandomStream.h" to pick the notes and oscillators
+	Requires "StepSequencer.h" for the timing of the steps
 
   ==============================================================================
 */
@@ -20,9 +21,10 @@
 #include <cmath>			// library for the function pow()
 #include <vector>			// library for creating vectors
 #include "Oscillator.h"		// library for generating oscillators
-#include <map>				// create map to map the modes to the values of the notes
-#include <JuceHeader.h>		// library to convert midi values to frequencies
-#include "Delay.h"
+#include <JuceHeader.h>
+#include "SharedTables.h"		// modes and frequencies of the midi notes
+#include "RandomStream.h"
+#include "StepSequencer.h"
 
 
 /**
@@ -32,19 +34,38 @@
 * 
 * @param _baseNote (int) take in midi value to set as base note
 * @paranm _sr (float) set the sample rate
-* @param _mode (std::string) set the mode of the key "major" or "minor"
+* @param _mode (int) mode number, e.g. 0 = ionian / major
 * @param numOctaves (int) set the number of octaves to generate the possible notes
-* @param speed (float) the speed is determined by the phasor frequency
+* @param speed (float) number of steps ( pulses ) per second
 * @param lfoFreq (float) frequency for lfo
 * @param _pulsePower strength of pulse
 * @param noteDegree degree of the note in the scale
 * 
-* @return randomNoteGenerator() (float) outputs the sequencer 
+* @return renderSequence(float* dest, int numSamples) renders the sequencer into a block
 * @return getNotes(int noteDegree) (float) the frequency of the note selected
 * @return getNoteVector() returns the notes (std::vector<float>) based on the mode chosen 
 */
 class KeySignatures {
 public:
+	KeySignatures()
+		: scales(SharedTables::get<ScaleTable>()),
+		  noteFrequencies(SharedTables::get<NoteFrequencyTable>())
+	{
+	}
+
+	/**
+	* state of the sequencer that changes while it plays ( oscillators, steps and random stream )
+	*/
+	struct SequenceState
+	{
+		PhaseModulationSineOsc sineOsc;
+		SquareOsc sqOsc;
+		TriOsc triOsc;
+		ControlRate<SineOsc> lfo;
+		StepSequencer sequencer;
+		RandomStream random;
+		int randomOsc = 0;
+	};
 
 	/**
 	* generate the possible notes based on the key
@@ -63,54 +84,23 @@ public:
 		sinePulse.setSampleRate(_sr);
 		sinePulse.setFrequency(pulseFreq);
 		sinePulse.setPower(pulsePower);
-		phasor.setSampleRate(_sr);
-		phasor.setFrequency(0.5);
+		sequencer.setSampleRate(_sr);
+		sequencer.setRate(pulseSpeed);
 
 		lfo.setSampleRate(_sr);
 		lfo.setFrequency(0.01);
-
-		delay.setSize(_sr);
-		delay.setDelayTime(0.5 * _sr);
 	}
 
 	/**
-	* generate possible modes to be selected, called once before changeMode()
+	* set the number of octaves of notes, called once before changeMode()
+	* the modes are read from the shared scale table, nothing is generated per instance
 	* 
 	* @param numOctaves (int) number of octaves to generate range of notes
 	*/
 	void generateNotesForModes(int numOctaves)
 	{
-
-		numNotes = 7 * numOctaves;            // set the number of possible notes in the range
-
-		if (numOctaves > 1) // add notes if there is more than one octave
-		{
-			// loop to generate all the possible notes
-			for (int i = 1; i < (numOctaves + 1); i++)
-			{
-				for (int x = 0; x < 7; x++) // loop through each note in one octave
-				{
-					// append the vectors to cover the number of octaves (numOctaves)
-					ionian.push_back(ionian[x] + 12 * i);
-					dorian.push_back(dorian[x] + 12 * i);
-					phrygian.push_back(phrygian[x] + 12 * i);
-					lydian.push_back(lydian[x] + 12 * i);
-					mixolydian.push_back(mixolydian[x] + 12 * i);
-					aeolian.push_back(aeolian[x] + 12 * i);
-					locrian.push_back(locrian[x] + 12 * i);
-
-				}
-			}
-		}
-
-		// compile all the different modes for for loop
-		std::vector<std::vector<int>> listOfModes = { ionian, dorian, phrygian, lydian , mixolydian, aeolian, locrian };
-
-		
-		for (int i = 0; i < modeCount; i++)
-		{
-			keyDictionary[modeList[i]] = listOfModes[i]; // eg: keyDictionary["Major"] = ionian;
-		}
+		jassert(numOctaves < ScaleTable::numOctaves);
+		numNotes = juce::jmin(7 * numOctaves, (int) ScaleTable::numNotes); // set the number of possible notes in the range
 	}
 
 
@@ -123,21 +113,14 @@ public:
 	*/
 	void changeMode(int _baseNote, float _mode, int numOctaves)
 	{
-		std::vector<float> _notes;       // vector to contain the generated notes for the scale
-
-		mode = modeList[(int)_mode];
+		int mode = juce::jlimit(0, ScaleTable::numModes - 1, (int) _mode);
+		numNotes = juce::jmin(7 * numOctaves, (int) ScaleTable::numNotes);  // set the number of possible notes in the range
+		notes.resize(numNotes);
 
-		float baseNote = _baseNote;           // set the base note 
-		numNotes = 7 * numOctaves;            // set the number of possible notes in the range
-
-
-		// loop to select the correct mode and generate a vector to hold all the notes
+		// look up the notes of the mode and their frequencies in the shared tables
 		for (int i = 0; i < numNotes; i++)
 		{
-			std::vector<int> a = keyDictionary.at(mode);							// select the mode at keyDictionary
-			float _note = juce::MidiMessage::getMidiNoteInHertz(baseNote + a[i]);   // convert each note from midi to frequency
-			_notes.push_back(_note);												// add the frequency value to notes (vector)
-			notes = _notes;															//  set notes to be from the selected mode
+			notes[i] = noteFrequencies->getFrequency(_baseNote + scales->getOffset(mode, i));
 		}
 
 		sineOsc.setFrequency(getNotes(0));											// set the default frequency
@@ -149,11 +132,114 @@ public:
 	/**
 	* set the pulse speed
 	* 
-	* @param speed (float) the speed is determined by the phasor frequency
+	* @param speed (float) number of steps ( pulses ) per second, follows the host tempo if tempo sync is on
 	*/
 	void setPulseSpeed(float speed)
 	{
-		phasor.setFrequency(speed);
+		pulseSpeed = speed;
+
+		if (tempoSync)
+			sequencer.setTempo(hostBpm, pulseSpeed);
+		else
+			sequencer.setRate(pulseSpeed);
+	}
+
+	/**
+	* set the tempo and position of the host - called once per block
+	* 
+	* @param sync (bool) true to follow the host tempo
+	* @param bpm (double) tempo of the host in beats per minute
+	* @param ppqPosition (double) position of the host in beats at the start of the block
+	* @param hostPlaying (bool) true if the host is playing, the steps are then aligned to the beats
+	*/
+	void setHostTempo(bool sync, double bpm, double ppqPosition, bool hostPlaying)
+	{
+		tempoSync = sync;
+		hostBpm = (bpm > 0.0) ? bpm : 120.0;
+		hostPosition = ppqPosition;
+		hostAligned = sync && hostPlaying;
+	}
+
+	/**
+	* align the steps to the host beats ( only when tempo sync is on and the host is playing )
+	* 
+	* @param sampleOffset (int) position in the block of the next rendered sample
+	*/
+	void alignToHost(int sampleOffset)
+	{
+		if (hostAligned)
+		{
+			sequencer.setTempo(hostBpm, pulseSpeed);
+			sequencer.setBeatPosition(hostPosition + sampleOffset * hostBpm / (60.0 * sampleRate));
+		}
+	}
+
+	/**
+	* start the sequence from the beginning of a step - called when a note starts
+	*/
+	void resetSequence()
+	{
+		sequencer.reset();
+	}
+
+	/**
+	* start the sequence from a known state, the output then only depends on the note and the seed
+	* 
+	* @param seed (juce::uint64) seed of the processor
+	* @param streamIndex (int) index of the random stream of the note
+	*/
+	void resetState(juce::uint64 seed, int streamIndex)
+	{
+		sineOsc.reset();
+		sqOsc.reset();
+		triOsc.reset();
+		lfo.reset();
+		sequencer.reset();
+		random.setSeed(seed, streamIndex);
+		randomOsc = 0;
+	}
+
+	/**
+	* copy the state of the sequencer
+	* 
+	* @param state (SequenceState&) copy of the state
+	*/
+	void saveState(SequenceState& state) const
+	{
+		state.sineOsc = sineOsc;
+		state.sqOsc = sqOsc;
+		state.triOsc = triOsc;
+		state.lfo = lfo;
+		state.sequencer = sequencer;
+		state.random = random;
+		state.randomOsc = randomOsc;
+	}
+
+	/**
+	* carry on from a copy of the state made by a key signature with the same settings
+	* 
+	* @param state (const SequenceState&) copy of the state
+	*/
+	void loadState(const SequenceState& state)
+	{
+		sineOsc = state.sineOsc;
+		sqOsc = state.sqOsc;
+		triOsc = state.triOsc;
+		lfo = state.lfo;
+		sequencer = state.sequencer;
+		random = state.random;
+		randomOsc = state.randomOsc;
+	}
+
+	/**
+	* set the seed of the random stream used to pick the notes and oscillators
+	* 
+	* @param seed (juce::uint64) seed of the processor
+	* @param streamIndex (int) index of the stream, unique for every voice
+	*/
+	void setRandomSeed(juce::uint64 seed, int streamIndex)
+	{
+		random.setSeed(seed, streamIndex);
 	}
 
 	/**
@@ -179,59 +265,25 @@ public:
 	}
 
 	/**
-	* random music sequencer - outputs the selected note (pulsed)
-	* randomly selects a wave type ( sine, square, triangular)
+	* random music sequencer - renders the selected note (pulsed) into a block
+	* a new note and wave type ( sine, square, triangular) is selected at every step
+	* the block is rendered in spans between the step boundaries, which are known ahead as sample offsets
 	* 
-	* @return the output of the oscillator with delay (float)
-	*/
-	float randomNoteGenerator()
-	{
-		float pulseVolume; 
-		float output = 0;
-
-		if (phasor.process() <= 0.5f) // set the volume
-		{
-			pulseVolume = sin(2.0 * 3.142 * phasor.process());
-		}
-		else // turn off volume
-		{
-			pulseVolume = 0;
-		}
-
-		if (randomOsc == 0) // select oscilator
-		{
-			output = sineOsc.process();
-		}
-
-		else if (randomOsc == 1) // select oscilator
-		{
-			output = sqOsc.process();
-		}
-		else if (randomOsc == 2) // select oscilator
-		{
-			output = triOsc.process();
-		}
-
-		output = output * lfo.process() * 0.5 * pulseVolume;
-		return output + delay.process(output) * 0.5;   
-	}
-
-	/**
-	* change the frequency of sineOsc every time this function is called
-	* this function can be called in the DSP loop to update the frequency of the oscillator
+	* @param dest (float*) block to write the output of the sequencer into
+	* @param numSamples (int) number of samples
 	*/
-	void changeFreq()
+	void renderSequence(float* dest, int numSamples)
 	{
+		int rendered = 0;
 
-		if ((1 - phasor.process()) <= phasor.getPhaseDelta()) // change frequency when the phase is nearing 1 
+		while (rendered < numSamples)
 		{
-			int randomInteger = random.nextInt(numNotes - 1); // generate random integer
-			int outVal = notes[randomInteger];				  // select random note from the scale
-			sineOsc.setFrequency(outVal);					  // set the frequency of sineOsc
-			sqOsc.setFrequency(outVal);
-			triOsc.setFrequency(outVal);
-			randomOsc = random.nextInt(3);					  // variable to randomly select an oscillator
+			int span = juce::jmin(numSamples - rendered, sequencer.getSamplesToNextStep());
+			renderSpan(dest + rendered, span);
+			rendered += span;
 
+			if (sequencer.advance(span)) // step boundary
+				nextStep();
 		}
 	}
 
@@ -255,6 +307,47 @@ public:
 	}
 
 private:
+	/**
+	* select a random note from the scale and a random oscillator for the next step
+	*/
+	void nextStep()
+	{
+		int randomInteger = random.nextInt(numNotes - 1); // generate random integer
+		float outVal = notes[randomInteger];			  // select random note from the scale
+		sineOsc.setFrequency(outVal);					  // set the frequency of sineOsc
+		sqOsc.setFrequency(outVal);
+		triOsc.setFrequency(outVal);
+		randomOsc = random.nextInt(3);					  // variable to randomly select an oscillator
+	}
+
+	/**
+	* render a span inside one step, the oscillator does not change inside the span
+	* 
+	* @param dest (float*) block to write the output into
+	* @param numSamples (int) number of samples, not past the end of the step
+	*/
+	void renderSpan(float* dest, int numSamples)
+	{
+		if (randomOsc == 0) // select oscilator
+			sineOsc.process(dest, numSamples);
+		else if (randomOsc == 1)
+			sqOsc.process(dest, numSamples);
+		else
+			triOsc.process(dest, numSamples);
+
+		float stepPhase = (float) sequencer.getStepPhase();
+		float phaseIncrement = (float) sequencer.getPhaseIncrement();
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			// the pulse sounds during the first half of the step
+			float phase = stepPhase + phaseIncrement * i;
+			float pulseVolume = (phase <= 0.5f) ? (float) sin(2.0 * juce::MathConstants<double>::pi * phase) : 0.0f;
+
+			dest[i] = dest[i] * lfo.process() * 0.5f * pulseVolume;
+		}
+	}
+
 	// variables to be set in setSinePulseParams
 	float pulseFreq = 0.1;          // set the default frequency of sinPulse
 	int pulsePower = 9;            // set the default power of the sine wave for sinePulse
@@ -264,12 +357,18 @@ private:
 	SquareOsc sqOsc;
 	TriOsc triOsc;
 	SineOsc sinePulse;              // sine oscillator to modulate the volume to simulate pulse
-	Oscillator phasor;              // phasor to check the time to change frequency
-	SineOsc lfo;					// lfo to modulate the volume
-	Delay delay;					// delay effect
+	ControlRate<SineOsc> lfo;		// lfo to modulate the volume ( 0.01 - 0.1 Hz, evaluated at control rate )
+
+	RandomStream random;            // random is called to select the notes to be played
+	int randomOsc = 0;				// choose random oscillator
 
-	juce::Random random;            // random is called to select the notes to be played
-	int randomOsc;					// choose random oscillator
+	// step timing
+	StepSequencer sequencer;        // step boundaries as sample offsets
+	float pulseSpeed = 0.5f;        // steps per second
+	bool tempoSync = false;         // follow the host tempo
+	bool hostAligned = false;       // align the steps to the host beats
+	double hostBpm = 120.0;
+	double hostPosition = 0.0;      // host position in beats at the start of the block
 
 
 	// variables to be set in setKey()
@@ -279,20 +378,9 @@ private:
 	std::vector<float> notes;       // vector to contain the generated notes for the scale
 
 
-	// create dictionary to map the selected modes to the correct notes
-	// further modes can be mapped here rather than using if statements to check the input
-	std::map<std::string, std::vector<int>> keyDictionary;
-	std::string mode;
-	int modeCount = 7;
-	std::string modeList[7] = { "Ionian / Major", "Dorian", "Phrygian", "Lydian", "Mixolydian", "Aeolian / Minor", "Locrian" };
-
-	// modes used
-	std::vector<int> ionian = { 0, 2, 4, 5, 7, 9, 11 }; // major
-	std::vector<int> dorian = { 0, 1, 3, 5, 6, 8, 10 };
-	std::vector<int> phrygian = { 0, 1, 3, 5, 7, 8, 10 };
-	std::vector<int> lydian = { 0, 2, 4, 6, 7, 9, 11 };
-	std::vector<int> mixolydian = { 0, 2, 4, 5, 7, 9, 10 };
-	std::vector<int> aeolian = { 0, 2, 3, 5, 7, 8, 10 }; // minor
-	std::vector<int> locrian = { 0, 1, 3, 5, 6, 8, 10 };
+	// shared read-only tables ( one copy for every instance in the process )
+	// further modes can be added to ScaleTable
+	std::shared_ptr<const ScaleTable> scales;
+	std::shared_ptr<const NoteFrequencyTable> noteFrequencies;
 
 };
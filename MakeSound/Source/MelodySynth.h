@@ -9,10 +9,15 @@
     Inherits from synthesiser class, this synthesiser plays notes according to a mode chosen for notes between C1 ( exclusive ) and C2 ( inclusive ),
     plays notes according to midi value for notes below C2 ( exclusive )
 
+    Contains class MelodyVoiceBank, the oscillators and envelopes of all the voices,
+    rendered stage by stage
+
     Requires <JuceHeader.h>
-    Requires "Oscillator.h" to generate oscillators 
+    Requires "Oscillator.h" for the wave shapes and fixed point phases
     Requires "KeySignatures.h" to set the key of the chords
-    Requires "Delay.h" for delays
+    Requires "VoiceBank.h" for the dsp state of the voices
+    Requires "RandomStream.h" for the random values
+    Requires "ModulationMatrix.h" for the modulation of the voice
 
   ==============================================================================
 */
@@ -21,7 +26,9 @@
 #include <JuceHeader.h>
 #include "Oscillator.h"
 #include "KeySignatures.h"
-#include "Delay.h"
+#include "VoiceBank.h"
+#include "RandomStream.h"
+#include "ModulationMatrix.h"
 
 // ===========================
 // ===========================
@@ -40,20 +47,222 @@ public:
     bool appliesToChannel(int) override { return true; }
 };
 
+/**
+* oscillators of the melody voices, as arrays of fixed point phases with one entry per voice
+* every voice plays a triangle, a sine and a square wave ( each enabled or not ) and a detuned triangle wave
+*
+* @param voice (int) index of the voice in the bank
+* @param frequency (float) frequency of the note in Hz
+* @param detuneFrequency (float) frequency of the detuned oscillator in Hz
+* @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to the synthesiser
+* @param firstVoice (int) index of the first voice to render
+* @param numVoices (int) number of voices to render
+*/
+class MelodyVoiceBank : public VoiceBank
+{
+public:
+    enum Oscillators { tri = 0, sine, square, detune, numOscillators };
+
+    /**
+    * set the sample rate of the oscillators
+    *
+    * @param _sampleRate (float) sample rate in Hz
+    */
+    void setSampleRate(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+    }
+
+    /**
+    * choose the oscillators a voice plays, the output is the average of the enabled ones ( plus the detuned oscillator )
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param triVolume (int) 1 if the triangle wave is enabled
+    * @param sineVolume (int) 1 if the sine wave is enabled
+    * @param sqVolume (int) 1 if the square wave is enabled ( at half volume )
+    * @param oscCount (int) number of enabled oscillators
+    */
+    void setOscillatorMix(int voice, int triVolume, int sineVolume, int sqVolume, int oscCount)
+    {
+        gains[tri][voice] = (float) triVolume / oscCount;
+        gains[sine][voice] = (float) sineVolume / oscCount;
+        gains[square][voice] = sqVolume * 0.5f / oscCount;
+        gains[detune][voice] = 1.0f;
+    }
+
+    /**
+    * set the frequencies of the note of a voice
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param frequency (float) frequency of the note in Hz
+    * @param detuneFrequency (float) frequency of the detuned oscillator in Hz
+    */
+    void setFrequencies(int voice, float frequency, float detuneFrequency)
+    {
+        frequencies[voice] = frequency;
+        detuneFrequencies[voice] = detuneFrequency;
+        setPitchRatio(voice, 1.0f);
+    }
+
+    /**
+    * render the playing voices of a range, stage by stage, and add them to the output buffer
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to the synthesiser
+    * @param startSample (int) position of the first sample in the output buffer
+    * @param numSamples (int) number of samples
+    * @param firstVoice (int) index of the first voice to render
+    * @param numVoices (int) number of voices to render
+    */
+    void render(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, int firstVoice, int numVoices)
+    {
+        // render in chunks of the block size, as long as a voice of the range is playing
+        while (numSamples > 0 && collectActiveVoices(firstVoice, numVoices) > 0)
+        {
+            int blockSize = juce::jmin(numSamples, maxBlockSize);
+
+            updateModulation(startSample, blockSize);
+            updatePitch(startSample + blockSize - 1);
+            renderOscillators(blockSize);
+            renderEnvelopes(blockSize);
+            applyEnvelopes(blockSize);
+            findTails();
+            mixInto(outputBuffer, startSample);
+
+            startSample += blockSize;
+            numSamples -= blockSize;
+        }
+    }
+
+private:
+    /**
+    * set the phase increments of the oscillators of a voice ( same rounding as OscillatorStack::setFrequency() )
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param pitchRatio (float) frequency ratio from the modulation matrix
+    */
+    void setPitchRatio(int voice, float pitchRatio)
+    {
+        appliedPitchRatios[voice] = pitchRatio;
+        float frequency = frequencies[voice] * pitchRatio;
+        uint32_t increment = cyclesToFixedPhase((double) frequency / sampleRate);
+
+        increments[tri][voice] = increment;
+        increments[sine][voice] = increment;
+        increments[square][voice] = increment;
+        increments[detune][voice] = cyclesToFixedPhase((double) (detuneFrequencies[voice] * pitchRatio) / sampleRate);
+    }
+
+    /**
+    * read the pitch modulation of the playing voices ( once per block, at the end of the block )
+    *
+    * @param lastSample (int) position of the last sample of the block in the output buffer
+    */
+    void updatePitch(int lastSample)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            float pitchRatio = modulations[v].getPitchRatio(lastSample);
+
+            if (pitchRatio != appliedPitchRatios[v])
+                setPitchRatio(v, pitchRatio);
+        }
+    }
+
+    /**
+    * oscillator stage, writes the oscillators of every playing voice into its block
+    *
+    * @param numSamples (int) number of samples
+    */
+    void renderOscillators(int numSamples)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            float* block = outputs[v].getBlock();
+            juce::FloatVectorOperations::clear(block, numSamples);
+
+            addOscillator(TriShape(), tri, v, block, numSamples);
+            addOscillator(SineShape(), sine, v, block, numSamples);
+            addOscillator(SquareShape(), square, v, block, numSamples);
+            addOscillator(TriShape(), detune, v, block, numSamples);
+        }
+    }
+
+    /**
+    * add one oscillator of a voice to its block, a disabled oscillator only moves its phase
+    *
+    * @param shape (const Shape&) wave shape of the oscillator
+    * @param osc (int) MelodyVoiceBank::Oscillators
+    * @param voice (int) index of the voice in the bank
+    * @param block (float*) block of the voice
+    * @param numSamples (int) number of samples
+    */
+    template <typename Shape>
+    void addOscillator(const Shape& shape, int osc, int voice, float* block, int numSamples)
+    {
+        uint32_t phase = phases[osc][voice];
+        uint32_t increment = increments[osc][voice];
+        float gain = gains[osc][voice];
+
+        if (gain != 0.0f)
+        {
+            for (int i = 0; i < numSamples; i++)
+            {
+                phase += increment; // wraps around on its own
+                block[i] += shape(fixedPhaseToCycles(phase)) * gain;
+            }
+        }
+        else
+        {
+            phase += increment * (uint32_t) numSamples;
+        }
+
+        phases[osc][voice] = phase;
+    }
+
+    float sampleRate = 44100.0f;
+
+    // hot state, one entry per voice
+    alignas(16) uint32_t phases[numOscillators][maxVoices] = {};
+    alignas(16) uint32_t increments[numOscillators][maxVoices] = {};
+    alignas(16) float gains[numOscillators][maxVoices] = {};
+
+    // state only read once per block or per note
+    float frequencies[maxVoices] = {};
+    float detuneFrequencies[maxVoices] = {};
+    float appliedPitchRatios[maxVoices] = {};   // frequency ratio the oscillators are set to
+};
+
 /**
 * a synthesiser voice class which outputs a combination of sineOsc, squareOsc, triangularOsc 
-* inherits from juce::SynthesiserVoice
+* inherits from juce::SynthesiserVoice, its oscillators and envelope live in a MelodyVoiceBank
 *
 * @param sampleRate (float) sample rate
-* @param volumeInput (std::atomic<float>) pointer to volume
 * @param instensity (float) used to set ADSR value and frequency
 * @param midiNoteNumber (int) 
 */
-class MelodyVoice : public juce::SynthesiserVoice
+class MelodyVoice : public juce::SynthesiserVoice, public BankedVoice
 {
 public:
     MelodyVoice() {}
 
+    // longest release set in setEnv() ( 12 seconds below midi 24 ), the echoes are in the delay of the layer
+    static constexpr float maxTailSeconds = 12.0f;
+
+    /**
+    * connect the voice to its entry of the bank of the synthesiser - called before init()
+    *
+    * @param _bank (MelodyVoiceBank*) bank of the synthesiser
+    * @param _bankIndex (int) index of the voice in the bank
+    */
+    void setBank(MelodyVoiceBank* _bank, int _bankIndex)
+    {
+        bank = _bank;
+        bankIndex = _bankIndex;
+        bank->setOwner(bankIndex, this);
+    }
+
     /**
     * set sample rate
     *
@@ -64,39 +273,21 @@ public:
         sr = sampleRate;
 
         // set sample rate
-        triOsc.setSampleRate(sampleRate);
-        sineOsc.setSampleRate(sampleRate);
-        sqOsc.setSampleRate(sampleRate);
-        detuneOsc.setSampleRate(sampleRate);
-        env.setSampleRate(sampleRate);
-        delay.setSize(sampleRate);
-        delay.setDelayTime(0.5 * sampleRate);
+        bank->setSampleRate(sampleRate);
+        bank->prepareVoice(bankIndex, sampleRate);
+        bank->setSendLevel(bankIndex, 0.5f);    // level of the echoes in the delay of the layer
 
         key.setOscillatorParams(sampleRate);
         key.generateNotesForModes(4);   // 4 octaves of notes
 
-        // smooth value setting for volume
-        smoothVolume.reset(sampleRate, 1.0f);
-        smoothVolume.setCurrentAndTargetValue(0.0);
-
         envParams.attack = 2.0f;        // fade in
         envParams.decay = 0.75f;        // fade down to sustain level
         envParams.sustain = 0.25f;      // vol level
         envParams.release = 3.0f;       // fade out
-        env.setParameters(envParams);   // set the envelop parameters
+        bank->setEnvelopeParameters(bankIndex, envParams);   // set the envelop parameters
         
     }
 
-    /**
-    * set pointer to volume parameter
-    * 
-    * @param volumeInput pointer to volume input
-    */
-    void setVolumePointer(std::atomic<float>* volumeInput)
-    {
-        volume = volumeInput;
-    }
-
     /*
     * set the mode 
     * 
@@ -109,6 +300,39 @@ public:
         mode = _mode;
     }
 
+    /**
+    * set the seed of the random streams of the voice ( the voice and its key signature use two streams )
+    *
+    * @param seed (juce::uint64) seed of the processor
+    * @param voiceIndex (int) index of the voice, every voice of every layer needs a different index
+    */
+    void setRandomSeed(juce::uint64 seed, int voiceIndex)
+    {
+        random.setSeed(seed, 2 * voiceIndex);
+        key.setRandomSeed(seed, 2 * voiceIndex + 1);
+    }
+
+    /**
+    * set the stereo position of the voice
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        bank->setStereoPosition(bankIndex, pan);
+    }
+
+    /**
+    * connect the voice to the modulation matrix ( gain, pitch, pan and delay send )
+    *
+    * @param matrix (ModulationMatrix*) matrix of the processor
+    * @param voiceIndex (int) index of the voice in the matrix
+    */
+    void setModulation(ModulationMatrix* matrix, int voiceIndex)
+    {
+        bank->setModulation(bankIndex, matrix, voiceIndex);
+    }
+
     //--------------------------------------------------------------------------
     /**
      Called when a note starts
@@ -120,25 +344,18 @@ public:
      */
     void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override
     {
-        // set bool values
-        playing = true;
-        ending = false;
-
         float vel = (float) velocity * 20.0;    // scale velocity
         velocityDetune = (float) exp(0.2 * vel) / (float) exp(4.0) * 20.0; // set detune paramter
 
-        delay.setDelayTime(velocity * sr);              // set delay time according to velocity 
         setEnv(velocity, midiNoteNumber);               // set envelope according to velocity and midi
         setFrequencyVelocity(velocity, midiNoteNumber); // set frequency according to velocity and midi
         
         // set freqeuncies 
-        triOsc.setFrequency(freq);                      
-        sineOsc.setFrequency(freq);
-        sqOsc.setFrequency(freq);
+        bank->setOscillatorMix(bankIndex, triVolume, sineVolume, sqVolume, oscCount);
+        bank->setFrequencies(bankIndex, freq, freq - velocityDetune);
 
         // reset envelopes
-        env.reset(); 
-        env.noteOn();
+        bank->startVoice(bankIndex, velocity);
 
     }
 
@@ -168,7 +385,7 @@ public:
                 envParams.attack = juce::jmap(random.nextFloat(), 0.01f, 0.05f);  // fade in
                 envParams.sustain = juce::jmap(random.nextFloat(), 0.01f, 0.05f); // vol level
                 envParams.release = juce::jmap(random.nextFloat(), 0.25f, 0.75f); // fade out
-                env.setParameters(envParams);                                     // set the envelop parameters
+                bank->setEnvelopeParameters(bankIndex, envParams);                                     // set the envelop parameters
 
             }
 
@@ -176,7 +393,7 @@ public:
             {
                 float envelopeRelease = intensity * 5.0f;
                 envParams.release = envelopeRelease;                            // fade out
-                env.setParameters(envParams);                                   // set the envelop parameters
+                bank->setEnvelopeParameters(bankIndex, envParams);                                   // set the envelop parameters
             }
         }
 
@@ -190,7 +407,7 @@ public:
 
             float envelopeRelease = intensity * 12.0f;
             envParams.release = envelopeRelease;                            // fade out
-            env.setParameters(envParams);                                   // set the envelop parameters
+            bank->setEnvelopeParameters(bankIndex, envParams);                                   // set the envelop parameters
 
         }
     }
@@ -241,21 +458,28 @@ public:
     {
         if (allowTailOff) // allow slow release of note
         {
-            env.noteOff();
-            ending = true;
+            bank->releaseVoice(bankIndex);
         }
         else // shut off note
         {
             clearCurrentNote();
-            playing = false;
+            bank->stopVoice(bankIndex);
         }
     }
 
+    /**
+    * called by the bank when the tail of the note has faded out
+    */
+    void noteFinished() override
+    {
+        clearCurrentNote();     // frees the voice so the synthesiser can skip it
+    }
+
     //--------------------------------------------------------------------------
     /**
      The Main DSP Block: Put your DSP code in here
 
-     If the sound that the voice is playing finishes during the course of this rendered block, it must call clearCurrentNote(), to tell the synthesiser that it has finished
+     If the sound that the voice is playing finishes during the course of this rendered block, the bank calls noteFinished(), which calls clearCurrentNote()
 
      @param outputBuffer pointer to output
      @param startSample position of first sample in buffer
@@ -263,40 +487,8 @@ public:
      */
     void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
     {
-
-        if (playing) // check to see if this voice should be playing
-        {
-            // smooth value for voume
-            smoothVolume.setTargetValue(*volume); 
-            float gainVal = smoothVolume.getNextValue();
-
-            detuneOsc.setFrequency(freq - velocityDetune); // set the detune amount
-
-            // DSP loop (from startSample up to startSample + numSamples)
-            for (int sampleIndex = startSample; sampleIndex < (startSample + numSamples); sampleIndex++)
-            {
-                float envVal = env.getNextSample();
-                float delayEnv = delay.process(envVal);
-                float totalOscs = (triOsc.process() * triVolume + sineOsc.process() * sineVolume + sqOsc.process() * sqVolume / 2) / oscCount;
-                totalOscs = (totalOscs + detuneOsc.process());
-                float delayOutput = delay.process(totalOscs) * 0.5;
-                float currentSample = (totalOscs * envVal + delayOutput * delayEnv); // apply envelop to oscillator 
-
-                // for each channel, write the currentSample float to the output
-                for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
-                {                    
-                    outputBuffer.addSample(chan, sampleIndex, gainVal * currentSample);
-                }
-
-                if (ending)
-                {
-                    if (delayEnv < 0.0001 && envVal < 0.0001) // turn off the sound when both envelopes are < 0.0001
-                    {
-                        playing = false;
-                    }
-                }
-            }
-        }
+        // only this voice, a VoiceBankSynthesiser renders all its voices together instead
+        bank->render(outputBuffer, startSample, numSamples, bankIndex, 1);
     }
 
     //--------------------------------------------------------------------------
@@ -319,36 +511,28 @@ public:
     //--------------------------------------------------------------------------
 private:
     //--------------------------------------------------------------------------
-    bool playing = false;               // set default value for playing to be false
-    bool ending = false;                // bool to determine the moment the note is released
     float sr;                           // sample rate
     float freq;                         // frequency
 
-    juce::ADSR env;                     // envelope for synthesiser
-    juce::ADSR::Parameters envParams;   // create insatnce of ADSR envelop
-
-    // Oscillators, these are randomly enabled / disabled whenever a note is played
-    TriOsc triOsc;
-    SineOsc sineOsc;
-    SquareOsc sqOsc;
-    TriOsc detuneOsc;
+    BlockEnvelope::Parameters envParams;   // parameters of the envelope of the next note
 
-    // volume for each oscillator
+    // oscillators, these are randomly enabled / disabled whenever a note is played
     int triVolume;
     int sineVolume;
     int sqVolume;
     int oscCount;   // this is used to average the volume of the oscillators output
 
     float velocityDetune;                    // detune oscillator velocity
-    std::atomic<float>* volume;              // volume parameter
-    juce::SmoothedValue<float> smoothVolume; // smooth value
+
+    // oscillators, envelope and output of the voice
+    MelodyVoiceBank* bank = nullptr;
+    int bankIndex = 0;
     
     // variables for setting chords
     KeySignatures key;
     int mode = 0;      // default value
     int baseNote = 24; // default value
 
-    Delay delay;            // effects
-    juce::Random random;    // to generate random values
+    RandomStream random;    // to generate random values
 
 };
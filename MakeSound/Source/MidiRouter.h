@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    MidiRouter.h
+
+    Contains class MidiRouter
+
+    Splits the incoming MidiBuffer into one event list per synthesiser layer in a
+    single pass. Note events are sent to the layer that owns the note (128 entry
+    note to layer table), every other event (controllers, pitch wheel, ...) is
+    sent to all the layers. Each layer also has a mask of the midi channels it
+    listens to
+
+    The per-layer buffers are allocated in prepare(), so routing does not
+    allocate on the audio thread for normal amounts of midi
+
+    Requires <JuceHeader.h> for MidiBuffer
+    Requires <vector> for the layer buffers
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+* routes midi events to the synthesiser layers ( keyboard split )
+*
+* @param numLayers (int) number of layers
+* @param layer (int) index of the layer
+* @param lowestNote (int) lowest midi note of the layer
+* @param highestNote (int) highest midi note of the layer
+* @param channelMask (juce::uint16) one bit for every midi channel ( bit 0 - channel 1 )
+* @return getLayerEvents(int layer) (juce::MidiBuffer&) events of a layer for this block
+*/
+class MidiRouter
+{
+public:
+    static constexpr int numNotes = 128;
+    static constexpr int eventBufferBytes = 4096;  // preallocated per layer
+
+    MidiRouter()
+    {
+        for (int note = 0; note < numNotes; note++)
+        {
+            noteToLayer[note] = -1;
+        }
+    }
+
+    /**
+    * allocate the event buffers of the layers - called in prepareToPlay()
+    *
+    * @param numLayers (int) number of layers
+    */
+    void prepare(int numLayers)
+    {
+        layerEvents.resize(numLayers);
+        channelMasks.resize(numLayers, allChannels);
+
+        for (auto& events : layerEvents)
+        {
+            events.ensureSize(eventBufferBytes);
+        }
+    }
+
+    /**
+    * send a range of notes to a layer
+    *
+    * @param layer (int) index of the layer
+    * @param lowestNote (int) lowest midi note of the layer
+    * @param highestNote (int) highest midi note of the layer
+    */
+    void setKeyRange(int layer, int lowestNote, int highestNote)
+    {
+        for (int note = juce::jmax(0, lowestNote); note <= juce::jmin(numNotes - 1, highestNote); note++)
+        {
+            noteToLayer[note] = layer;
+        }
+    }
+
+    /**
+    * set the midi channels a layer listens to
+    *
+    * @param layer (int) index of the layer
+    * @param channelMask (juce::uint16) one bit for every midi channel ( bit 0 - channel 1 )
+    */
+    void setChannelMask(int layer, juce::uint16 channelMask)
+    {
+        channelMasks[layer] = channelMask;
+    }
+
+    /**
+    * split the midi of this block into the layer event lists ( one pass over the buffer )
+    *
+    * @param midiMessages (const juce::MidiBuffer&) midi of the block
+    */
+    void route(const juce::MidiBuffer& midiMessages)
+    {
+        int numLayers = (int) layerEvents.size();
+
+        for (auto& events : layerEvents)
+        {
+            events.clear();
+        }
+
+        for (const auto metadata : midiMessages)
+        {
+            const juce::uint8* data = metadata.data;
+            int status = data[0] & 0xf0;
+            juce::uint16 channelBit = (status < 0xf0) ? (juce::uint16) (1 << (data[0] & 0x0f)) : allChannels; // system messages have no channel
+
+            if ((status == 0x80 || status == 0x90 || status == 0xa0) && metadata.numBytes > 1) // note off, note on, key pressure
+            {
+                int layer = noteToLayer[data[1] & 0x7f];
+
+                if (layer >= 0 && (channelMasks[layer] & channelBit) != 0)
+                    layerEvents[layer].addEvent(data, metadata.numBytes, metadata.samplePosition);
+            }
+            else // controllers, pitch wheel, ... go to every layer on that channel
+            {
+                for (int layer = 0; layer < numLayers; layer++)
+                {
+                    if ((channelMasks[layer] & channelBit) != 0)
+                        layerEvents[layer].addEvent(data, metadata.numBytes, metadata.samplePosition);
+                }
+            }
+        }
+    }
+
+    /**
+    * returns the events of a layer for this block
+    *
+    * @param layer (int) index of the layer
+    */
+    juce::MidiBuffer& getLayerEvents(int layer)
+    {
+        return layerEvents[layer];
+    }
+
+private:
+    const juce::uint16 allChannels = 0xffff;
+
+    int noteToLayer[numNotes];                  // layer of every midi note, -1 if the note is not played
+    std::vector<juce::uint16> channelMasks;     // midi channels of every layer
+    std::vector<juce::MidiBuffer> layerEvents;  // events of every layer for the current block
+};
@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    MixerBus.h
+
+    Contains class MixerBus
+
+    Gives every synthesiser layer its own stereo scratch bus, then sums the buses
+    into the output with a gain, an equal-power pan and an lfo auto-pan per layer
+
+    The pan and lfo are evaluated once per block (control rate), the summing is a
+    gain ramp from the previous block's value so parameter changes do not click
+
+    Layers that are not rendered in a block (silent) are skipped when summing
+
+    Requires <JuceHeader.h> for AudioBuffer
+    Requires <vector> for the layers
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+* mixer with one stereo scratch bus per layer
+*
+* @param sampleRate (double) sample rate in Hz
+* @param samplesPerBlock (int) expected block size
+* @param numLayers (int) number of layers
+* @param layer (int) index of the layer
+* @param gain (float) gain of the layer
+* @param pan (float) pan position of the layer (-1 left, 0 centre, 1 right)
+* @param lfoRate (float) frequency of the auto-pan lfo in Hz
+* @param lfoDepth (float) depth of the auto-pan lfo (0 - 1)
+*/
+class MixerBus
+{
+public:
+
+    /**
+    * allocate the scratch buses - called in prepareToPlay()
+    *
+    * @param sampleRate (double) sample rate in Hz
+    * @param samplesPerBlock (int) expected block size
+    * @param numLayers (int) number of layers
+    */
+    void prepare(double sampleRate, int samplesPerBlock, int numLayers)
+    {
+        sr = sampleRate;
+        layers.resize(numLayers);
+
+        for (auto& layer : layers)
+        {
+            layer.bus.setSize(2, samplesPerBlock, false, false, true); // keeps the memory if it is already big enough
+            layer.lfoPhase = 0.0f;
+            layer.leftGain = -1.0f;     // no previous value yet, the first block does not ramp
+            layer.rightGain = -1.0f;
+        }
+    }
+
+    /**
+    * returns the memory of the scratch buses in bytes
+    */
+    size_t getSizeInBytes() const
+    {
+        size_t bytes = 0;
+
+        for (auto& layer : layers)
+        {
+            bytes += (size_t) layer.bus.getNumChannels() * layer.bus.getNumSamples() * sizeof(float);
+        }
+
+        return bytes;
+    }
+
+    /**
+    * mark every layer as silent at the start of a block, layers are enabled again by getLayerBus()
+    */
+    void beginBlock()
+    {
+        for (auto& layer : layers)
+        {
+            layer.active = false;
+        }
+    }
+
+    /**
+    * returns the cleared scratch bus of a layer and marks the layer as active for this block
+    * the layer renders into this buffer
+    *
+    * @param layer (int) index of the layer
+    * @param numSamples (int) number of samples in this block
+    */
+    juce::AudioBuffer<float>& getLayerBus(int layer, int numSamples)
+    {
+        auto& bus = layers[layer].bus;
+
+        if (bus.getNumSamples() < numSamples) // host sent a bigger block than announced
+            bus.setSize(2, numSamples, false, false, true);
+
+        bus.clear(0, numSamples);
+        layers[layer].active = true;
+        return bus;
+    }
+
+    /**
+    * set the gain of a layer
+    *
+    * @param layer (int) index of the layer
+    * @param gain (float) linear gain
+    */
+    void setLayerGain(int layer, float gain)
+    {
+        layers[layer].gain = gain;
+    }
+
+    /**
+    * set the pan position of a layer
+    *
+    * @param layer (int) index of the layer
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setLayerPan(int layer, float pan)
+    {
+        layers[layer].pan = pan;
+    }
+
+    /**
+    * set the lfo used to auto-pan a layer
+    *
+    * @param layer (int) index of the layer
+    * @param lfoRate (float) frequency of the lfo in Hz
+    * @param lfoDepth (float) depth of the lfo (0 - 1)
+    */
+    void setAutoPan(int layer, float lfoRate, float lfoDepth)
+    {
+        layers[layer].lfoRate = lfoRate;
+        layers[layer].lfoDepth = lfoDepth;
+    }
+
+    /**
+    * sum all the active layer buses into the output buffer (the output is overwritten)
+    *
+    * @param output (juce::AudioBuffer<float>&) buffer to write into
+    * @param numSamples (int) number of samples in this block
+    */
+    void mixTo(juce::AudioBuffer<float>& output, int numSamples)
+    {
+        output.clear(0, numSamples);
+
+        for (auto& layer : layers)
+        {
+            // the lfo keeps running while a layer is silent
+            float lfoPhase = layer.lfoPhase;
+            layer.lfoPhase += layer.lfoRate * numSamples / (float)sr;
+            layer.lfoPhase -= std::floor(layer.lfoPhase);
+
+            if (! layer.active)
+                continue;
+
+            // control rate: lfo and pan law evaluated once per block
+            float lfo = std::sin(lfoPhase * juce::MathConstants<float>::twoPi);
+            float position = juce::jlimit(-1.0f, 1.0f, layer.pan + lfo * layer.lfoDepth);
+            float angle = (position + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+
+            // equal-power law, normalised so that the centre position is unity gain
+            float leftGain = std::cos(angle) * juce::MathConstants<float>::sqrt2 * layer.gain;
+            float rightGain = std::sin(angle) * juce::MathConstants<float>::sqrt2 * layer.gain;
+
+            if (layer.leftGain < 0.0f)
+            {
+                layer.leftGain = leftGain;
+                layer.rightGain = rightGain;
+            }
+
+            if (output.getNumChannels() > 1)
+            {
+                output.addFromWithRamp(0, 0, layer.bus.getReadPointer(0), numSamples, layer.leftGain, leftGain);
+                output.addFromWithRamp(1, 0, layer.bus.getReadPointer(1), numSamples, layer.rightGain, rightGain);
+            }
+            else // mono output, no panning
+            {
+                output.addFromWithRamp(0, 0, layer.bus.getReadPointer(0), numSamples, layer.gain, layer.gain);
+            }
+
+            layer.leftGain = leftGain;
+            layer.rightGain = rightGain;
+        }
+    }
+
+private:
+    struct Layer
+    {
+        juce::AudioBuffer<float> bus;   // stereo scratch bus
+        bool active = false;            // false if the layer was not rendered in this block
+        float gain = 1.0f;
+        float pan = 0.0f;
+
+        // auto-pan lfo
+        float lfoRate = 0.0f;
+        float lfoDepth = 0.0f;
+        float lfoPhase = 0.0f;
+
+        // gains used in the previous block, the next block ramps from these
+        float leftGain = -1.0f;
+        float rightGain = -1.0f;
+    };
+
+    std::vector<Layer> layers;
+    double sr = 44100.0;
+};
@@ -7,21 +7,26 @@
 
     sets up a cutoff filter which modulates
 
+    The lfo runs at control rate and the filter coefficients are only
+    recalculated once every control interval
+
     Requires "Oscillator.h" to generate lfo
+    Requires "ControlRate.h" for the control rate lfo
 
   ==============================================================================
 */
 
 #pragma once
-#include <JuceHeader.h>     // for using std::string
+#include <JuceHeader.h>     // for IIRFilter
 #include "Oscillator.h"
+#include "ControlRate.h"
 
 /**
 * sets up a cutoff filter which modulates
 *
 * @param sampleRate (float) sample of lfo
 * @param lfoFreq (float) frequency of lfo
-* @param _cutoffMode (std::string) "high" or "low", if some other string is passed through the function, the original audio will be returned
+* @param _cutoffMode (float) 0 - low-pass, 1 - high-pass, 2 - band-pass, 3 - none ( the original audio is returned )
 * @param _minVal (float)
 * @param _maxVal (float)
 * @param sample (float) audio input to be filtered (cut off)
@@ -48,17 +53,34 @@ public:
     /**
     * set the filter type, min cutoff, max cutoff
     *
-    * @param _cutoffMode (float) 0 - low-pass, 1 - high-pass, 2 - band-pass
+    * @param _cutoffMode (float) 0 - low-pass, 1 - high-pass, 2 - band-pass, 3 - none
     * @param _minVal (float)
     * @param _maxVal (float)
     */
     void setFilter(float _cutoffMode, float _minVal, float _maxVal)
     {
-        cutoffMode = filterType[(int) _cutoffMode];
+        int mode = (int) _cutoffMode;
+
+        if (mode != cutoffMode) // a new filter type is applied on the next sample
+        {
+            cutoffMode = mode;
+            coefficientCountdown = 0;
+        }
+
         minVal = _minVal;
         maxVal = _maxVal;
     }
 
+    /**
+    * scale the cutoff ( modulation ), applied when the coefficients are recalculated
+    *
+    * @param _cutoffScale (float) ratio of the cutoff, 1 - no change
+    */
+    void setCutoffScale(float _cutoffScale)
+    {
+        cutoffScale = _cutoffScale;
+    }
+
     /**
     * take in audio as input and return the filter audio
     *
@@ -71,42 +93,43 @@ public:
         float value2 = (maxVal + minVal) / 2;
 
         // lfo is used to scale  the cutoff frequency to between 100f and 1100f
-        float cutoff = lfo.process() * value1 + value2;
+        float cutoff = (lfo.process() * value1 + value2) * cutoffScale;
 
-        if (cutoffMode == "Low-pass")
+        if (cutoffMode == none) // return original audio
         {
-            filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, cutoff, resonance));
-            return filter.processSingleSampleRaw(sample);
+            return sample;
         }
 
-        if (cutoffMode == "High-pass")
+        if (coefficientCountdown == 0) // control rate: the coefficients follow the cutoff once every interval
         {
-            filter.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, cutoff, resonance));
-            return filter.processSingleSampleRaw(sample);
-        }
+            cutoff = juce::jlimit(20.0f, sampleRate * 0.45f, cutoff);   // below the nyquist frequency when modulated
 
-        if (cutoffMode == "Band-pass")
-        {
-            filter.setCoefficients(juce::IIRCoefficients::makeBandPass(sampleRate, cutoff, resonance));
-            return filter.processSingleSampleRaw(sample);
-        }
+            if (cutoffMode == lowPass)
+                filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, cutoff, resonance));
+            else if (cutoffMode == highPass)
+                filter.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, cutoff, resonance));
+            else
+                filter.setCoefficients(juce::IIRCoefficients::makeBandPass(sampleRate, cutoff, resonance));
 
-        if (cutoffMode == "None") // return original audio
-        {
-            return sample;
+            coefficientCountdown = ControlRateRamp::defaultInterval;
         }
+
+        coefficientCountdown--;
+        return filter.processSingleSampleRaw(sample);
     }
 
 private:
     juce::IIRFilter filter;  // filter used for cut off
     float resonance = 5.0f;  // default value for resonance = 5
 
-    SineOsc lfo;             // generate lfo to modulate cutoff
+    ControlRate<SineOsc> lfo;   // generate lfo to modulate cutoff ( 0.05 Hz, evaluated at control rate )
     float sampleRate;        // local reference to the sample rate
 
-    std::string cutoffMode;  // variable to select cut off mode
-    std::string filterType[4] = { "Low-pass", "High-pass", "Band-pass", "None" };
+    enum FilterType { lowPass = 0, highPass, bandPass, none };
+    int cutoffMode = none;   // variable to select cut off mode
+    int coefficientCountdown = 0;   // samples until the coefficients are recalculated
 
+    float cutoffScale = 1.0f;   // ratio of the cutoff from the modulation matrix
     float minVal;            // min value of cut off
     float maxVal;            // max value of cut off
 };
\ No newline at end of file
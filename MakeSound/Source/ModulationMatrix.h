@@ -0,0 +1,395 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+
+    Contains class ModulationMatrix
+    Contains class VoiceModulation
+
+    Routes modulation sources (lfos, envelopes, velocity, mod wheel, random) to
+    destinations (cutoff, gain, pitch, pan, delay send) of every voice of every
+    layer. Each slot of the matrix adds amount * source to a destination
+
+    The matrix is evaluated once per block. Sources and destinations are stored
+    as one array per source / destination with one entry per voice, so a slot is
+    one multiply-add across all the voices (vectorised by the compiler). Every
+    voice gets a linear ramp from its value at the end of the previous block to
+    its value at the end of this block, and reads it once per rendered chunk
+
+    Envelope levels are reported by the voices while they render, so the
+    envelope source lags one block behind
+
+    Requires <JuceHeader.h> for MidiBuffer
+    Requires "RandomStream.h" for the random source
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+#include "RandomStream.h"
+
+/**
+* modulation matrix evaluated once per block, with a ramp per voice and destination
+*
+* @param sampleRate (double) sample rate in Hz
+* @param numVoices (int) number of voices of all the layers
+* @param slot (int) index of a slot of the matrix
+* @param source (int) ModulationMatrix::Source
+* @param destination (int) ModulationMatrix::Destination
+* @param amount (float) depth of the slot (-1 - 1), scaled by the range of the destination
+* @param voice (int) index of a voice
+* @return getValue(int destination, int voice, int sample) (float) modulation of a voice at a sample of the block
+*/
+class ModulationMatrix
+{
+public:
+    enum Source { lfo1 = 0, lfo2, envelope, velocity, modWheel, random, numSources };
+    enum Destination { cutoff = 0, gain, pitch, pan, delaySend, numDestinations };
+
+    static constexpr int maxVoices = 32;
+    static constexpr int maxSlots = 8;
+    static constexpr int numLfos = 2;
+    static constexpr int randomStreamIndex = 0x200000;  // different from the streams of the voices and the note cache
+
+    ModulationMatrix()
+    {
+        for (int d = 0; d < numDestinations; d++)
+        {
+            for (int v = 0; v < maxVoices; v++)
+            {
+                previous[d][v] = 0.0f;
+                current[d][v] = 0.0f;
+                increment[d][v] = 0.0f;
+            }
+        }
+
+        for (int s = 0; s < numSources; s++)
+        {
+            for (int v = 0; v < maxVoices; v++)
+                sources[s][v] = 0.0f;
+        }
+    }
+
+    /**
+    * set the sample rate and the number of voices - called in prepareToPlay()
+    *
+    * @param _sampleRate (double) sample rate in Hz
+    * @param _numVoices (int) number of voices of all the layers ( maxVoices at most )
+    */
+    void prepare(double _sampleRate, int _numVoices)
+    {
+        sampleRate = _sampleRate;
+        numVoices = juce::jlimit(0, maxVoices, _numVoices);
+
+        for (int lfo = 0; lfo < numLfos; lfo++)
+            lfoPhases[lfo] = 0.0;
+    }
+
+    /**
+    * set the seed of the random source
+    *
+    * @param seed (juce::uint64) seed of the processor
+    */
+    void setRandomSeed(juce::uint64 seed)
+    {
+        randomStream.setSeed(seed, randomStreamIndex);
+    }
+
+    /**
+    * set a slot of the matrix, a slot with an amount of 0 is skipped
+    *
+    * @param slot (int) index of the slot ( maxSlots at most )
+    * @param source (int) ModulationMatrix::Source, -1 turns the slot off
+    * @param destination (int) ModulationMatrix::Destination
+    * @param amount (float) depth of the slot (-1 - 1), scaled by the range of the destination
+    */
+    void setSlot(int slot, int source, int destination, float amount)
+    {
+        slots[slot].source = source;
+        slots[slot].destination = destination;
+        slots[slot].amount = (source >= 0 && source < numSources) ? amount * destinationRanges[destination] : 0.0f;
+    }
+
+    /**
+    * set the frequency of an lfo
+    *
+    * @param lfo (int) index of the lfo
+    * @param frequency (float) frequency in Hz
+    */
+    void setLfoRate(int lfo, float frequency)
+    {
+        lfoRates[lfo] = frequency;
+    }
+
+    /**
+    * read the mod wheel ( controller 1 ) from the midi of the block, the last value of the block is used
+    *
+    * @param midiMessages (const juce::MidiBuffer&) midi of the block
+    */
+    void handleMidi(const juce::MidiBuffer& midiMessages)
+    {
+        for (const auto metadata : midiMessages)
+        {
+            const juce::uint8* data = metadata.data;
+
+            if ((data[0] & 0xf0) == 0xb0 && metadata.numBytes > 2 && data[1] == 1)
+                modWheelValue = data[2] / 127.0f;
+        }
+    }
+
+    /**
+    * a voice starts a note: set its velocity and random sources and jump to its new values ( no ramp from the last note )
+    *
+    * @param voice (int) index of the voice
+    * @param noteVelocity (float) velocity of the note (0 - 1)
+    */
+    void noteOn(int voice, float noteVelocity)
+    {
+        sources[velocity][voice] = noteVelocity;
+        sources[random][voice] = randomStream.nextFloat() * 2.0f - 1.0f;
+        sources[envelope][voice] = 0.0f;
+
+        for (int d = 0; d < numDestinations; d++)
+            current[d][voice] = 0.0f;
+
+        for (int i = 0; i < maxSlots; i++)
+        {
+            const Slot& slot = slots[i];
+
+            if (slot.amount != 0.0f)
+                current[slot.destination][voice] += slot.amount * sources[slot.source][voice];
+        }
+
+        for (int d = 0; d < numDestinations; d++)
+        {
+            previous[d][voice] = current[d][voice];
+            increment[d][voice] = 0.0f;
+        }
+    }
+
+    /**
+    * a voice reports the level of its envelope ( used as a source in the next block )
+    *
+    * @param voice (int) index of the voice
+    * @param level (float) level of the envelope (0 - 1)
+    */
+    void setEnvelope(int voice, float level)
+    {
+        sources[envelope][voice] = level;
+    }
+
+    /**
+    * evaluate the matrix for the next block, called once per block before the voices render
+    *
+    * @param numSamples (int) number of samples in the block
+    */
+    void process(int numSamples)
+    {
+        // global sources, evaluated at the end of the block and shared by every voice
+        for (int lfo = 0; lfo < numLfos; lfo++)
+        {
+            lfoPhases[lfo] += lfoRates[lfo] * numSamples / sampleRate;
+            lfoPhases[lfo] -= std::floor(lfoPhases[lfo]);
+            float lfoValue = (float) std::sin(lfoPhases[lfo] * juce::MathConstants<double>::twoPi);
+            juce::FloatVectorOperations::fill(sources[lfo1 + lfo], lfoValue, numVoices);
+        }
+
+        juce::FloatVectorOperations::fill(sources[modWheel], modWheelValue, numVoices);
+
+        // the end of the last block is the start of the ramps of this block
+        for (int d = 0; d < numDestinations; d++)
+        {
+            juce::FloatVectorOperations::copy(previous[d], current[d], numVoices);
+            juce::FloatVectorOperations::clear(current[d], numVoices);
+        }
+
+        for (int i = 0; i < maxSlots; i++) // one multiply-add across the voices per slot
+        {
+            const Slot& slot = slots[i];
+
+            if (slot.amount != 0.0f)
+                juce::FloatVectorOperations::addWithMultiply(current[slot.destination], sources[slot.source], slot.amount, numVoices);
+        }
+
+        setBlockLength(0, numVoices, numSamples);
+    }
+
+    /**
+    * set the length of the ramps of some voices ( for a layer that renders at a different rate than the host )
+    *
+    * @param firstVoice (int) index of the first voice
+    * @param count (int) number of voices
+    * @param numSamples (int) number of samples the voices render in this block
+    */
+    void setBlockLength(int firstVoice, int count, int numSamples)
+    {
+        float scale = 1.0f / juce::jmax(1, numSamples);
+
+        for (int d = 0; d < numDestinations; d++)
+        {
+            for (int v = firstVoice; v < firstVoice + count; v++)
+            {
+                increment[d][v] = (current[d][v] - previous[d][v]) * scale;
+            }
+        }
+    }
+
+    /**
+    * returns the modulation of a voice at the end of a sample of the block
+    * the units depend on the destination: octaves (cutoff), gain change, semitones (pitch), pan change, send level change
+    *
+    * @param destination (int) ModulationMatrix::Destination
+    * @param voice (int) index of the voice
+    * @param sample (int) sample of the block, -1 for the value at the start of the block
+    */
+    float getValue(int destination, int voice, int sample) const
+    {
+        return previous[destination][voice] + increment[destination][voice] * (sample + 1);
+    }
+
+private:
+    struct Slot
+    {
+        int source = -1;
+        int destination = 0;
+        float amount = 0.0f;    // depth scaled by the range of the destination, 0 if the slot is off
+    };
+
+    // full scale of each destination: 2 octaves, +- 1 gain, 12 semitones, full pan, +- 1 send level
+    const float destinationRanges[numDestinations] = { 2.0f, 1.0f, 12.0f, 1.0f, 1.0f };
+
+    Slot slots[maxSlots];
+    int numVoices = 0;
+    double sampleRate = 44100.0;
+
+    // global sources
+    double lfoPhases[numLfos] = {};
+    float lfoRates[numLfos] = { 0.1f, 0.5f };
+    float modWheelValue = 0.0f;
+    RandomStream randomStream;
+
+    // one row per source / destination, one entry per voice
+    alignas(16) float sources[numSources][maxVoices];
+    alignas(16) float previous[numDestinations][maxVoices];     // values at the end of the last block
+    alignas(16) float current[numDestinations][maxVoices];      // values at the end of this block
+    alignas(16) float increment[numDestinations][maxVoices];    // change per sample
+};
+
+/**
+* connection of a voice to the modulation matrix, turns the modulation into the values the voice uses
+* a voice without a matrix is not modulated
+*
+* @param matrix (ModulationMatrix*) matrix of the processor
+* @param voiceIndex (int) index of the voice in the matrix
+* @param sample (int) sample of the block, -1 for the start of the block
+* @return getGain(int sample) (float) gain of the voice (0 - 2)
+* @return getPitchRatio(int sample) (float) frequency ratio of the voice
+* @return getCutoffScale(int sample) (float) ratio of the filter cutoff
+*/
+class VoiceModulation
+{
+public:
+
+    /**
+    * connect the voice to a matrix
+    *
+    * @param _matrix (ModulationMatrix*) matrix of the processor
+    * @param _voiceIndex (int) index of the voice in the matrix
+    */
+    void setMatrix(ModulationMatrix* _matrix, int _voiceIndex)
+    {
+        matrix = _matrix;
+        voiceIndex = _voiceIndex;
+    }
+
+    /**
+    * called when the voice starts a note
+    *
+    * @param velocity (float) velocity of the note (0 - 1)
+    */
+    void noteOn(float velocity)
+    {
+        if (matrix != nullptr)
+            matrix->noteOn(voiceIndex, velocity);
+    }
+
+    /**
+    * report the level of the envelope of the voice
+    *
+    * @param level (float) level of the envelope (0 - 1)
+    */
+    void setEnvelope(float level)
+    {
+        if (matrix != nullptr)
+            matrix->setEnvelope(voiceIndex, level);
+    }
+
+    /**
+    * returns the modulation of a destination at a sample of the block ( 0 without a matrix )
+    *
+    * @param destination (int) ModulationMatrix::Destination
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getValue(int destination, int sample) const
+    {
+        return (matrix != nullptr) ? matrix->getValue(destination, voiceIndex, sample) : 0.0f;
+    }
+
+    /**
+    * returns the gain of the voice (0 - 2)
+    *
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getGain(int sample) const
+    {
+        return juce::jlimit(0.0f, 2.0f, 1.0f + getValue(ModulationMatrix::gain, sample));
+    }
+
+    /**
+    * returns the frequency ratio of the voice
+    *
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getPitchRatio(int sample) const
+    {
+        return std::exp2(getValue(ModulationMatrix::pitch, sample) / 12.0f);
+    }
+
+    /**
+    * returns the ratio of the filter cutoff of the voice
+    *
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getCutoffScale(int sample) const
+    {
+        return std::exp2(getValue(ModulationMatrix::cutoff, sample));
+    }
+
+    /**
+    * returns the stereo position of the voice (-1 - 1)
+    *
+    * @param basePosition (float) position of the voice without modulation
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getPan(float basePosition, int sample) const
+    {
+        return juce::jlimit(-1.0f, 1.0f, basePosition + getValue(ModulationMatrix::pan, sample));
+    }
+
+    /**
+    * returns the level the voice sends to the delay of its layer (0 - 1)
+    *
+    * @param baseLevel (float) send level without modulation
+    * @param sample (int) sample of the block, -1 for the start of the block
+    */
+    float getSendLevel(float baseLevel, int sample) const
+    {
+        return juce::jlimit(0.0f, 1.0f, baseLevel + getValue(ModulationMatrix::delaySend, sample));
+    }
+
+private:
+    ModulationMatrix* matrix = nullptr;
+    int voiceIndex = 0;
+};
@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    MultiRateLayer.h
+
+    Contains class MultiRateLayer
+
+    Lets a band-limited layer render at a lower internal rate (1/2 or 1/4 of the
+    host rate) and brings its output back up to the host rate with a polyphase
+    interpolator before it is mixed
+
+    A host block does not always hold a whole number of internal samples, so the
+    few interpolated samples left over at the end of a block are kept for the
+    start of the next one. The midi of the block is moved to the internal rate
+    the same way ( events land on the internal sample that covers them )
+
+    Requires "Oversampling.h" for the interpolators
+    Requires <JuceHeader.h> for AudioBuffer and MidiBuffer
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Oversampling.h"
+
+/**
+* renders a layer at a lower internal rate and interpolates it to the host rate
+*
+* @param samplesPerBlock (int) expected block size at the host rate
+* @param _factor (int) ratio between the host rate and the internal rate (1, 2 or 4)
+* @param events (const juce::MidiBuffer&) midi of the layer at the host rate
+* @param numSamples (int) number of samples in this block at the host rate
+* @return beginBlock() (int) number of samples to render at the internal rate
+*/
+class MultiRateLayer
+{
+public:
+    static constexpr int maxFactor = Interpolator::maxFactor;
+    static constexpr float bandwidthHeadroom = 8.0f;    // the internal nyquist frequency stays this far above the highest frequency of the layer
+    static constexpr int eventBufferBytes = 4096;       // preallocated midi at the internal rate
+
+    /**
+    * returns the largest factor that keeps a band-limited layer below the internal nyquist frequency
+    *
+    * @param sampleRate (double) host sample rate in Hz
+    * @param maxFrequency (float) highest frequency the layer lets through in Hz
+    */
+    static int getFactorForBandwidth(double sampleRate, float maxFrequency)
+    {
+        for (int factor = maxFactor; factor > 1; factor /= 2)
+        {
+            if (sampleRate / (2.0 * factor) >= bandwidthHeadroom * maxFrequency)
+                return factor;
+        }
+
+        return 1;
+    }
+
+    /**
+    * allocate the buffers of the layer and go back to the host rate - called in prepareToPlay()
+    *
+    * @param samplesPerBlock (int) expected block size at the host rate
+    */
+    void prepare(int samplesPerBlock)
+    {
+        lowRateBus.setSize(2, samplesPerBlock + maxFactor, false, false, true); // keeps the memory if it is already big enough
+        upsampled.setSize(2, samplesPerBlock + 2 * maxFactor, false, false, true);
+        lowRateEvents.ensureSize(eventBufferBytes);
+        setFactor(1);
+    }
+
+    /**
+    * returns the memory of the buffers in bytes
+    */
+    size_t getSizeInBytes() const
+    {
+        return (size_t) (lowRateBus.getNumChannels() * lowRateBus.getNumSamples()
+                       + upsampled.getNumChannels() * upsampled.getNumSamples()) * sizeof(float);
+    }
+
+    /**
+    * set the ratio between the host rate and the internal rate and clear the interpolators
+    * only change it while the layer is silent, the voices have to be set to the new internal rate as well
+    *
+    * @param _factor (int) ratio between the host rate and the internal rate (1, 2 or 4)
+    */
+    void setFactor(int _factor)
+    {
+        for (int channel = 0; channel < 2; channel++)
+        {
+            interpolators[channel].setFactor(_factor);
+        }
+
+        factor = interpolators[0].getFactor();
+        numPending = 0;
+        tailRemaining = 0;
+        lowRateEvents.clear();
+    }
+
+    /**
+    * returns the ratio between the host rate and the internal rate
+    */
+    int getFactor()
+    {
+        return factor;
+    }
+
+    /**
+    * returns true while the interpolators still hold the end of the last rendered block, or while events wait for the next block
+    */
+    bool isActive() const
+    {
+        return tailRemaining > 0 || ! lowRateEvents.isEmpty();
+    }
+
+    /**
+    * start a block: move the midi to the internal rate and clear the internal bus
+    *
+    * @param events (const juce::MidiBuffer&) midi of the layer at the host rate
+    * @param numSamples (int) number of samples in this block at the host rate
+    * @return number of samples to render at the internal rate ( can be 0 for very small blocks )
+    */
+    int beginBlock(const juce::MidiBuffer& events, int numSamples)
+    {
+        numLowRateSamples = (numSamples > numPending) ? (numSamples - numPending + factor - 1) / factor : 0;
+
+        if (lowRateBus.getNumSamples() < numLowRateSamples) // host sent a bigger block than announced
+            lowRateBus.setSize(2, numLowRateSamples, false, false, true);
+
+        if (upsampled.getNumSamples() < numPending + numLowRateSamples * factor)
+            upsampled.setSize(2, numPending + numLowRateSamples * factor, true, false, true); // keeps the pending samples
+
+        lowRateBus.clear(0, juce::jmax(1, numLowRateSamples));
+
+        // events before the pending samples run out go to the first internal sample,
+        // events of a block with no internal samples wait for the next block
+        int lastSample = juce::jmax(0, numLowRateSamples - 1);
+
+        for (const auto metadata : events)
+        {
+            int position = juce::jlimit(0, lastSample, (metadata.samplePosition - numPending) / factor);
+            lowRateEvents.addEvent(metadata.data, metadata.numBytes, position);
+        }
+
+        return numLowRateSamples;
+    }
+
+    /**
+    * returns the bus to render the layer into at the internal rate ( after beginBlock() )
+    */
+    juce::AudioBuffer<float>& getLowRateBus()
+    {
+        return lowRateBus;
+    }
+
+    /**
+    * returns the midi of the block at the internal rate ( after beginBlock() )
+    */
+    juce::MidiBuffer& getLowRateEvents()
+    {
+        return lowRateEvents;
+    }
+
+    /**
+    * interpolate the internal bus and write the block at the host rate
+    *
+    * @param output (juce::AudioBuffer<float>&) stereo bus of the layer at the host rate
+    * @param numSamples (int) number of samples in this block at the host rate
+    * @param rendered (bool) true if the layer rendered into the internal bus in this block
+    */
+    void endBlock(juce::AudioBuffer<float>& output, int numSamples, bool rendered)
+    {
+        int numAvailable = numPending + numLowRateSamples * factor;
+
+        for (int channel = 0; channel < 2; channel++)
+        {
+            float* samples = upsampled.getWritePointer(channel);
+            interpolators[channel].process(lowRateBus.getReadPointer(channel), samples + numPending, numLowRateSamples);
+
+            juce::FloatVectorOperations::copy(output.getWritePointer(channel), samples, numSamples);
+
+            // samples left over for the next block go to the front
+            for (int i = numSamples; i < numAvailable; i++)
+                samples[i - numSamples] = samples[i];
+        }
+
+        numPending = numAvailable - numSamples;
+
+        if (numLowRateSamples > 0) // the events have been rendered
+            lowRateEvents.clear();
+
+        if (rendered) // the filters are symmetric, the tail lasts twice their latency
+            tailRemaining = 2 * interpolators[0].getLatency() + 1;
+        else
+            tailRemaining -= numLowRateSamples;
+    }
+
+private:
+    int factor = 1;
+    Interpolator interpolators[2];          // left and right
+    juce::AudioBuffer<float> lowRateBus;    // the layer renders into this bus at the internal rate
+    juce::AudioBuffer<float> upsampled;     // interpolated block, starts with the samples left over from the last block
+    juce::MidiBuffer lowRateEvents;
+    int numLowRateSamples = 0;              // samples rendered at the internal rate in this block
+    int numPending = 0;                     // interpolated samples left over from the last block ( less than factor )
+    int tailRemaining = 0;                  // internal samples until the interpolators are silent again
+};
@@ -0,0 +1,348 @@
+/*
+  ==============================================================================
+
+    NoteRenderCache.h
+
+    Contains class NoteRenderCache
+
+    Least recently used cache of pre-rendered note audio. With seeded randomness
+    the start of a note is a pure function of its inputs (note, velocity, mode,
+    speed and seed), so the same note can be replayed with a copy instead of
+    being rendered again. The cached audio does not include the envelope, the
+    voice applies its envelope live
+
+    A miss sends a request to a background thread, which renders the note into
+    the least recently used slot. Each slot also stores the state of the renderer
+    at the end of the cached audio, so a voice that plays longer than the cached
+    audio carries on rendering live from that state
+
+    The slots are only allocated ( and the background thread only started ) when
+    the cache is first used, on the message thread, and the memory is bounded by
+    maxBytes. The audio thread never allocates, never locks and never waits for
+    the background thread, and only uses the cache while isReady(). It does not
+    wake the background thread either ( that takes a lock ), the thread polls
+    the request queue instead
+
+    Requires <JuceHeader.h> for Thread and AbstractFifo
+    Requires <vector>, <atomic>, <memory> and <functional>
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+/**
+* least recently used cache of pre-rendered notes, filled on a background thread
+*
+* @param EndState state of the renderer at the end of the cached audio
+* @param sampleRate (double) sample rate in Hz
+* @param entrySeconds (double) length of the cached audio of a note in seconds
+* @param maxBytes (size_t) memory for the audio and end states of all the slots
+* @param key (const NoteKey&) inputs of the note
+* @return acquire(const NoteKey& key) (int) slot of a cached note, -1 on a miss
+*/
+template <typename EndState>
+class NoteRenderCache : private juce::Thread
+{
+public:
+    /**
+    * inputs that fully define the rendered audio of a note
+    */
+    struct NoteKey
+    {
+        int note = 0;
+        int velocity = 0;       // midi velocity (0 - 127)
+        int mode = 0;
+        float speed = 0.0f;
+        juce::uint64 seed = 0;
+
+        bool operator== (const NoteKey& other) const
+        {
+            return note == other.note && velocity == other.velocity && mode == other.mode
+                && speed == other.speed && seed == other.seed;
+        }
+
+        /**
+        * index of the random stream used to render the note ( different from the stream indices of the voices )
+        */
+        int getStreamIndex() const
+        {
+            return 0x100000 + (note * 128 + velocity) * 8 + mode;
+        }
+    };
+
+    /**
+    * renders the cached audio of a note and returns the state at the end of the audio ( called on the background thread )
+    */
+    using Renderer = std::function<void(const NoteKey& key, float* audio, int numSamples, EndState& endState)>;
+
+    NoteRenderCache() : juce::Thread("Note render cache") {}
+
+    ~NoteRenderCache()
+    {
+        stop();
+    }
+
+    /**
+    * set the size of the cached notes and the renderer, nothing is allocated - called in prepareToPlay(), stop() has to be called first
+    *
+    * @param sampleRate (double) sample rate in Hz
+    * @param entrySeconds (double) length of the cached audio of a note in seconds
+    * @param _maxBytes (size_t) memory for the audio and end states of all the slots
+    * @param stateBytes (size_t) memory of one end state
+    * @param _renderer (Renderer) renders a note, only called on the background thread
+    */
+    void prepare(double sampleRate, double entrySeconds, size_t _maxBytes, size_t stateBytes, Renderer _renderer)
+    {
+        entryLength = juce::jmax(1, (int) (entrySeconds * sampleRate));
+        slotBytes = entryLength * sizeof(float) + stateBytes;
+        maxBytes = _maxBytes;
+        renderer = _renderer;
+    }
+
+    /**
+    * allocate the slots and start the background thread - called on the message thread when the cache is enabled,
+    * after prepare()
+    */
+    void allocateSlots()
+    {
+        stop();
+        int newNumSlots = juce::jlimit(1, maxSlots, (int) (maxBytes / slotBytes));
+
+        if (newNumSlots != numSlots) // the slots are reused when allocating again with the same number of slots
+        {
+            numSlots = newNumSlots;
+            slots.reset(new Slot[numSlots]);
+        }
+
+        for (int i = 0; i < numSlots; i++) // notes cached at the previous sample rate are dropped
+        {
+            slots[i].audio.assign(entryLength, 0.0f);
+            slots[i].state = empty;
+            slots[i].pins = 0;
+            slots[i].lastUsed = 0;
+        }
+
+        requests.reset();
+        startThread();
+        allocated = true;
+    }
+
+    /**
+    * stop the background thread and free the slots - called when the processor is released or the cache is not used
+    */
+    void releaseSlots()
+    {
+        stop();
+        slots.reset();
+        numSlots = 0;
+    }
+
+    /**
+    * stop the background thread, the cache is not used until allocateSlots() - called before prepare()
+    */
+    void stop()
+    {
+        allocated = false;
+        stopThread(4000);
+    }
+
+    /**
+    * returns true while the slots are allocated and the background thread runs, the voices only use the cache then
+    */
+    bool isReady() const
+    {
+        return allocated.load();
+    }
+
+    /**
+    * returns the memory of the slots in bytes
+    */
+    size_t getSizeInBytes() const
+    {
+        return (size_t) numSlots * slotBytes;
+    }
+
+    /**
+    * returns the number of samples of cached audio in a slot
+    */
+    int getEntryLength() const
+    {
+        return entryLength;
+    }
+
+    /**
+    * look for a cached note and hold its slot until release() ( audio thread )
+    * on a miss the note is sent to the background thread
+    *
+    * @param key (const NoteKey&) inputs of the note
+    * @return index of the slot, -1 on a miss
+    */
+    int acquire(const NoteKey& key)
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            Slot& slot = slots[i];
+            slot.pins++;
+
+            if (slot.state.load() == ready && slot.key == key)
+            {
+                slot.lastUsed = ++clock;
+                return i;
+            }
+
+            slot.pins--;
+        }
+
+        request(key);
+        return -1;
+    }
+
+    /**
+    * returns the cached audio of a slot held with acquire()
+    *
+    * @param slot (int) index of the slot
+    */
+    const float* getAudio(int slot) const
+    {
+        return slots[slot].audio.data();
+    }
+
+    /**
+    * returns the state of the renderer at the end of the cached audio of a slot held with acquire()
+    *
+    * @param slot (int) index of the slot
+    */
+    const EndState& getEndState(int slot) const
+    {
+        return slots[slot].endState;
+    }
+
+    /**
+    * let the background thread reuse a slot held with acquire()
+    *
+    * @param slot (int) index of the slot
+    */
+    void release(int slot)
+    {
+        if (slot < numSlots) // the slots may have been freed since
+            slots[slot].pins--;
+    }
+
+private:
+    static constexpr int maxSlots = 256;
+    static constexpr int maxRequests = 64;
+    static constexpr int pollMilliseconds = 5;  // the background thread polls the request queue, a miss waits for it at most this long
+
+    enum SlotState { empty, rendering, ready };
+
+    struct Slot
+    {
+        std::vector<float> audio;
+        EndState endState;
+        NoteKey key;                        // written by the background thread while the slot is rendering
+        std::atomic<int> state { empty };
+        std::atomic<int> pins { 0 };        // voices replaying the slot
+        std::atomic<juce::int64> lastUsed { 0 };
+    };
+
+    /**
+    * send a note to the background thread ( audio thread, the request is dropped if the queue is full )
+    *
+    * @param key (const NoteKey&) inputs of the note
+    */
+    void request(const NoteKey& key)
+    {
+        if (requests.getFreeSpace() < 1)
+            return;
+
+        int start1, size1, start2, size2;
+        requests.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            requestKeys[start1] = key;
+
+        requests.finishedWrite(size1);  // no notify(), waking the thread signals an event which takes a lock
+    }
+
+    /**
+    * background thread - render the requested notes into the least recently used slots
+    */
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (requests.getNumReady() == 0)
+            {
+                wait(pollMilliseconds);
+                continue;
+            }
+
+            int start1, size1, start2, size2;
+            requests.prepareToRead(1, start1, size1, start2, size2);
+            NoteKey key = requestKeys[start1];
+            requests.finishedRead(size1);
+
+            if (findSlot(key))
+                continue;   // already cached or requested twice
+
+            int victim = -1;
+
+            for (int i = 0; i < numSlots; i++) // least recently used slot that no voice is replaying
+            {
+                if (slots[i].pins.load() == 0 && (victim < 0 || slots[i].lastUsed.load() < slots[victim].lastUsed.load()))
+                    victim = i;
+            }
+
+            if (victim < 0)
+                continue;
+
+            Slot& slot = slots[victim];
+            int previousState = slot.state.exchange(rendering);
+
+            if (slot.pins.load() > 0) // a voice acquired the slot in the meantime
+            {
+                slot.state = previousState;
+                continue;
+            }
+
+            slot.key = key;
+            renderer(key, slot.audio.data(), entryLength, slot.endState);
+            slot.lastUsed = ++clock;
+            slot.state = ready;
+        }
+    }
+
+    /**
+    * returns true if a slot holds or is rendering the note ( background thread )
+    *
+    * @param key (const NoteKey&) inputs of the note
+    */
+    bool findSlot(const NoteKey& key) const
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            if (slots[i].state.load() == ready && slots[i].key == key)
+                return true;
+        }
+
+        return false;
+    }
+
+    std::unique_ptr<Slot[]> slots;
+    int numSlots = 0;
+    int entryLength = 0;
+    size_t slotBytes = 0;
+    size_t maxBytes = 0;
+    std::atomic<bool> allocated { false };  // slots allocated and background thread running
+    std::atomic<juce::int64> clock { 0 };   // counter for the least recently used slot
+
+    Renderer renderer;
+    juce::AbstractFifo requests { maxRequests };
+    NoteKey requestKeys[maxRequests];
+};
@@ -1,4 +1,19 @@
 //  Oscillators.h
+//
+//  The oscillators are built from policies at compile time: a wave shape, a
+//  frequency modulation and a phase modulation are plugged into OscillatorStack.
+//  There are no virtual calls, so the whole oscillator chain of a voice (carrier,
+//  frequency modulation, phase modulation ramp) is inlined into one loop body
+//
+//  Oscillator, SineOsc, TriOsc, SquareOsc and PhaseModulationSineOsc are thin
+//  aliases of OscillatorStack and keep their previous functions
+//
+//  Phases are 32-bit fixed point (the full range of an unsigned 32-bit integer is
+//  one cycle), so they wrap exactly and keep the same resolution however long
+//  the oscillator runs and however slow it is
+//
+//  Every policy and OscillatorStack can skip a number of samples at once, which
+//  lets slow modulations run at control rate (see ControlRate.h)
 
 
 #ifndef Oscillators_h
@@ -6,238 +21,498 @@
 #include <cmath>
 #define _USE_MATH_DEFINES     // for M_PI
 #include <math.h>             // for M_PI
+#include <cstdint>            // for the fixed point phases
+#include "ControlRate.h"      // control rate modulations
+
+// ===========================
+// fixed point phase
 
 /**
-* Oscillator class : generates phasor
+* converts a phase or a phase delta in cycles to 32-bit fixed point ( negative values wrap around )
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @return process() (float) output of the phase
+* @param cycles (double) phase in cycles
 */
-class Oscillator
+inline uint32_t cyclesToFixedPhase(double cycles)
 {
-public:
+    return (uint32_t) (int64_t) llround((cycles - floor(cycles)) * 4294967296.0);
+}
 
-    /**
-     * update the phase and output signal
-     *
-     * @return phaseOutput(phase) the phase output
-     */
-    virtual float process()
+/**
+* converts a small phase delta in cycles ( less than half a cycle ) to 32-bit fixed point, used per sample
+*
+* @param cycles (float) phase delta in cycles
+*/
+inline uint32_t smallCyclesToFixedPhase(float cycles)
+{
+    return (uint32_t) (int32_t) (cycles * 4294967296.0f);
+}
+
+/**
+* converts a 32-bit fixed point phase to cycles (0 - 1)
+*
+* @param phase (uint32_t) fixed point phase
+*/
+inline float fixedPhaseToCycles(uint32_t phase)
+{
+    return (float) (phase * (1.0 / 4294967296.0));
+}
+
+// ===========================
+// wave shapes - turn the phase (0 - 1) into the output
+
+/**
+* phasor, outputs the phase
+*/
+struct PhasorShape
+{
+    float operator()(float p) const
     {
-        phase += phaseDelta;
+        return p;
+    }
+};
 
-        if (phase > 1.0f)
-            phase -= 1.0f;
+/**
+* sine wave, the power of the sine wave is shaped with sinPower
+*/
+struct SineShape
+{
+    float operator()(float p) const
+    {
+        float s = (float) sin(p * 2 * M_PI);
+        return (sinPower == 1) ? s : (float) pow(s, sinPower);
+    }
 
-        return phaseOutput(phase);
+    int sinPower = 1;   // default value = 1
+};
+
+/**
+* triangular wave
+*/
+struct TriShape
+{
+    float operator()(float p) const
+    {
+        return fabs(p - 0.5f) - 0.25f;
     }
+};
 
-    /**
-    * virtual function to be manipulated in subclasses
-    */
-    virtual float phaseOutput(float p)
+/**
+* square wave
+*/
+struct SquareShape
+{
+    float operator()(float p) const
     {
-        return p;
+        return (p > pulseWidth) ? -0.5f : 0.5f;
     }
 
-    /**
-     * set the sample rate - needs to be called before setting frequency or using process
-     *
-     * @param _sampleRate (float) samplerate in Hz
-     */
-    void setSampleRate(float _sampleRate)
+    float pulseWidth = 0.5f; // default value
+};
+
+// ===========================
+// frequency modulations - return the change of the phase delta for the next sample
+
+/**
+* no frequency modulation
+*/
+struct NoFrequencyModulation
+{
+    float next()
     {
-        sampleRate = _sampleRate;
+        return 0.0f;
     }
 
-    /**
-     * set the oscillator frequency - The sample rate has to be set first
-     *
-     * @param _frequency (float) oscillator frequency in Hz
-     */
-    void setFrequency(float _frequency)
+    float skip(int)
     {
-        frequency = _frequency;
-        phaseDelta = frequency / sampleRate;
+        return 0.0f;
     }
 
-    /**
-    * function to output a sinusoidal wave to be used for subclasses for modulation
-    */
-    float sinModulation()
+    void reset() {}
+};
+
+/**
+* sinusoidal frequency modulation (vibrato)
+*
+* @param sampleRate (float) sample rate in Hz
+* @param modulationRate (float) frequency of the modulation in Hz
+* @param modulationDepth (float) depth of the modulation in Hz
+*/
+struct SineFrequencyModulation
+{
+    void setParams(float sampleRate, float modulationRate, float modulationDepth)
     {
-        phase += phaseDelta;
+        phaseDelta = cyclesToFixedPhase((double) modulationRate / sampleRate);
+        depth = modulationDepth / sampleRate;
+    }
 
-        if (phase > 1.0f)
-            phase -= 1.0f;
+    float next()
+    {
+        return skip(1);
+    }
 
-        return sin(phase * 2 * M_PI);
+    float skip(int numSamples)
+    {
+        phase += phaseDelta * (uint32_t) numSamples;
+        return depth * (float) sin(fixedPhaseToCycles(phase) * 2 * M_PI);
     }
 
-    /**
-    * returns the phase delta (float)
-    */
-    float getPhaseDelta()
+    void reset()
     {
-        return phaseDelta;
+        phase = 0;
     }
 
-protected:
-    float frequency;
-    float sampleRate;
-    float phase = 0.0f;
-    float phaseDelta;
+    uint32_t phase = 0;
+    uint32_t phaseDelta = 0;
+    float depth = 0.0f;     // depth in Hz / sample rate, default value = 0
 };
 
+// ===========================
+// phase modulations - return the phase offset (in cycles) for the next sample
+
 /**
-* SineOsc class : generates sine oscillator
-* Inherits from Oscillator class
+* no phase modulation
+*/
+struct NoPhaseModulation
+{
+    float next()
+    {
+        return 0.0f;
+    }
+
+    float skip(int)
+    {
+        return 0.0f;
+    }
+
+    void reset() {}
+};
+
+/**
+* LinearIncrease class : ramp from 0 to 1 which resets in a custom set time
+* the position is an integer sample counter, so the ramp never loses resolution or stalls
 *
 * @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @param _modulationRate (float) the rate of the frequency modulation
-* @param _freqModulationDepth (float) the depth of the frequency modulation
-* @param _sinPower (int) the power of the sine wave
-* @return process() (float) output of the sine phase
+* @param durationInSeconds (double) duration to reset the ramp in seconds
+* @param dest (float*) block to write the ramp into
+* @param numSamples (int) number of samples
+* @return process() (float) output of the ramp (0 - 1)
 */
-class SineOsc : public Oscillator
+class LinearIncrease
 {
 public:
+    void setSampleRate(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+        setDuration(durationInSeconds);
+    }
 
     /**
-    * output the phase as a sinusoidal wave with possible pase modulation, the power of the sine wave is shaped with variable sinPower
+    * set the time it takes for the ramp to reset
+    *
+    * @param _durationInSeconds (double) the duration to reset the ramp in seconds
     */
-    float phaseOutput(float p) override
+    void setDuration(double _durationInSeconds)
     {
-        return pow(sin(p * 2 * M_PI), sinPower);
-    }
+        durationInSeconds = _durationInSeconds;
+        durationInSamples = llround(durationInSeconds * sampleRate);
 
+        if (durationInSamples < 1)
+            durationInSamples = 1;
+
+        scale = 1.0 / durationInSamples;
+        counter = counter % durationInSamples;
+    }
 
     /**
-    * set the depth and frequency of the modulation
-    *
-    * @param _modulationRate frequency of modulation
-    * @param _modulationDepth depth of modulation
+    * restart the ramp from zero
     */
-    void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
+    void reset()
     {
-        freqModulationDepth = _freqModulationDepth;
-        modulatingOsc.setSampleRate(sampleRate);
-        modulatingOsc.setFrequency(_modulationRate);
+        counter = 0;
     }
 
     /**
-    * output the value taken from phaseOutput by inputting the phase, manipulate the wave with modulations
-    *
-    * @return phaseOutput(phase) processed phase
+    * outputs the ramp and moves one sample, the ramp resets to zero every durationInSeconds
     */
-    float process() override
+    float process()
     {
-        modulation = freqModulationDepth * modulatingOsc.sinModulation();
+        float out = (float) (counter * scale);
 
-        phaseDelta = (frequency + modulation) / sampleRate;
+        if (++counter >= durationInSamples)
+            counter = 0;
 
-        phase += phaseDelta;
-
-        if (phase > 1.0f)
-            phase -= 1.0f;
-
-        return phaseOutput(phase);
+        return out;
+    }
 
+    /**
+    * move forward without rendering and return the output at the new position
+    *
+    * @param numSamples (int) number of samples
+    */
+    float skip(int numSamples)
+    {
+        counter = (counter + numSamples) % durationInSamples;
+        return (float) (counter * scale);
     }
 
     /**
-    * set the power of the sine wave
+    * render a block of the ramp
     *
-    * @param _sinPower integer value for the power
+    * @param dest (float*) block to write the ramp into
+    * @param numSamples (int) number of samples
     */
-    void setPower(int _sinPower)
+    void process(float* dest, int numSamples)
     {
-        sinPower = _sinPower;
+        int i = 0;
+
+        while (i < numSamples)
+        {
+            // samples until the ramp resets
+            int64_t left = durationInSamples - counter;
+            int length = (int) ((left < numSamples - i) ? left : numSamples - i);
+
+            for (int j = 0; j < length; j++)
+            {
+                dest[i + j] = (float) ((counter + j) * scale);
+            }
+
+            i += length;
+            counter += length;
+
+            if (counter >= durationInSamples)
+                counter = 0;
+        }
     }
 
 private:
-    // variables for frequency modulation, default values = 0
-    float freqModulationDepth = 0;
-    float modulation = 0;
-    // variable for the power of the sine wave, default value = 1
-    int sinPower = 1;
-    // oscillator used to modulate frequency
-    Oscillator modulatingOsc;
+    float sampleRate = 44100.0f;
+    double durationInSeconds = 1.0;
+    int64_t durationInSamples = 44100;
+    int64_t counter = 0;        // position in samples
+    double scale = 1.0 / 44100; // 1 / durationInSamples
 };
 
 /**
-* TriOsc class : generates triangle wave oscillator
-* Inherits from Oscillator class
+* phase modulation with a sinusoidal modulation index which grows over a ramp
 *
 * @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @return process() (float) output of the triangle wave phase
+* @param _frequency (float) frequency of the modulating oscillator in Hz
+* @param _durationInSeconds (int) duration to reset the ramp in seconds
 */
-class TriOsc : public Oscillator
+class RampPhaseModulation
 {
+public:
+    void setParams(float _sampleRate, float _frequency, int _durationInSeconds)
+    {
+        linearIncrease.setSampleRate(_sampleRate);
+        linearIncrease.setDuration(_durationInSeconds);
+        rampDelta = cyclesToFixedPhase((double) _frequency / _sampleRate);
+    }
+
+    float next()
+    {
+        // linIncrease - variable that increases linearly from 0 to 1, then resets
+        float linIncrease = linearIncrease.process();
+        rampPhase += rampDelta;
+        return evaluate(linIncrease);
+    }
+
+    float skip(int numSamples)
+    {
+        float linIncrease = linearIncrease.skip(numSamples);
+        rampPhase += rampDelta * (uint32_t) numSamples;
+        return evaluate(linIncrease);
+    }
+
+    void reset()
+    {
+        linearIncrease.reset();
+        rampPhase = 0;
+    }
+
+private:
     /**
-    * output triangular wave
+    * phase offset ( in cycles ) for a position of the ramp and the current phase of the modulating oscillator
+    *
+    * @param linIncrease (float) position of the ramp (0 - 1)
     */
-    float phaseOutput(float p) override
+    float evaluate(float linIncrease) const
     {
-        return fabs(p - 0.5) - 0.25;
+        // cycle - scale linIncrease into range -1 to 1
+        float cycle = (float) sin(linIncrease * M_PI);
+
+        // modulationIndex - sinusoidal modulation index which increases in amplitude every cycle
+        float modulationIndex = linIncrease * 10 * cycle;
+
+        // output of modulating oscillator ( in cycles )
+        return modulationIndex * (float) sin(fixedPhaseToCycles(rampPhase) * 2 * M_PI) / (float) (2 * M_PI);
     }
 
+    LinearIncrease linearIncrease;  // ramp for phase modulation
+    uint32_t rampPhase = 0;         // phasor for phase modulation
+    uint32_t rampDelta = 0;
 };
 
+// ===========================
+// oscillator built from the policies
+
 /**
-* LinearIncrease class : generates phasor oscillator
-* resets in a custom set time
-* Inherits from Oscillator class
+* OscillatorStack class : oscillator built from a wave shape, a frequency modulation and a phase modulation
+* every call is resolved at compile time
 *
 * @param _sampleRate (float) sample rate in Hz
 * @param _frequency (float) frequency in Hz
-* @param durationInSeconds (int) duration to reset the phase in seconds
-* @return process() (float) output of the phasor phase
+* @param dest (float*) block to write the output into
+* @param numSamples (int) number of samples
+* @return process() (float) output of the oscillator
 */
-class LinearIncrease : public Oscillator
+template <typename Shape, typename FrequencyModulation = NoFrequencyModulation, typename PhaseModulation = NoPhaseModulation>
+class OscillatorStack
 {
 public:
 
     /**
-    * resets the phase to zero every durationInSeconds
-    *
-    * @param durationInSeconds (int) the duration to reset the phase in seconds
-    */
-    float process(int durationInSeconds)
+     * update the phase and output signal
+     *
+     * @return the output of the wave shape
+     */
+    float process()
     {
-        phase += 1;
+        phase += phaseIncrement + smallCyclesToFixedPhase(frequencyModulation.next()); // wraps around on its own
+        return shape(fixedPhaseToCycles(phase) + phaseModulation.next());
+    }
 
-        if (phase == (sampleRate * durationInSeconds)) // duration in samples
+    /**
+     * render a block of samples
+     *
+     * @param dest (float*) block to write the output into
+     * @param numSamples (int) number of samples
+     */
+    void process(float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++)
         {
-            phase = 0;
+            dest[i] = process();
         }
+    }
 
-        return phaseOutput(phase);
+    /**
+     * move forward without rendering and return the output at the new position ( used at control rate )
+     *
+     * @param numSamples (int) number of samples, 0 returns the output at the current position
+     */
+    float skip(int numSamples)
+    {
+        float frequencyDelta = frequencyModulation.skip(numSamples);
+        phase += (phaseIncrement + smallCyclesToFixedPhase(frequencyDelta)) * (uint32_t) numSamples;
+        return shape(fixedPhaseToCycles(phase) + phaseModulation.skip(numSamples));
     }
+
+    /**
+     * restart the oscillator and its modulations from phase zero
+     */
+    void reset()
+    {
+        phase = 0;
+        frequencyModulation.reset();
+        phaseModulation.reset();
+    }
+
+    /**
+     * set the sample rate - needs to be called before setting frequency or using process
+     *
+     * @param _sampleRate (float) samplerate in Hz
+     */
+    void setSampleRate(float _sampleRate)
+    {
+        sampleRate = _sampleRate;
+    }
+
+    /**
+     * set the oscillator frequency - The sample rate has to be set first
+     *
+     * @param _frequency (float) oscillator frequency in Hz
+     */
+    void setFrequency(float _frequency)
+    {
+        frequency = _frequency;
+        phaseDelta = frequency / sampleRate;
+        phaseIncrement = cyclesToFixedPhase((double) frequency / sampleRate);
+    }
+
+    /**
+    * returns the phase delta (float)
+    */
+    float getPhaseDelta()
+    {
+        return phaseDelta;
+    }
+
+protected:
+    float frequency;
+    float sampleRate;
+    uint32_t phase = 0;         // fixed point phase
+    uint32_t phaseIncrement = 0;
+    float phaseDelta = 0.0f;    // phase increment in cycles
+
+    // policies
+    Shape shape;
+    FrequencyModulation frequencyModulation;
+    PhaseModulation phaseModulation;
 };
 
+/**
+* Oscillator class : generates phasor
+*/
+using Oscillator = OscillatorStack<PhasorShape>;
+
+/**
+* TriOsc class : generates triangle wave oscillator
+*/
+using TriOsc = OscillatorStack<TriShape>;
 
 /**
-* PhaseModulationSineOsc class : generates phase modulate sine oscillator
-* Inherits from Oscillator class
+* SineOsc class : generates sine oscillator, the frequency modulation runs at control rate
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
-* @param _durationInSeconds (int) duration to reset the phase in seconds
-* @return process() (float) output of the phase modulated sine phase
+* @param _modulationRate (float) the rate of the frequency modulation
+* @param _freqModulationDepth (float) the depth of the frequency modulation
+* @param _sinPower (int) the power of the sine wave
 */
-class PhaseModulationSineOsc : public Oscillator
+class SineOsc : public OscillatorStack<SineShape, ControlRateModulation<SineFrequencyModulation>>
 {
 public:
-    float phaseOutput(float p) override
+
+    /**
+    * set the depth and frequency of the modulation
+    *
+    * @param _modulationRate frequency of modulation
+    * @param _modulationDepth depth of modulation
+    */
+    void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
     {
-        phaseModulate();
-        return (sin(finalModulation + (p * 2 * M_PI)));
+        frequencyModulation.setParams(sampleRate, _modulationRate, _freqModulationDepth);
     }
 
+    /**
+    * set the power of the sine wave
+    *
+    * @param _sinPower integer value for the power
+    */
+    void setPower(int _sinPower)
+    {
+        shape.sinPower = _sinPower;
+    }
+};
+
+/**
+* PhaseModulationSineOsc class : generates phase modulate sine oscillator, the slow modulations run at control rate
+*
+* @param _durationInSeconds (int) duration to reset the phase in seconds
+*/
+class PhaseModulationSineOsc : public OscillatorStack<SineShape, ControlRateModulation<SineFrequencyModulation>, ControlRateModulation<RampPhaseModulation>>
+{
+public:
+
     /**
     * sets the parameters for the oscillator used to modulate the phase
     * these parameters must be set in order to use this class
@@ -248,29 +523,7 @@ public:
     */
     void setRampParams(float _sampleRate, float _frequency, int _durationInSeconds)
     {
-        linearIncrease.setSampleRate(_sampleRate);
-        linearIncrease.setFrequency(_frequency);
-        rampMod.setSampleRate(_sampleRate);
-        rampMod.setFrequency(_frequency);
-        durationInSeconds = _durationInSeconds;
-    }
-
-    /**
-    * modulates the output, this function is called in phaseOutput()
-    */
-    void phaseModulate()
-    {
-        // linIncrease - variable that increases in value linearly
-        float linIncrease = linearIncrease.process(durationInSeconds * sampleRate) / (float)(durationInSeconds * sampleRate);
-
-        // cycle - scale linIncrease into range -1 to 1
-        float cycle = sin(linIncrease * M_PI);
-
-        // modulationIndex - sinusoidal modulation index which increases in amplitude every cycle 
-        float modulationIndex = linIncrease * 10 * cycle;
-
-        //output of modulating oscillator
-        finalModulation = modulationIndex * sin(rampMod.process() * 2 * M_PI);
+        phaseModulation.setParams(_sampleRate, _frequency, _durationInSeconds);
     }
 
     /**
@@ -281,53 +534,19 @@ public:
     */
     void setFreqModulationParams(float _modulationRate, float _freqModulationDepth)
     {
-        freqModulationDepth = _freqModulationDepth;
-        modulatingOsc.setSampleRate(sampleRate);
-        modulatingOsc.setFrequency(_modulationRate);
+        frequencyModulation.setParams(sampleRate, _modulationRate, _freqModulationDepth);
     }
-
-private:
-
-    // variables for phase modulation
-    float finalModulation;
-    int durationInSeconds;
-
-    // variables for frequency modulation, default values = 0
-    float freqModulationDepth = 0;
-    float modulation = 0;
-
-    // oscillators
-    Oscillator modulatingOsc;       // oscillator for frequency modulation
-    LinearIncrease linearIncrease; // phasor for phase modulation
-    Oscillator rampMod;            // phasor for phase modulation
 };
 
 /**
 * SquareOsc class : generates square wave oscillator
-* Inherits from Oscillator class
 *
-* @param _sampleRate (float) sample rate in Hz
-* @param _frequency (float) frequency in Hz
 * @param _pulseWidth (float) the pulse width (default value = 0.5)
-* @return process() (float) output of the phase modulated sine phase
 */
-class SquareOsc : public Oscillator
+class SquareOsc : public OscillatorStack<SquareShape>
 {
 public:
 
-    /**
-    * output square wave
-    */
-    float phaseOutput(float p) override
-    {
-        float outVal = 0.5;
-
-        if (p > pulseWidth)
-            outVal = -0.5;
-
-        return outVal;
-    }
-
     /**
     * set pulse width
     *
@@ -335,11 +554,8 @@ public:
     */
     void setPulseWidth(float _pulseWidth)
     {
-        pulseWidth = _pulseWidth;
+        shape.pulseWidth = _pulseWidth;
     }
-
-private:
-    float pulseWidth = 0.5f; // default value
 };
 
 #endif /* Oscillators_h */
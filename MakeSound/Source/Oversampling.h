@@ -0,0 +1,368 @@
+/*
+  ==============================================================================
+
+    Oversampling.h
+
+    Contains class HalfBandDecimator
+    Contains class Decimator
+    Contains class HalfBandInterpolator
+    Contains class Interpolator
+
+    Polyphase half-band FIR filters used to bring an oversampled signal back down
+    to the host sample rate (2x or 4x), and to bring a signal rendered at a lower
+    internal rate up to the host sample rate (2x or 4x)
+
+    Every second coefficient of a half-band filter is zero, so the filter is split
+    into two branches: the even input samples go through the non-zero taps (one
+    contiguous dot product, vectorised by the compiler) and the odd input samples
+    only go through the centre tap (a plain delay). The interpolators use the
+    same filter the other way round: every input sample makes one output sample
+    from the non-zero taps and one from the centre tap
+
+    Requires <cmath> for sin() and cos()
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <cmath>
+#include <JuceHeader.h>
+
+/**
+* decimates by 2 with a linear phase half-band FIR filter
+*
+* @param input (const float*) input at twice the output rate
+* @param output (float*) output
+* @param numOutputSamples (int) number of output samples (input holds twice as many)
+*/
+class HalfBandDecimator
+{
+public:
+    static constexpr int numPairs = 12;                 // 4 * numPairs - 1 taps (47 taps)
+    static constexpr int numEvenTaps = 2 * numPairs;    // non-zero taps of the even branch
+
+    HalfBandDecimator()
+    {
+        designCoefficients(coefficients);
+        reset();
+    }
+
+    /**
+    * design the non-zero taps of the half-band filter ( also used by HalfBandInterpolator )
+    *
+    * @param coefficients (float*) numEvenTaps taps, the centre tap is always 0.5
+    */
+    static void designCoefficients(float* coefficients)
+    {
+        // windowed sinc, cut off at a quarter of the input sample rate (Blackman window)
+        const int numTaps = 4 * numPairs - 1;
+        const int centre = numTaps / 2;
+        float sum = 0.5f;
+
+        for (int j = 0; j < numEvenTaps; j++)
+        {
+            int n = 2 * j - centre;  // distance of this tap from the centre (always odd)
+            double x = juce::MathConstants<double>::pi * n * 0.5;
+            double window = 0.42 + 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / (numTaps + 1))
+                                 + 0.08 * std::cos(2.0 * juce::MathConstants<double>::twoPi * n / (numTaps + 1));
+            coefficients[j] = (float)(0.5 * std::sin(x) / x * window);
+            sum += coefficients[j];
+        }
+
+        for (int j = 0; j < numEvenTaps; j++) // unity gain at dc
+        {
+            coefficients[j] *= 0.5f / (sum - 0.5f);
+        }
+    }
+
+    /**
+    * clear the filter history
+    */
+    void reset()
+    {
+        for (int i = 0; i < 2 * numEvenTaps; i++)
+            evenHistory[i] = 0.0f;
+
+        for (int i = 0; i < numPairs; i++)
+            oddHistory[i] = 0.0f;
+
+        evenPos = 0;
+        oddPos = 0;
+    }
+
+    /**
+    * filter and decimate by 2
+    *
+    * @param input (const float*) input at twice the output rate
+    * @param output (float*) output
+    * @param numOutputSamples (int) number of output samples (input holds twice as many)
+    */
+    void process(const float* input, float* output, int numOutputSamples)
+    {
+        for (int i = 0; i < numOutputSamples; i++)
+        {
+            // even branch - history is stored twice so the newest numEvenTaps samples are contiguous
+            evenPos = (evenPos == 0) ? numEvenTaps - 1 : evenPos - 1;
+            evenHistory[evenPos] = input[2 * i];
+            evenHistory[evenPos + numEvenTaps] = input[2 * i];
+
+            const float* window = evenHistory + evenPos;
+            float acc = 0.0f;
+
+            for (int j = 0; j < numEvenTaps; j++)
+            {
+                acc += window[j] * coefficients[j];
+            }
+
+            // odd branch - centre tap, delayed by numPairs pairs
+            float centreSample = oddHistory[oddPos];
+            oddHistory[oddPos] = input[2 * i + 1];
+            oddPos = (oddPos + 1 < numPairs) ? oddPos + 1 : 0;
+
+            output[i] = acc + 0.5f * centreSample;
+        }
+    }
+
+private:
+    alignas(16) float coefficients[numEvenTaps];
+    alignas(16) float evenHistory[2 * numEvenTaps];
+    float oddHistory[numPairs];
+    int evenPos = 0;
+    int oddPos = 0;
+};
+
+/**
+* decimates an oversampled block by 1, 2 or 4 (cascaded half-band stages)
+*
+* @param _factor (int) oversampling factor (1, 2 or 4)
+* @param numOutputSamples (int) number of samples at the base rate
+* @return getInputBlock() (float*) block to render the oversampled signal into
+*/
+class Decimator
+{
+public:
+    static constexpr int maxFactor = 4;
+    static constexpr int maxOutputSize = 256;
+
+    /**
+    * set the oversampling factor and clear the filters
+    *
+    * @param _factor (int) oversampling factor (1, 2 or 4)
+    */
+    void setFactor(int _factor)
+    {
+        factor = (_factor >= 4) ? 4 : (_factor >= 2 ? 2 : 1);
+        firstStage.reset();
+        secondStage.reset();
+    }
+
+    /**
+    * returns the oversampling factor
+    */
+    int getFactor()
+    {
+        return factor;
+    }
+
+    /**
+    * returns the block to render the oversampled signal into, holds maxOutputSize * factor samples
+    */
+    float* getInputBlock()
+    {
+        return input;
+    }
+
+    /**
+    * decimate the input block
+    *
+    * @param output (float*) output at the base rate
+    * @param numOutputSamples (int) number of samples at the base rate (maxOutputSize at most)
+    */
+    void process(float* output, int numOutputSamples)
+    {
+        if (factor == 1)
+        {
+            juce::FloatVectorOperations::copy(output, input, numOutputSamples);
+        }
+        else if (factor == 2)
+        {
+            firstStage.process(input, output, numOutputSamples);
+        }
+        else
+        {
+            firstStage.process(input, intermediate, numOutputSamples * 2);
+            secondStage.process(intermediate, output, numOutputSamples);
+        }
+    }
+
+private:
+    int factor = 1;
+    HalfBandDecimator firstStage;
+    HalfBandDecimator secondStage;
+    alignas(16) float input[maxOutputSize * maxFactor] = {};
+    alignas(16) float intermediate[maxOutputSize * 2] = {};
+};
+
+/**
+* interpolates by 2 with the same linear phase half-band FIR filter as HalfBandDecimator
+*
+* @param input (const float*) input at half the output rate
+* @param output (float*) output
+* @param numInputSamples (int) number of input samples (output holds twice as many)
+*/
+class HalfBandInterpolator
+{
+public:
+    static constexpr int numPairs = HalfBandDecimator::numPairs;
+    static constexpr int numEvenTaps = HalfBandDecimator::numEvenTaps;
+
+    HalfBandInterpolator()
+    {
+        HalfBandDecimator::designCoefficients(coefficients);
+
+        for (int j = 0; j < numEvenTaps; j++) // zeros are stuffed between the input samples, so the gain is doubled
+        {
+            coefficients[j] *= 2.0f;
+        }
+
+        reset();
+    }
+
+    /**
+    * clear the filter history
+    */
+    void reset()
+    {
+        for (int i = 0; i < 2 * numEvenTaps; i++)
+            history[i] = 0.0f;
+
+        pos = 0;
+    }
+
+    /**
+    * interpolate by 2 and filter
+    *
+    * @param input (const float*) input at half the output rate
+    * @param output (float*) output
+    * @param numInputSamples (int) number of input samples (output holds twice as many)
+    */
+    void process(const float* input, float* output, int numInputSamples)
+    {
+        for (int i = 0; i < numInputSamples; i++)
+        {
+            // history is stored twice so the newest numEvenTaps samples are contiguous
+            pos = (pos == 0) ? numEvenTaps - 1 : pos - 1;
+            history[pos] = input[i];
+            history[pos + numEvenTaps] = input[i];
+
+            const float* window = history + pos;
+            float acc = 0.0f;
+
+            for (int j = 0; j < numEvenTaps; j++)
+            {
+                acc += window[j] * coefficients[j];
+            }
+
+            // the centre tap ( 0.5, doubled ) sits between the two middle samples of the window
+            output[2 * i] = acc;
+            output[2 * i + 1] = window[numPairs - 1];
+        }
+    }
+
+private:
+    alignas(16) float coefficients[numEvenTaps];
+    alignas(16) float history[2 * numEvenTaps];
+    int pos = 0;
+};
+
+/**
+* interpolates a block rendered at a lower rate by 1, 2 or 4 (cascaded half-band stages)
+*
+* @param _factor (int) ratio between the output rate and the input rate (1, 2 or 4)
+* @param input (const float*) input at the lower rate
+* @param output (float*) output, holds numInputSamples * factor samples
+* @param numInputSamples (int) number of samples at the lower rate
+*/
+class Interpolator
+{
+public:
+    static constexpr int maxFactor = 4;
+    static constexpr int maxInputSize = 256;
+
+    /**
+    * set the interpolation factor and clear the filters
+    *
+    * @param _factor (int) ratio between the output rate and the input rate (1, 2 or 4)
+    */
+    void setFactor(int _factor)
+    {
+        factor = (_factor >= 4) ? 4 : (_factor >= 2 ? 2 : 1);
+        firstStage.reset();
+        secondStage.reset();
+    }
+
+    /**
+    * returns the interpolation factor
+    */
+    int getFactor()
+    {
+        return factor;
+    }
+
+    /**
+    * returns the delay of the filters in samples of the lower rate ( rounded up )
+    */
+    int getLatency()
+    {
+        if (factor == 1)
+            return 0;
+
+        if (factor == 2)
+            return numPairs;
+
+        return numPairs + numPairs / 2;
+    }
+
+    /**
+    * interpolate a block, in chunks of maxInputSize
+    *
+    * @param input (const float*) input at the lower rate
+    * @param output (float*) output, holds numInputSamples * factor samples
+    * @param numInputSamples (int) number of samples at the lower rate
+    */
+    void process(const float* input, float* output, int numInputSamples)
+    {
+        if (factor == 1)
+        {
+            juce::FloatVectorOperations::copy(output, input, numInputSamples);
+            return;
+        }
+
+        while (numInputSamples > 0)
+        {
+            int chunk = juce::jmin(numInputSamples, maxInputSize);
+
+            if (factor == 2)
+            {
+                firstStage.process(input, output, chunk);
+            }
+            else
+            {
+                firstStage.process(input, intermediate, chunk);
+                secondStage.process(intermediate, output, chunk * 2);
+            }
+
+            input += chunk;
+            output += chunk * factor;
+            numInputSamples -= chunk;
+        }
+    }
+
+private:
+    static constexpr int numPairs = HalfBandInterpolator::numPairs;
+
+    int factor = 1;
+    HalfBandInterpolator firstStage;
+    HalfBandInterpolator secondStage;
+    alignas(16) float intermediate[maxInputSize * 2] = {};
+};
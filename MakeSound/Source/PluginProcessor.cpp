@@ -25,10 +25,39 @@ MakeSoundAudioProcessor::MakeSoundAudioProcessor()
     std::make_unique < juce::AudioParameterFloat >("topVolume", "Top Synth Volume", 0.0f , 1.0f , 0.8f) ,
     std::make_unique < juce::AudioParameterFloat >("middleVolume", "Middle Synth Volume", 0.0f , 1.0f , 0.6f) ,
     std::make_unique < juce::AudioParameterFloat >("bottomVolume", "Bottom Synth Volume", 0.0f , 1.0f , 0.8f) ,
+    std::make_unique < juce::AudioParameterFloat >("topPan", "Top Synth Pan", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterFloat >("middlePan", "Middle Synth Pan", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterFloat >("bottomPan", "Bottom Synth Pan", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterFloat >("autoPan", "Auto Pan Depth", 0.0f , 1.0f , 0.5f) ,
+    std::make_unique < juce::AudioParameterFloat >("voiceSpread", "Voice Stereo Spread", 0.0f , 1.0f , 0.25f) ,
     std::make_unique < juce::AudioParameterFloat >("reverbSize", "Reverb Size", juce::NormalisableRange<float>(0.01, 0.99, 0.05, 1.75) , 0.75f),
     std::make_unique < juce::AudioParameterChoice >("cutOffMode", "Middle Synth Filter Type", juce::StringArray({ "Low-pass", "High-pass", "Band-pass", "None" }), 2),
     std::make_unique < juce::AudioParameterInt >("minCut", "Min cutoff value", 50 , 1000 , 200),
     std::make_unique < juce::AudioParameterInt >("maxCut", "Max cutoff value", 50 , 1000 , 500),
+    std::make_unique < juce::AudioParameterChoice >("fmAlgorithm", "Middle Synth FM Algorithm", juce::StringArray({ "Stack", "Branch", "Two Stacks", "Triple Carrier", "Single Modulator", "Additive" }), 2),
+    std::make_unique < juce::AudioParameterFloat >("fmBrightness", "Middle Synth FM Brightness", 0.0f , 1.0f , 0.4f) ,
+    std::make_unique < juce::AudioParameterBool >("pulseSync", "Bottom Synth Tempo Sync", false),
+    std::make_unique < juce::AudioParameterBool >("noteCache", "Bottom Synth Note Cache", false),
+    std::make_unique < juce::AudioParameterChoice >("liveOversampling", "Middle Synth Oversampling (Live)", juce::StringArray({ "Off", "2x", "4x" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("renderOversampling", "Middle Synth Oversampling (Render)", juce::StringArray({ "Off", "2x", "4x" }), 2),
+    std::make_unique < juce::AudioParameterChoice >("fmInternalRate", "Middle Synth Internal Rate", juce::StringArray({ "Full", "Auto", "1/2", "1/4" }), 0),
+    std::make_unique < juce::AudioParameterFloat >("delayTime", "Delay Time", 0.05f , (float) SendDelay::maxDelaySeconds , 0.5f) ,
+    std::make_unique < juce::AudioParameterFloat >("delayFeedback", "Delay Feedback", 0.0f , (float) SendDelay::maxFeedback , 0.0f) ,
+    std::make_unique < juce::AudioParameterChoice >("delayMode", "Delay Mode", juce::StringArray({ "Stereo", "Ping-Pong" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("mod1Source", "Mod 1 Source", juce::StringArray({ "Off", "LFO 1", "LFO 2", "Envelope", "Velocity", "Mod Wheel", "Random" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("mod1Destination", "Mod 1 Destination", juce::StringArray({ "Cutoff", "Gain", "Pitch", "Pan", "Delay Send" }), 0),
+    std::make_unique < juce::AudioParameterFloat >("mod1Amount", "Mod 1 Amount", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterChoice >("mod2Source", "Mod 2 Source", juce::StringArray({ "Off", "LFO 1", "LFO 2", "Envelope", "Velocity", "Mod Wheel", "Random" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("mod2Destination", "Mod 2 Destination", juce::StringArray({ "Cutoff", "Gain", "Pitch", "Pan", "Delay Send" }), 1),
+    std::make_unique < juce::AudioParameterFloat >("mod2Amount", "Mod 2 Amount", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterChoice >("mod3Source", "Mod 3 Source", juce::StringArray({ "Off", "LFO 1", "LFO 2", "Envelope", "Velocity", "Mod Wheel", "Random" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("mod3Destination", "Mod 3 Destination", juce::StringArray({ "Cutoff", "Gain", "Pitch", "Pan", "Delay Send" }), 2),
+    std::make_unique < juce::AudioParameterFloat >("mod3Amount", "Mod 3 Amount", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterChoice >("mod4Source", "Mod 4 Source", juce::StringArray({ "Off", "LFO 1", "LFO 2", "Envelope", "Velocity", "Mod Wheel", "Random" }), 0),
+    std::make_unique < juce::AudioParameterChoice >("mod4Destination", "Mod 4 Destination", juce::StringArray({ "Cutoff", "Gain", "Pitch", "Pan", "Delay Send" }), 3),
+    std::make_unique < juce::AudioParameterFloat >("mod4Amount", "Mod 4 Amount", -1.0f , 1.0f , 0.0f) ,
+    std::make_unique < juce::AudioParameterFloat >("modLfo1Rate", "Mod LFO 1 Rate", juce::NormalisableRange<float>(0.01f, 20.0f, 0.0f, 0.3f) , 0.5f),
+    std::make_unique < juce::AudioParameterFloat >("modLfo2Rate", "Mod LFO 2 Rate", juce::NormalisableRange<float>(0.01f, 20.0f, 0.0f, 0.3f) , 4.0f),
     std::make_unique < juce::AudioParameterBool >("ionian", "Ionian / Major", true),
     std::make_unique < juce::AudioParameterBool >("dorian", "Dorian", true),
     std::make_unique < juce::AudioParameterBool >("phrygian", "Phrygian", true),
@@ -43,10 +72,36 @@ MakeSoundAudioProcessor::MakeSoundAudioProcessor()
     volumeParameterTop = avpts.getRawParameterValue("topVolume");
     volumeParameterMiddle = avpts.getRawParameterValue("middleVolume");
     volumeParameterBottom = avpts.getRawParameterValue("bottomVolume");
+    panParameterTop = avpts.getRawParameterValue("topPan");
+    panParameterMiddle = avpts.getRawParameterValue("middlePan");
+    panParameterBottom = avpts.getRawParameterValue("bottomPan");
+    autoPanParameter = avpts.getRawParameterValue("autoPan");
+    voiceSpreadParameter = avpts.getRawParameterValue("voiceSpread");
     reverbParameter = avpts.getRawParameterValue("reverbSize");
     cuttOffMode = avpts.getRawParameterValue("cutOffMode");
     minVal = avpts.getRawParameterValue("minCut");
     maxVal = avpts.getRawParameterValue("maxCut");
+    fmAlgorithm = avpts.getRawParameterValue("fmAlgorithm");
+    fmBrightness = avpts.getRawParameterValue("fmBrightness");
+    pulseSync = avpts.getRawParameterValue("pulseSync");
+    noteCacheParameter = avpts.getRawParameterValue("noteCache");
+    liveOversampling = avpts.getRawParameterValue("liveOversampling");
+    renderOversampling = avpts.getRawParameterValue("renderOversampling");
+    fmInternalRate = avpts.getRawParameterValue("fmInternalRate");
+    delayTime = avpts.getRawParameterValue("delayTime");
+    delayFeedback = avpts.getRawParameterValue("delayFeedback");
+    delayMode = avpts.getRawParameterValue("delayMode");
+
+    for (int slot = 0; slot < numModSlots; slot++)
+    {
+        juce::String prefix = "mod" + juce::String(slot + 1);
+        modSource[slot] = avpts.getRawParameterValue(prefix + "Source");
+        modDestination[slot] = avpts.getRawParameterValue(prefix + "Destination");
+        modAmount[slot] = avpts.getRawParameterValue(prefix + "Amount");
+    }
+
+    modLfoRate[0] = avpts.getRawParameterValue("modLfo1Rate");
+    modLfoRate[1] = avpts.getRawParameterValue("modLfo2Rate");
     Ionian = avpts.getRawParameterValue("ionian"); 
     Dorian = avpts.getRawParameterValue("dorian");  
     Phrygian = avpts.getRawParameterValue("phrygian");  
@@ -60,43 +115,83 @@ MakeSoundAudioProcessor::MakeSoundAudioProcessor()
         synth.addVoice( new MelodyVoice() );
         synthPulse.addVoice(new pulseSynthVoice());
         synth2.addVoice(new FMsynthVoice());
+
+        // the dsp state of the voices lives in the bank of their synthesiser
+        dynamic_cast<MelodyVoice*>(synth.getVoice(i))->setBank(&synth.getBank(), i);
+        dynamic_cast<FMsynthVoice*>(synth2.getVoice(i))->setBank(&synth2.getBank(), i);
+        dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i))->setSendDelay(&sendDelays[pulseLayer]);
     }
 
+    // the voices of each layer send to the delay of the layer
+    synth.getBank().setSendDelay(&sendDelays[melodyLayer]);
+    synth2.getBank().setSendDelay(&sendDelays[fmLayer]);
+
+    for (int i = 0; i < voiceCount; i++) // one column of the modulation matrix per voice and layer
+    {
+        dynamic_cast<MelodyVoice*>(synth.getVoice(i))->setModulation(&modMatrix, melodyLayer * voiceCount + i);
+        dynamic_cast<FMsynthVoice*>(synth2.getVoice(i))->setModulation(&modMatrix, fmLayer * voiceCount + i);
+        dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i))->setModulation(&modMatrix, pulseLayer * voiceCount + i);
+    }
+
+    // keyboard split, same ranges as the sounds of each synthesiser
+    router.setKeyRange(melodyLayer, 0, 35);     // C2 and below
+    router.setKeyRange(fmLayer, 36, 47);        // C#2 to B2
+    router.setKeyRange(pulseLayer, 48, 127);    // C3 and above
+
     synth.addSound( new MelodySound() );
     synthPulse.addSound(new pulseSynthSound());
     synth2.addSound(new FMSynthSound());
 
     // loop that gets updated 
-    for (int i = 0; i < voiceCount; i++) // set detune 
+    for (int i = 0; i < voiceCount; i++) // set filter parameters
     {
-        MelodyVoice* v = dynamic_cast<MelodyVoice*>(synth.getVoice(i));
-        v->setVolumePointer(volumeParameterTop);
-
         FMsynthVoice* d = dynamic_cast<FMsynthVoice*>(synth2.getVoice(i));
-        d->setVolumePointer(volumeParameterMiddle);
         d->setModFilterParams(cuttOffMode, minVal, maxVal);
-
-        pulseSynthVoice* point = dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i));
-        point->setVolumePointer(volumeParameterBottom);
-
+        d->setFMParams(fmAlgorithm, fmBrightness);
     }
+
+    // factory presets, parameters that are not listed keep their default value
+    presets.compile(avpts, {
+        { "Default", {} },
+        { "Wide Drift", { { "autoPan", 1.0f }, { "voiceSpread", 0.8f }, { "reverbSize", 0.9f } } },
+        { "Dark Pads", { { "topVolume", 0.5f }, { "middleVolume", 0.8f }, { "bottomVolume", 0.5f },
+                         { "cutOffMode", 0.0f }, { "minCut", 80.0f }, { "maxCut", 300.0f }, { "reverbSize", 0.85f },
+                         { "fmAlgorithm", 0.0f }, { "fmBrightness", 0.2f } } },
+        { "Bright Pulse", { { "topVolume", 0.6f }, { "bottomVolume", 1.0f }, { "cutOffMode", 1.0f },
+                            { "minCut", 400.0f }, { "maxCut", 1000.0f }, { "reverbSize", 0.5f }, { "autoPan", 0.3f },
+                            { "fmAlgorithm", 3.0f }, { "fmBrightness", 0.7f } } },
+        { "Minor Modes", { { "ionian", 0.0f }, { "lydian", 0.0f }, { "mixolydian", 0.0f } } }
+    });
+
+    startTimerHz(10); // host updates for presets applied on the audio thread
 }
 
 MakeSoundAudioProcessor::~MakeSoundAudioProcessor()
 {
+    pulseCache.stop();
 }
 
 void MakeSoundAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // lfo variables for panning
-    leftPan.setSampleRate(sampleRate);
-    rightPan.setSampleRate(sampleRate);
-    leftPan.setFrequency(0.05);
-    rightPan.setFrequency(0.1);
+    pulseCache.stop(); // the cache thread uses the arena
+
+    // one block of memory for the delay lines of every layer
+    arena.prepare(numLayers * SendDelay::getArenaSize(sampleRate));
+
+    for (int layer = 0; layer < numLayers; layer++)
+    {
+        sendDelays[layer].prepare(sampleRate, samplesPerBlock, arena);
+    }
+
+    // mixer buses
+    mixer.prepare(sampleRate, samplesPerBlock, numLayers);
+    fmRate.prepare(samplesPerBlock);    // the middle synth starts at the host rate
+    presets.prepare(sampleRate);
+    router.prepare(numLayers);
+    modMatrix.prepare(sampleRate, numLayers * voiceCount);
 
-    // smooth value setting
-    smoothReverb.reset(sampleRate, 1.0f);
-    smoothReverb.setCurrentAndTargetValue(0.0);
+    // reseed before init() so the random values picked in init() are reproducible
+    applyRandomSeed();
 
     // set the sample rate of synths
     synth.setCurrentPlaybackSampleRate(sampleRate); 
@@ -113,17 +208,35 @@ void MakeSoundAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlo
         d->init(sampleRate);
     }
 
+    // note cache of the bottom synth, the cache thread renders notes like a voice
+    pulseCacheKey.setOscillatorParams(sampleRate);
+    pulseCacheKey.generateNotesForModes(4);
+    pulseCache.prepare(sampleRate, noteCacheSeconds, noteCacheBytes, sizeof(KeySignatures::SequenceState),
+        [this] (const PulseNoteCache::NoteKey& noteKey, float* audio, int numSamples, KeySignatures::SequenceState& endState)
+        {
+            pulseSynthVoice::renderCachedNote(pulseCacheKey, noteKey, audio, numSamples, endState);
+        });
+
+    if (*noteCacheParameter > 0.5f) // otherwise the slots are allocated when the cache is first enabled ( timerCallback() )
+        pulseCache.allocateSlots();
+    else
+        pulseCache.releaseSlots();
+
     // set reverb parameters 
-    reverbParams.dryLevel = 0.8f;
-    reverbParams.wetLevel = 0.3f;
-    reverbParams.roomSize = *reverbParameter;   // this is varied dynamically
-    reverb.setParameters(reverbParams);
-    reverb.reset();
+    reverb.setDryWet(0.8f, 0.3f);
+    reverb.setRoomSize(*reverbParameter);   // this is varied dynamically
+    reverb.prepare(sampleRate);
 
+    audioRunning = true;
 }
 
 void MakeSoundAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    if (seedChanged.load())
+        applyRandomSeed();
+
+    presets.beginBlock(); // a pending preset is applied here once the output has faded out
+
     // modeOn has to be set in processBlock to check whether the values have changed
     modeOn = {(int) *Ionian, (int) *Dorian, (int) *Phrygian, (int) *Lydian, (int) *Mixolydian, (int) *Aeolian, (int) *Locrian };
     std::vector<int> selectedModes;     // vector of modes selected
@@ -148,6 +261,17 @@ void MakeSoundAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
 
     totalVoiceUsed = totalVoiceUsed % voiceCount;   // modulus
 
+    // offline renders use the higher quality tier
+    int oversampling = oversamplingFactors[(int) (isNonRealtime() ? *renderOversampling : *liveOversampling)];
+
+    for (int i = 0; i < voiceCount; i++)
+    {
+        FMsynthVoice* d = dynamic_cast<FMsynthVoice*>(synth2.getVoice(i));
+        d->setOversampling(oversampling);
+    }
+
+    updateFmRenderRate();
+
     for (int i = 0; i < voiceCount; i++)
     {
         FMsynthVoice* setModePointer = dynamic_cast<FMsynthVoice*>(synth2.getVoice(i)); 
@@ -172,28 +296,233 @@ void MakeSoundAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
         }
     }
 
+    if (*voiceSpreadParameter != voiceSpread) // spread the voices of each layer across the stereo field
+    {
+        voiceSpread = *voiceSpreadParameter;
+
+        for (int i = 0; i < voiceCount; i++)
+        {
+            float pan = voiceSpread * (2.0f * i / (voiceCount - 1) - 1.0f);
+            dynamic_cast<MelodyVoice*>(synth.getVoice(i))->setStereoPosition(pan);
+            dynamic_cast<FMsynthVoice*>(synth2.getVoice(i))->setStereoPosition(-pan);
+            dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i))->setStereoPosition(pan);
+        }
+    }
+
     juce::ScopedNoDenormals noDenormals;
 
-    // add sample values
-    synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
-    synthPulse.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
-    synth2.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    int numSamples = buffer.getNumSamples();
+
+    // tempo of the host for the step sequencer of the bottom synth
+    double bpm = 120.0;
+    double ppqPosition = 0.0;
+    bool hostPlaying = false;
+
+    if (auto* playHead = getPlayHead())
+    {
+        juce::AudioPlayHead::CurrentPositionInfo info;
+
+        if (playHead->getCurrentPosition(info))
+        {
+            bpm = info.bpm;
+            ppqPosition = info.ppqPosition;
+            hostPlaying = info.isPlaying;
+        }
+    }
+
+    for (int i = 0; i < voiceCount; i++)
+    {
+        pulseSynthVoice* pulseVoice = dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i));
+        pulseVoice->setHostTempo(*pulseSync > 0.5f, bpm, ppqPosition, hostPlaying);
+        pulseVoice->setNoteCache(&pulseCache, *noteCacheParameter > 0.5f && *pulseSync < 0.5f && pulseCache.isReady()); // cached notes are free running
+    }
+
+    // modulation of the voices, evaluated once for the whole block ( the mod wheel is read before the notes start )
+    for (int slot = 0; slot < numModSlots; slot++)
+    {
+        modMatrix.setSlot(slot, (int) *modSource[slot] - 1, (int) *modDestination[slot], *modAmount[slot]);
+    }
+
+    for (int lfo = 0; lfo < ModulationMatrix::numLfos; lfo++)
+    {
+        modMatrix.setLfoRate(lfo, *modLfoRate[lfo]);
+    }
+
+    modMatrix.handleMidi(midiMessages);
+    modMatrix.process(numSamples);
+
+    // one pass over the midi, each layer only receives its own notes ( and all the other events )
+    router.route(midiMessages);
+    auto& melodyEvents = router.getLayerEvents(melodyLayer);
+    auto& fmEvents = router.getLayerEvents(fmLayer);
+    auto& pulseEvents = router.getLayerEvents(pulseLayer);
+
+    // each synthesiser renders into its own bus and its delay adds the echoes of the voices to it,
+    // layers without voices, midi or echoes are skipped
+    mixer.beginBlock();
+    updateSendDelays();
+
+    if (! melodyEvents.isEmpty() || isLayerActive(synth) || sendDelays[melodyLayer].isActive())
+    {
+        auto& melodyBus = mixer.getLayerBus(melodyLayer, numSamples);
+        sendDelays[melodyLayer].beginBlock(numSamples);
+        synth.renderNextBlock(melodyBus, melodyEvents, 0, numSamples);
+        sendDelays[melodyLayer].process(melodyBus, numSamples);
+    }
+
+    if (! pulseEvents.isEmpty() || isLayerActive(synthPulse) || sendDelays[pulseLayer].isActive())
+    {
+        auto& pulseBus = mixer.getLayerBus(pulseLayer, numSamples);
+        sendDelays[pulseLayer].beginBlock(numSamples);
+        synthPulse.renderNextBlock(pulseBus, pulseEvents, 0, numSamples);
+        sendDelays[pulseLayer].process(pulseBus, numSamples);
+    }
+
+    if (fmRate.getFactor() == 1)
+    {
+        if (! fmEvents.isEmpty() || isLayerActive(synth2) || sendDelays[fmLayer].isActive())
+        {
+            auto& fmBus = mixer.getLayerBus(fmLayer, numSamples);
+            sendDelays[fmLayer].beginBlock(numSamples);
+            synth2.renderNextBlock(fmBus, fmEvents, 0, numSamples);
+            sendDelays[fmLayer].process(fmBus, numSamples);
+        }
+    }
+    else if (! fmEvents.isEmpty() || isLayerActive(synth2) || sendDelays[fmLayer].isActive() || fmRate.isActive())
+    {
+        // the middle synth and its delay render at the internal rate, then are interpolated into its bus
+        int numLowRateSamples = fmRate.beginBlock(fmEvents, numSamples);
+        bool rendered = numLowRateSamples > 0
+                     && (! fmRate.getLowRateEvents().isEmpty() || isLayerActive(synth2) || sendDelays[fmLayer].isActive());
+
+        if (rendered)
+        {
+            modMatrix.setBlockLength(fmLayer * voiceCount, voiceCount, numLowRateSamples);    // the ramps of the layer span the internal block
+            sendDelays[fmLayer].beginBlock(numLowRateSamples);
+            synth2.renderNextBlock(fmRate.getLowRateBus(), fmRate.getLowRateEvents(), 0, numLowRateSamples);
+            sendDelays[fmLayer].process(fmRate.getLowRateBus(), numLowRateSamples);
+        }
+
+        fmRate.endBlock(mixer.getLayerBus(fmLayer, numSamples), numSamples, rendered);
+    }
+
+    // gain and pan of each layer (evaluated once per block)
+    mixer.setLayerGain(melodyLayer, *volumeParameterTop);
+    mixer.setLayerGain(fmLayer, *volumeParameterMiddle);
+    mixer.setLayerGain(pulseLayer, *volumeParameterBottom);
+    mixer.setLayerPan(melodyLayer, *panParameterTop);
+    mixer.setLayerPan(fmLayer, *panParameterMiddle);
+    mixer.setLayerPan(pulseLayer, *panParameterBottom);
+
+    for (int layer = 0; layer < numLayers; layer++)
+    {
+        mixer.setAutoPan(layer, autoPanRates[layer], *autoPanParameter);
+    }
+
+    mixer.mixTo(buffer, numSamples); // sum the buses into the output
 
     float* left = buffer.getWritePointer(0); // access the left channel
     float* right = buffer.getWritePointer(1); // access the right channel
 
-    for (int sample = 0; sample < buffer.getNumSamples(); sample++) // loop for panning
+    // the room size is smoothed per sample inside the reverb, the reverb is bypassed once its tail is silent
+    reverb.setRoomSize(*reverbParameter);
+    reverb.processStereo(left, right, numSamples); // add reverb effect
+
+    presets.applyFade(buffer, numSamples); // fade around preset changes
+}
+
+void MakeSoundAudioProcessor::setRandomSeed(juce::uint64 seed)
+{
+    randomSeed = seed;
+    seedChanged = true;
+}
+
+juce::uint64 MakeSoundAudioProcessor::getRandomSeed() const
+{
+    return randomSeed;
+}
+
+size_t MakeSoundAudioProcessor::getDspMemoryBytes() const
+{
+    size_t sendBytes = 0;
+
+    for (auto& sendDelay : sendDelays)
     {
-        left[sample] = left[sample] * leftPan.process();
-        right[sample] = right[sample] * rightPan.process();
+        sendBytes += sendDelay.getSizeInBytes();
     }
 
-    // smooth value for reverb change
-    smoothReverb.setTargetValue(*reverbParameter);
-    float reverbChange = smoothReverb.getNextValue();
-    reverbParams.roomSize = reverbChange;
-    reverb.setParameters(reverbParams);                         // set reverb parameters
-    reverb.processStereo(left, right, buffer.getNumSamples()); // add reverb effect
+    return arena.getSizeInBytes() + pulseCache.getSizeInBytes() + reverb.getSizeInBytes() + mixer.getSizeInBytes()
+         + fmRate.getSizeInBytes() + sendBytes;
+}
+
+void MakeSoundAudioProcessor::applyRandomSeed()
+{
+    seedChanged = false;
+    juce::uint64 seed = randomSeed;
+
+    for (int i = 0; i < voiceCount; i++) // one stream index per voice and layer
+    {
+        dynamic_cast<MelodyVoice*>(synth.getVoice(i))->setRandomSeed(seed, melodyLayer * voiceCount + i);
+        dynamic_cast<FMsynthVoice*>(synth2.getVoice(i))->setRandomSeed(seed, fmLayer * voiceCount + i);
+        dynamic_cast<pulseSynthVoice*>(synthPulse.getVoice(i))->setRandomSeed(seed, pulseLayer * voiceCount + i);
+    }
+
+    modMatrix.setRandomSeed(seed);
+}
+
+void MakeSoundAudioProcessor::timerCallback()
+{
+    presets.syncParameters();
+
+    // the memory and the thread of the note cache are only taken once the cache is enabled
+    if (audioRunning && *noteCacheParameter > 0.5f && ! pulseCache.isReady())
+        pulseCache.allocateSlots();
+}
+
+bool MakeSoundAudioProcessor::isLayerActive(juce::Synthesiser& layerSynth)
+{
+    for (int i = 0; i < layerSynth.getNumVoices(); i++)
+    {
+        if (layerSynth.getVoice(i)->isVoiceActive())
+            return true;
+    }
+
+    return false;
+}
+
+void MakeSoundAudioProcessor::updateSendDelays()
+{
+    for (auto& sendDelay : sendDelays)
+    {
+        sendDelay.setDelayTime(*delayTime);
+        sendDelay.setFeedback(*delayFeedback);
+        sendDelay.setMode((int) *delayMode);
+    }
+}
+
+void MakeSoundAudioProcessor::updateFmRenderRate()
+{
+    double sampleRate = getSampleRate();
+    int rateChoice = (int) *fmInternalRate;
+    int factor = internalRateFactors[rateChoice];
+
+    if (rateChoice == 1) // auto, only the low-pass and band-pass filters limit the bandwidth of the layer
+    {
+        int filterMode = (int) *cuttOffMode;
+        factor = (filterMode == 0 || filterMode == 2) ? MultiRateLayer::getFactorForBandwidth(sampleRate, *maxVal) : 1;
+    }
+
+    if (factor == fmRate.getFactor() || isLayerActive(synth2) || sendDelays[fmLayer].isActive() || fmRate.isActive()) // the rate only changes while the layer is silent and has no deferred notes or tail
+        return;
+
+    fmRate.setFactor(factor);
+    synth2.setCurrentPlaybackSampleRate(sampleRate / factor);
+    sendDelays[fmLayer].setSampleRate(sampleRate / factor);
+
+    for (int i = 0; i < voiceCount; i++)
+    {
+        dynamic_cast<FMsynthVoice*>(synth2.getVoice(i))->setRenderRate((float) (sampleRate / factor));
+    }
 }
 
 //==============================================================================
@@ -231,27 +560,29 @@ bool MakeSoundAudioProcessor::isMidiEffect() const
 
 double MakeSoundAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // longest voice tail ( release ) followed by the echoes of the delay at its current settings and the reverb tail
+    float voiceTail = juce::jmax(MelodyVoice::maxTailSeconds, FMsynthVoice::maxTailSeconds, pulseSynthVoice::maxTailSeconds);
+    return voiceTail + SendDelay::getTailSeconds(*delayTime, *delayFeedback) + reverb.getTailLengthSeconds();
 }
 
 int MakeSoundAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presets.getNumPresets();
 }
 
 int MakeSoundAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return presets.getCurrentPreset();
 }
 
 void MakeSoundAudioProcessor::setCurrentProgram (int index)
 {
+    presets.selectPreset(index, audioRunning); // crossfaded on the audio thread while playing
 }
 
 const juce::String MakeSoundAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presets.getPresetName(index);
 }
 
 void MakeSoundAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -264,6 +595,8 @@ void MakeSoundAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    audioRunning = false;
+    pulseCache.releaseSlots();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -306,18 +639,62 @@ juce::AudioProcessorEditor* MakeSoundAudioProcessor::createEditor()
 //==============================================================================
 void MakeSoundAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto state = avpts.copyState();
-    std::unique_ptr < juce::XmlElement > xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    // binary state: header, seed, preset, then the id and value of every parameter
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    stream.writeInt64((juce::int64) getRandomSeed());
+    stream.writeInt(presets.getCurrentPreset());
 
+    auto& parameters = getParameters();
+    stream.writeInt(parameters.size());
+
+    for (auto* p : parameters)
+    {
+        auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(p);
+        stream.writeString(parameter->paramID);
+        stream.writeFloat(parameter->convertFrom0to1(parameter->getValue())); // not normalised, survives range changes
+    }
 }
 
 void MakeSoundAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    juce::MemoryInputStream stream(data, (size_t) sizeInBytes, false);
+
+    if (sizeInBytes >= 8 && stream.readInt() == stateMagic)
+    {
+        if (stream.readInt() > stateVersion) // saved by a newer version
+            return;
+
+        setRandomSeed((juce::uint64) stream.readInt64());
+        int preset = stream.readInt();
+        int numValues = stream.readInt();
+
+        for (int i = 0; i < numValues && ! stream.isExhausted(); i++)
+        {
+            auto id = stream.readString();
+            float value = stream.readFloat();
+
+            if (auto* parameter = avpts.getParameter(id)) // unknown ids ( removed parameters ) are skipped
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+
+        presets.setCurrentPreset(preset);
+        return;
+    }
+
+    // sessions saved before the binary format
     std::unique_ptr < juce::XmlElement > xmlState(getXmlFromBinary(data, sizeInBytes));
     if (xmlState.get() != nullptr)
         if (xmlState -> hasTagName(avpts.state.getType()))
-            avpts.replaceState(juce::ValueTree::fromXml(*xmlState));
+        {
+            auto state = juce::ValueTree::fromXml(*xmlState);
+
+            if (state.hasProperty("randomSeed")) // sessions saved before the seed was stored keep the current seed
+                setRandomSeed((juce::uint64) state.getProperty("randomSeed").toString().getLargeIntValue());
+
+            avpts.replaceState(state);
+        }
 
 }
 
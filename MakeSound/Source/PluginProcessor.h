@@ -12,12 +12,20 @@
 #include "MelodySynth.h"    // synthesiser
 #include "PulseSynth.h"     // synthesiser
 #include "FMSynth.h"        // synthesiser
-#include "Oscillator.h"     // generate lfo for panning
+#include "FDNReverb.h"      // reverb
+#include "MixerBus.h"       // layer gain, panning and summing
+#include "PresetBank.h"     // presets and preset crossfade
+#include "MidiRouter.h"     // keyboard split
+#include "DspArena.h"       // memory of the delay lines
+#include "SendDelay.h"      // delay of each layer
+#include "MultiRateLayer.h" // lower internal rate for the middle synth
+#include "ModulationMatrix.h" // modulation of the voices
 
 //==============================================================================
 /**
 */
-class MakeSoundAudioProcessor  : public juce::AudioProcessor
+class MakeSoundAudioProcessor  : public juce::AudioProcessor,
+                                 private juce::Timer
 {
 public:
     //==============================================================================
@@ -57,28 +65,126 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /**
+    * set the seed of all the random streams, the same seed renders the same output
+    * the voices are reseeded at the start of the next block ( or in prepareToPlay() )
+    *
+    * @param seed (juce::uint64) seed shared by all the voices
+    */
+    void setRandomSeed(juce::uint64 seed);
+
+    /**
+    * returns the seed of the random streams ( saved with the plugin state )
+    */
+    juce::uint64 getRandomSeed() const;
+
+    /**
+    * returns the memory used by the dsp of this instance in bytes ( delay lines and send buses, note cache, reverb and mixer buses )
+    * the memory is allocated in prepareToPlay()
+    */
+    size_t getDspMemoryBytes() const;
+
 private:
-    // audio effects
-    juce::Reverb reverb;
-    juce::Reverb::Parameters reverbParams;
+    /**
+    * give every voice of every layer its own random stream derived from randomSeed
+    */
+    void applyRandomSeed();
+
+    /**
+    * sends the values of presets applied on the audio thread to the host, and allocates the note cache once it is enabled
+    */
+    void timerCallback() override;
+
+    /**
+    * returns true if any voice of the synthesiser is playing
+    */
+    bool isLayerActive(juce::Synthesiser& layerSynth);
+
+    /**
+    * set the time, feedback and mode of the delay of every layer
+    */
+    void updateSendDelays();
+
+    /**
+    * pick the internal rate of the middle synth and apply it while the layer is silent
+    */
+    void updateFmRenderRate();
+
+    // memory of the delay lines of all the layers, allocated in prepareToPlay()
+    DspArena arena;
 
-    // synthesiser class
+    // audio effects
+    FDNReverb reverb;
+
+    // mixer, one bus for each synthesiser layer
+    MixerBus mixer;
+    enum Layers { melodyLayer = 0, fmLayer, pulseLayer, numLayers };
+    const float autoPanRates[numLayers] = { 0.05f, 0.1f, 0.075f }; // auto-pan lfo frequency of each layer
+    MidiRouter router;  // splits the midi between the layers
+    MultiRateLayer fmRate;  // the middle synth can render at a lower internal rate
+    ModulationMatrix modMatrix; // sources routed to the voices of every layer, evaluated once per block
+    SendDelay sendDelays[numLayers];    // the voices of each layer send to one delay
+
+    // synthesiser class, the top and middle synths render all their voices together from a voice bank
     juce::Synthesiser synthPulse;
-    juce::Synthesiser synth;
-    juce::Synthesiser synth2;
-    int voiceCount = 8; // voice count for each synthesiser
+    VoiceBankSynthesiser<MelodyVoiceBank> synth;
+    VoiceBankSynthesiser<FMVoiceBank> synth2;
+    int voiceCount = VoiceBank::maxVoices; // voice count for each synthesiser
+
+    // seed of the random streams, a new instance starts with a random seed
+    std::atomic<juce::uint64> randomSeed { (juce::uint64) juce::Random::getSystemRandom().nextInt64() };
+    std::atomic<bool> seedChanged { false };   // true until the audio thread has reseeded the voices
     
     juce::AudioProcessorValueTreeState avpts;
 
+    // presets ( programs ), switched on the audio thread with a short fade
+    PresetBank presets;
+    std::atomic<bool> audioRunning { false };  // true between prepareToPlay() and releaseResources()
+
+    // cache of pre-rendered notes for the bottom synth, filled on a background thread ( allocated only while enabled )
+    KeySignatures pulseCacheKey;                    // only used by the cache thread
+    PulseNoteCache pulseCache;
+    static constexpr double noteCacheSeconds = 8.0;         // cached audio of a note
+    static constexpr size_t noteCacheBytes = 64 << 20;      // memory of the whole cache
+
+    // binary state format
+    static constexpr int stateMagic = 0x4d4b5344;   // "MKSD", older sessions are stored as xml
+    static constexpr int stateVersion = 1;
+
     // parameters 
     std::atomic<float>* volumeParameterTop;
     std::atomic<float>* volumeParameterMiddle;
     std::atomic<float>* volumeParameterBottom;
+    std::atomic<float>* panParameterTop;
+    std::atomic<float>* panParameterMiddle;
+    std::atomic<float>* panParameterBottom;
+    std::atomic<float>* autoPanParameter;
+    std::atomic<float>* voiceSpreadParameter;
+    float voiceSpread = -1.0f;  // spread applied to the voices, -1 forces the first update
     std::atomic<float>* reverbParameter;
-    juce::SmoothedValue<float> smoothReverb; // smooth value for reverb
     std::atomic<float>* cuttOffMode;
     std::atomic<float>* minVal;
     std::atomic<float>* maxVal;
+    std::atomic<float>* fmAlgorithm;
+    std::atomic<float>* fmBrightness;
+    std::atomic<float>* noteCacheParameter;  // replay the notes of the bottom synth from the note cache
+    std::atomic<float>* pulseSync;           // step sequencer of the bottom synth follows the host tempo
+    std::atomic<float>* liveOversampling;    // oversampling of the middle synth during playback
+    std::atomic<float>* renderOversampling;  // oversampling of the middle synth for offline renders
+    const int oversamplingFactors[3] = { 1, 2, 4 };
+    std::atomic<float>* fmInternalRate;      // full, auto ( from the filter ), 1/2 or 1/4 of the host rate
+    const int internalRateFactors[4] = { 1, 1, 2, 4 };
+    std::atomic<float>* delayTime;           // delay of every layer
+    std::atomic<float>* delayFeedback;
+    std::atomic<float>* delayMode;           // stereo or ping-pong
+
+    // modulation matrix slots ( source 0 is off )
+    static constexpr int numModSlots = 4;
+    std::atomic<float>* modSource[numModSlots];
+    std::atomic<float>* modDestination[numModSlots];
+    std::atomic<float>* modAmount[numModSlots];
+    std::atomic<float>* modLfoRate[ModulationMatrix::numLfos];
 
     // modes to be selected ( enabled / disabled)
     std::atomic<float>* Ionian;
@@ -91,10 +197,6 @@ private:
     std::vector<int> modeOn;
     int modeCount = 7;
     
-    // lfo to panning channels
-    SineOsc leftPan;
-    SineOsc rightPan;
-    
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MakeSoundAudioProcessor)
 
@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    Contains class PresetBank
+
+    Factory presets compiled into parameter snapshots (one value for every
+    parameter of the processor, stored in one contiguous block) when the plugin
+    is created
+
+    Switching preset on the audio thread: the output fades out, the snapshot is
+    written into the raw parameter values (no allocation, no locking), then the
+    output fades in. The host is told about the new values later from the
+    message thread ( syncParameters() )
+
+    Requires <JuceHeader.h> for AudioProcessorValueTreeState and AudioBuffer
+    Requires <vector> for the snapshots
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+* bank of presets with an audio thread crossfade when the preset changes
+*
+* @param avpts (juce::AudioProcessorValueTreeState&) parameters of the processor
+* @param presets (std::vector<PresetBank::Preset>) presets, only the values that differ from the defaults
+* @param index (int) index of the preset
+* @param sampleRate (double) sample rate in Hz
+*/
+class PresetBank
+{
+public:
+    /**
+    * preset definition, parameters that are not listed keep their default value
+    */
+    struct Preset
+    {
+        juce::String name;
+        std::vector<std::pair<juce::String, float>> values; // parameter id, value ( not normalised )
+    };
+
+    /**
+    * compile the presets into snapshots of every parameter - called once in the constructor of the processor
+    *
+    * @param avpts (juce::AudioProcessorValueTreeState&) parameters of the processor
+    * @param presets (std::vector<PresetBank::Preset>) presets, only the values that differ from the defaults
+    */
+    void compile(juce::AudioProcessorValueTreeState& avpts, const std::vector<Preset>& presets)
+    {
+        parameters.clear();
+        rawValues.clear();
+
+        for (auto* p : avpts.processor.getParameters())
+        {
+            if (auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(p))
+            {
+                parameters.push_back(parameter);
+                rawValues.push_back(avpts.getRawParameterValue(parameter->paramID));
+            }
+        }
+
+        numParameters = (int) parameters.size();
+        snapshots.assign(presets.size() * numParameters, 0.0f);
+        names.clear();
+
+        for (int preset = 0; preset < (int) presets.size(); preset++)
+        {
+            float* snapshot = snapshots.data() + preset * numParameters;
+            names.push_back(presets[preset].name);
+
+            for (int i = 0; i < numParameters; i++) // start from the default values
+            {
+                snapshot[i] = parameters[i]->convertFrom0to1(parameters[i]->getDefaultValue());
+            }
+
+            for (auto& value : presets[preset].values)
+            {
+                for (int i = 0; i < numParameters; i++)
+                {
+                    if (parameters[i]->paramID == value.first)
+                        snapshot[i] = value.second;
+                }
+            }
+        }
+    }
+
+    /**
+    * set the length of the crossfade - called in prepareToPlay()
+    *
+    * @param sampleRate (double) sample rate in Hz
+    */
+    void prepare(double sampleRate)
+    {
+        fadeStep = 1.0f / (float) (fadeSeconds * sampleRate);
+    }
+
+    /**
+    * returns the number of presets
+    */
+    int getNumPresets() const
+    {
+        return (int) names.size();
+    }
+
+    /**
+    * returns the name of a preset
+    *
+    * @param index (int) index of the preset
+    */
+    juce::String getPresetName(int index) const
+    {
+        return juce::isPositiveAndBelow(index, getNumPresets()) ? names[index] : juce::String();
+    }
+
+    /**
+    * returns the index of the last selected preset
+    */
+    int getCurrentPreset() const
+    {
+        return currentPreset;
+    }
+
+    /**
+    * select a preset - called from the message thread
+    * while the audio is running the preset is applied by the audio thread between a fade out and a fade in
+    *
+    * @param index (int) index of the preset
+    * @param audioRunning (bool) false to apply the preset straight away ( no blocks are being processed )
+    */
+    void selectPreset(int index, bool audioRunning)
+    {
+        if (! juce::isPositiveAndBelow(index, getNumPresets()))
+            return;
+
+        currentPreset = index;
+
+        if (audioRunning)
+        {
+            pendingPreset = index;
+        }
+        else
+        {
+            pendingPreset = -1;
+            writeParameters(index);
+        }
+    }
+
+    /**
+    * set the current preset without applying it ( e.g. when the state is loaded )
+    *
+    * @param index (int) index of the preset
+    */
+    void setCurrentPreset(int index)
+    {
+        if (juce::isPositiveAndBelow(index, getNumPresets()))
+            currentPreset = index;
+    }
+
+    /**
+    * apply a pending preset once the output has faded out - called at the start of processBlock()
+    */
+    void beginBlock()
+    {
+        if (fadeGain > 0.0f)
+            return;
+
+        int index = pendingPreset.exchange(-1);
+
+        if (index >= 0)
+        {
+            const float* snapshot = snapshots.data() + index * numParameters;
+
+            for (int i = 0; i < numParameters; i++)
+            {
+                rawValues[i]->store(snapshot[i]);
+            }
+
+            syncPreset = index;     // the host is told from the message thread
+        }
+    }
+
+    /**
+    * fade the output out while a preset is pending and back in once it has been applied - called at the end of processBlock()
+    *
+    * @param buffer (juce::AudioBuffer<float>&) output buffer
+    * @param numSamples (int) number of samples in the block
+    */
+    void applyFade(juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        float target = (pendingPreset.load() >= 0) ? 0.0f : 1.0f;
+
+        if (fadeGain == target && target == 1.0f)
+            return;
+
+        float endGain = (target < fadeGain) ? juce::jmax(target, fadeGain - fadeStep * numSamples)
+                                            : juce::jmin(target, fadeGain + fadeStep * numSamples);
+
+        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        {
+            buffer.applyGainRamp(chan, 0, numSamples, fadeGain, endGain);
+        }
+
+        fadeGain = endGain;
+    }
+
+    /**
+    * tell the host about the values of a preset applied by the audio thread - called from a timer on the message thread
+    */
+    void syncParameters()
+    {
+        int index = syncPreset.exchange(-1);
+
+        if (index >= 0)
+            writeParameters(index);
+    }
+
+private:
+    /**
+    * set the parameters to the values of a snapshot and notify the host ( message thread only )
+    *
+    * @param index (int) index of the preset
+    */
+    void writeParameters(int index)
+    {
+        const float* snapshot = snapshots.data() + index * numParameters;
+
+        for (int i = 0; i < numParameters; i++)
+        {
+            parameters[i]->setValueNotifyingHost(parameters[i]->convertTo0to1(snapshot[i]));
+        }
+    }
+
+    // compiled presets, one row of numParameters values for each preset
+    std::vector<juce::RangedAudioParameter*> parameters;
+    std::vector<std::atomic<float>*> rawValues;
+    std::vector<float> snapshots;
+    std::vector<juce::String> names;
+    int numParameters = 0;
+
+    // preset selection
+    int currentPreset = 0;
+    std::atomic<int> pendingPreset { -1 };  // preset waiting for the fade out, -1 if none
+    std::atomic<int> syncPreset { -1 };     // preset applied by the audio thread, not yet sent to the host
+
+    // crossfade
+    static constexpr double fadeSeconds = 0.01;
+    float fadeStep = 1.0f / 441.0f;
+    float fadeGain = 1.0f;
+};
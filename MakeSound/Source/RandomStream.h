@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    RandomStream.h
+
+    Contains class RandomStream
+
+    Small and fast random number generator (xoshiro128+) with the same calls as
+    juce::Random ( nextInt(), nextFloat() ). Every stream is derived from a seed
+    and a stream index, so each voice can own its own reproducible stream from a
+    single processor-level seed
+
+    Requires <JuceHeader.h> for juce::uint32 and juce::uint64
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/**
+* seedable random number generator (xoshiro128+)
+*
+* @param seed (juce::uint64) seed shared by all the streams of a processor
+* @param streamIndex (int) index of the stream, each voice uses a different index
+* @param maxValue (int) upper limit (exclusive) for nextInt()
+* @return nextInt(int maxValue) (int) random integer between 0 and maxValue - 1
+* @return nextFloat() (float) random float between 0 and 1
+*/
+class RandomStream
+{
+public:
+    RandomStream()
+    {
+        setSeed(0, 0);
+    }
+
+    /**
+    * set the seed and the stream index, the same values always give the same sequence
+    *
+    * @param seed (juce::uint64) seed shared by all the streams of a processor
+    * @param streamIndex (int) index of the stream
+    */
+    void setSeed(juce::uint64 seed, int streamIndex)
+    {
+        // the index is hashed on its own first, so neighbouring streams share no state words,
+        // then splitmix64 spreads the seed over the whole state
+        juce::uint64 index = (juce::uint64) streamIndex;
+        juce::uint64 x = seed ^ splitMix(index);
+
+        for (int i = 0; i < 2; i++)
+        {
+            juce::uint64 z = splitMix(x);
+            state[2 * i] = (juce::uint32) z;
+            state[2 * i + 1] = (juce::uint32) (z >> 32);
+        }
+
+        if ((state[0] | state[1] | state[2] | state[3]) == 0) // the state must never be all zeros
+            state[0] = 1;
+    }
+
+    /**
+    * returns the next 32 random bits
+    */
+    juce::uint32 next()
+    {
+        juce::uint32 result = state[0] + state[3];
+        juce::uint32 t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = (state[3] << 11) | (state[3] >> 21);
+
+        return result;
+    }
+
+    /**
+    * returns a random integer between 0 and maxValue - 1
+    *
+    * @param maxValue (int) upper limit (exclusive), must be greater than 0
+    */
+    int nextInt(int maxValue)
+    {
+        jassert(maxValue > 0);
+        return (int) (((juce::uint64) next() * (juce::uint32) maxValue) >> 32);
+    }
+
+    /**
+    * returns a random float between 0 and 1 (1 is never returned)
+    */
+    float nextFloat()
+    {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /**
+    * fill a block with random floats between 0 and 1, for block based processing
+    *
+    * @param dest (float*) block to fill
+    * @param numSamples (int) number of values
+    */
+    void fillFloats(float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            dest[i] = nextFloat();
+        }
+    }
+
+    /**
+    * fill a block with random floats between -1 and 1 (white noise)
+    *
+    * @param dest (float*) block to fill
+    * @param numSamples (int) number of values
+    */
+    void fillBipolar(float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            dest[i] = nextFloat() * 2.0f - 1.0f;
+        }
+    }
+
+private:
+    /**
+    * one step of splitmix64, returns a well mixed 64 bit value
+    *
+    * @param x (juce::uint64&) state of the splitmix generator, advanced by one step
+    */
+    static juce::uint64 splitMix(juce::uint64& x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        juce::uint64 z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    juce::uint32 state[4];
+};
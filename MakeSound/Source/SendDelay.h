@@ -0,0 +1,271 @@
+/*
+  ==============================================================================
+
+    SendDelay.h
+
+    Contains class SendDelay
+
+    Delay effect shared by all the voices of a synthesiser layer. The voices add
+    their output times a send level to the stereo send bus of the layer, then the
+    bus goes through one stereo delay and the echoes are added to the layer bus.
+    One pair of delay lines per layer replaces a delay line in every voice
+
+    Stereo mode delays each channel on its own line, ping-pong mode feeds the
+    mono sum into the left line and each line feeds back into the other one
+
+    The delay keeps running after the voices have stopped, until its echoes are
+    silent ( isActive() )
+
+    Requires <JuceHeader.h> for AudioBuffer
+    Requires "Delay.h" for the delay lines
+    Requires "DspArena.h" for the memory of the delay lines
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+#include "Delay.h"
+#include "DspArena.h"
+
+/**
+* stereo send delay of a synthesiser layer
+*
+* @param sampleRate (double) sample rate the layer renders at
+* @param samplesPerBlock (int) expected block size
+* @param arena (DspArena&) memory for the delay lines
+* @param seconds (float) delay time in seconds
+* @param feedback (float) level of the echoes fed back into the delay (0 - maxFeedback)
+* @param mode (int) SendDelay::Mode
+* @param layerBus (juce::AudioBuffer<float>&) bus of the layer, the echoes are added to it
+* @param numSamples (int) number of samples in this block
+* @return getSendBus() (juce::AudioBuffer<float>&) bus the voices add their send to
+*/
+class SendDelay
+{
+public:
+    static constexpr float maxDelaySeconds = 1.0f;
+    static constexpr float maxFeedback = 0.9f;
+    static constexpr float silenceThreshold = 0.0001f;  // the echoes end below this level
+
+    enum Mode { stereo = 0, pingPong };
+
+    /**
+    * returns the number of floats the delay takes from a DspArena ( two delay lines of maxDelaySeconds )
+    *
+    * @param sampleRate (double) highest sample rate the layer renders at
+    */
+    static size_t getArenaSize(double sampleRate)
+    {
+        return 2 * DspArena::getSliceSize((size_t) (sampleRate * maxDelaySeconds));
+    }
+
+    /**
+    * returns how long the echoes of a send last in seconds: one delay time per echo above the silence threshold
+    *
+    * @param seconds (float) delay time in seconds
+    * @param feedback (float) level of the echoes fed back into the delay
+    */
+    static float getTailSeconds(float seconds, float feedback)
+    {
+        float numEchoes = 1.0f;
+
+        if (feedback > 0.0f)
+            numEchoes += std::log(silenceThreshold) / std::log(juce::jmin(feedback, maxFeedback));
+
+        return juce::jmin(seconds, maxDelaySeconds) * numEchoes;
+    }
+
+    /**
+    * take the memory of the delay lines and allocate the send bus - called in prepareToPlay()
+    *
+    * @param sampleRate (double) highest sample rate the layer renders at
+    * @param samplesPerBlock (int) expected block size
+    * @param arena (DspArena&) memory for the delay lines
+    */
+    void prepare(double sampleRate, int samplesPerBlock, DspArena& arena)
+    {
+        int size = (int) (sampleRate * maxDelaySeconds);
+
+        for (auto& line : lines)
+        {
+            line.setBuffer(arena.take(size), size);
+        }
+
+        sendBus.setSize(2, samplesPerBlock, false, false, true); // keeps the memory if it is already big enough
+        tailCountdown = 0;
+        setSampleRate(sampleRate);
+    }
+
+    /**
+    * set the rate the layer renders at ( not above the rate passed to prepare() ), the delay lines are cleared
+    *
+    * @param _sampleRate (double) sample rate in Hz
+    */
+    void setSampleRate(double _sampleRate)
+    {
+        sampleRate = _sampleRate;
+        tailCountdown = 0;
+
+        for (auto& line : lines)
+        {
+            line.clear();
+        }
+
+        updateDelayTime();
+    }
+
+    /**
+    * set the delay time
+    *
+    * @param seconds (float) delay time in seconds ( maxDelaySeconds at most )
+    */
+    void setDelayTime(float seconds)
+    {
+        if (seconds != delaySeconds)
+        {
+            delaySeconds = seconds;
+            updateDelayTime();
+        }
+    }
+
+    /**
+    * set the level of the echoes fed back into the delay
+    *
+    * @param _feedback (float) 0 - a single echo, up to maxFeedback
+    */
+    void setFeedback(float _feedback)
+    {
+        feedback = juce::jlimit(0.0f, maxFeedback, _feedback);
+        updateTailLength();
+    }
+
+    /**
+    * choose between a delay line per channel and ping-pong echoes
+    *
+    * @param _mode (int) SendDelay::Mode
+    */
+    void setMode(int _mode)
+    {
+        mode = _mode;
+    }
+
+    /**
+    * returns the memory of the send bus in bytes ( the delay lines are counted in the DspArena )
+    */
+    size_t getSizeInBytes() const
+    {
+        return (size_t) sendBus.getNumChannels() * sendBus.getNumSamples() * sizeof(float);
+    }
+
+    /**
+    * returns true until the echoes of the last send are silent, the layer keeps rendering while the delay is active
+    */
+    bool isActive() const
+    {
+        return tailCountdown > 0;
+    }
+
+    /**
+    * clear the send bus before the voices render into it
+    *
+    * @param numSamples (int) number of samples in this block
+    */
+    void beginBlock(int numSamples)
+    {
+        if (sendBus.getNumSamples() < numSamples) // host sent a bigger block than announced
+            sendBus.setSize(2, numSamples, false, false, true);
+
+        sendBus.clear(0, numSamples);
+    }
+
+    /**
+    * returns the stereo bus the voices add their send to ( cleared in beginBlock() )
+    */
+    juce::AudioBuffer<float>& getSendBus()
+    {
+        return sendBus;
+    }
+
+    /**
+    * delay the send bus and add the echoes to the layer bus
+    *
+    * @param layerBus (juce::AudioBuffer<float>&) bus of the layer
+    * @param numSamples (int) number of samples in this block
+    */
+    void process(juce::AudioBuffer<float>& layerBus, int numSamples)
+    {
+        if (sendBus.getMagnitude(0, numSamples) >= silenceThreshold) // the echoes of this block are heard for one tail length
+            tailCountdown = tailLength;
+        else if (tailCountdown <= 0)
+            return;
+
+        tailCountdown -= numSamples;
+
+        const float* inLeft = sendBus.getReadPointer(0);
+        const float* inRight = sendBus.getReadPointer(1);
+        float* outLeft = layerBus.getWritePointer(0);
+        float* outRight = layerBus.getWritePointer(layerBus.getNumChannels() > 1 ? 1 : 0);
+
+        if (mode == pingPong)
+        {
+            for (int i = 0; i < numSamples; i++)
+            {
+                float left = lines[0].readVal();
+                float right = lines[1].readVal();
+                lines[0].writeVal((inLeft[i] + inRight[i]) * 0.5f + right * feedback);
+                lines[1].writeVal(left * feedback);
+                outLeft[i] += left;
+                outRight[i] += right;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; i++)
+            {
+                float left = lines[0].readVal();
+                float right = lines[1].readVal();
+                lines[0].writeVal(inLeft[i] + left * feedback);
+                lines[1].writeVal(inRight[i] + right * feedback);
+                outLeft[i] += left;
+                outRight[i] += right;
+            }
+        }
+    }
+
+private:
+    /**
+    * set the delay lines to the delay time at the current rate
+    */
+    void updateDelayTime()
+    {
+        int size = lines[0].getSize();
+        delaySamples = juce::jlimit(1, juce::jmax(1, size - 1), (int) (delaySeconds * sampleRate));
+
+        for (auto& line : lines)
+        {
+            line.setDelayTime(delaySamples);
+        }
+
+        updateTailLength();
+    }
+
+    /**
+    * work out how long the echoes of a send last in samples
+    */
+    void updateTailLength()
+    {
+        tailLength = (int) (getTailSeconds((float) (delaySamples / sampleRate), feedback) * sampleRate) + 1;
+    }
+
+    Delay lines[2];                     // left and right
+    juce::AudioBuffer<float> sendBus;   // stereo send of the voices
+    double sampleRate = 44100.0;
+    float delaySeconds = 0.5f;
+    float feedback = 0.0f;
+    int mode = stereo;
+    int delaySamples = 1;
+    int tailLength = 0;                 // samples the echoes of a send last
+    int tailCountdown = 0;              // samples until the echoes are silent
+};
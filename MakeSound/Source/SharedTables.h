@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    SharedTables.h
+
+    Contains class SharedTables, structs NoteFrequencyTable, ScaleTable
+
+    Read-only tables shared by every voice of every plugin instance in the
+    process. A table is built the first time it is asked for and is freed when
+    the last user lets go of it (reference counted). Tables are keyed by their
+    type and the sample rate they were built for ( 0 for tables that do not
+    depend on the sample rate )
+
+    Tables are fetched off the audio thread ( constructors, prepareToPlay() ),
+    the audio thread only reads them
+
+    Requires <JuceHeader.h> for CriticalSection and MidiMessage
+    Requires <map>, <memory>, <typeindex> for the registry
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <typeindex>
+
+/**
+* process-wide registry of read-only tables
+*
+* @param Table type of the table, constructed from the sample rate ( Table(double sampleRate) )
+* @param sampleRate (double) sample rate the table is built for, 0 if the table does not depend on it
+* @return get<Table>(double sampleRate) (std::shared_ptr<const Table>) the shared table
+*/
+class SharedTables
+{
+public:
+    /**
+    * returns the shared table of a type, the table is built if no one holds it yet ( not on the audio thread )
+    *
+    * @param sampleRate (double) sample rate the table is built for, 0 if the table does not depend on it
+    */
+    template <typename Table>
+    static std::shared_ptr<const Table> get(double sampleRate = 0.0)
+    {
+        Registry& registry = getRegistry();
+        const juce::ScopedLock lock(registry.lock);
+
+        std::weak_ptr<const void>& entry = registry.tables[std::make_pair(std::type_index(typeid(Table)), sampleRate)];
+        std::shared_ptr<const void> table = entry.lock();
+
+        if (table == nullptr) // first user, or every previous user has let go of it
+        {
+            table = std::make_shared<const Table>(sampleRate);
+            entry = table;
+        }
+
+        return std::static_pointer_cast<const Table>(table);
+    }
+
+private:
+    struct Registry
+    {
+        juce::CriticalSection lock;
+        std::map<std::pair<std::type_index, double>, std::weak_ptr<const void>> tables;
+    };
+
+    /**
+    * returns the registry, one for the whole process
+    */
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+
+/**
+* frequency in Hz of every midi note number ( A4 = 440 Hz ), does not depend on the sample rate
+*
+* @param noteNumber (int) midi note number, notes above 127 are used for the upper octaves of the scales
+* @return getFrequency(int noteNumber) (float) frequency in Hz
+*/
+struct NoteFrequencyTable
+{
+    static constexpr int numNotes = 256;
+
+    explicit NoteFrequencyTable(double /*sampleRate*/)
+    {
+        for (int note = 0; note < numNotes; note++)
+        {
+            frequencies[note] = (float) juce::MidiMessage::getMidiNoteInHertz(note);
+        }
+    }
+
+    /**
+    * returns the frequency of a midi note number in Hz
+    *
+    * @param noteNumber (int) midi note number ( 0 - 255 )
+    */
+    float getFrequency(int noteNumber) const
+    {
+        return frequencies[juce::jlimit(0, numNotes - 1, noteNumber)];
+    }
+
+    float frequencies[numNotes];
+};
+
+/**
+* semitone offsets of the notes of every mode over several octaves, does not depend on the sample rate
+* modes: ionian / major, dorian, phrygian, lydian, mixolydian, aeolian / minor, locrian
+*
+* @param mode (int) mode number, e.g. 0 = ionian
+* @param degree (int) degree of the note, 7 degrees per octave
+* @return getOffset(int mode, int degree) (int) semitones above the base note
+*/
+struct ScaleTable
+{
+    static constexpr int numModes = 7;
+    static constexpr int notesPerOctave = 7;
+    static constexpr int numOctaves = 5;
+    static constexpr int numNotes = notesPerOctave * numOctaves;
+
+    explicit ScaleTable(double /*sampleRate*/)
+    {
+        const int modes[numModes][notesPerOctave] = { { 0, 2, 4, 5, 7, 9, 11 },     // ionian / major
+                                                      { 0, 1, 3, 5, 6, 8, 10 },     // dorian
+                                                      { 0, 1, 3, 5, 7, 8, 10 },     // phrygian
+                                                      { 0, 2, 4, 6, 7, 9, 11 },     // lydian
+                                                      { 0, 2, 4, 5, 7, 9, 10 },     // mixolydian
+                                                      { 0, 2, 3, 5, 7, 8, 10 },     // aeolian / minor
+                                                      { 0, 1, 3, 5, 6, 8, 10 } };   // locrian
+
+        for (int mode = 0; mode < numModes; mode++)
+        {
+            for (int degree = 0; degree < numNotes; degree++)
+            {
+                offsets[mode][degree] = modes[mode][degree % notesPerOctave] + 12 * (degree / notesPerOctave);
+            }
+        }
+    }
+
+    /**
+    * returns the number of semitones between the base note and a degree of a mode
+    *
+    * @param mode (int) mode number, e.g. 0 = ionian
+    * @param degree (int) degree of the note ( 0 - numNotes - 1 )
+    */
+    int getOffset(int mode, int degree) const
+    {
+        return offsets[mode][degree];
+    }
+
+    int offsets[numModes][numNotes];
+};
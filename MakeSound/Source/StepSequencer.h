@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    StepSequencer.h
+
+    Contains class StepSequencer
+
+    Keeps time for a step sequencer. The position inside the current step is kept
+    in samples, so the next step boundary is known ahead of time as a sample
+    offset and the audio between two boundaries can be rendered in one span
+
+    The steps either run at a free rate (steps per second) or follow the host
+    tempo, in which case a step lasts a power of two number of beats and the
+    position is aligned to the host beat position
+
+    Requires <cmath> for ceil(), floor(), log2() and pow()
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <cmath>
+
+/**
+* timing of a step sequencer, step boundaries are computed as sample offsets
+*
+* @param sampleRate (double) sample rate in Hz
+* @param stepsPerSecond (double) rate of the steps
+* @param bpm (double) tempo of the host in beats per minute
+* @param ppqPosition (double) position of the host in beats
+* @param numSamples (int) number of samples to move forward
+* @return getSamplesToNextStep() (int) samples until the next step starts
+* @return getStepPhase() (double) position inside the current step (0 - 1)
+*/
+class StepSequencer
+{
+public:
+
+    /**
+    * set the sample rate - needs to be called first
+    *
+    * @param _sampleRate (double) sample rate in Hz
+    */
+    void setSampleRate(double _sampleRate)
+    {
+        sampleRate = _sampleRate;
+        setStepLength(sampleRate / stepsPerSecond);
+    }
+
+    /**
+    * free running steps, the position inside the current step is kept when the rate changes
+    *
+    * @param _stepsPerSecond (double) rate of the steps
+    */
+    void setRate(double _stepsPerSecond)
+    {
+        stepsPerSecond = _stepsPerSecond;
+
+        if (stepsPerSecond < minRate)
+            stepsPerSecond = minRate;
+
+        setStepLength(sampleRate / stepsPerSecond);
+    }
+
+    /**
+    * steps follow the host tempo, a step lasts the power of two number of beats closest to the free rate
+    *
+    * @param bpm (double) tempo of the host in beats per minute
+    * @param _stepsPerSecond (double) free rate of the steps, used to pick the length of a step in beats
+    */
+    void setTempo(double bpm, double _stepsPerSecond)
+    {
+        stepsPerSecond = _stepsPerSecond;
+
+        if (stepsPerSecond < minRate)
+            stepsPerSecond = minRate;
+
+        double beatsPerSecond = bpm / 60.0;
+        beatsPerStep = std::pow(2.0, std::floor(std::log2(beatsPerSecond / stepsPerSecond) + 0.5));
+        setStepLength(sampleRate * beatsPerStep / beatsPerSecond);
+    }
+
+    /**
+    * align the position with the host ( after setTempo() )
+    *
+    * @param ppqPosition (double) position of the host in beats
+    */
+    void setBeatPosition(double ppqPosition)
+    {
+        double stepPosition = ppqPosition / beatsPerStep;
+        position = (stepPosition - std::floor(stepPosition)) * stepLength;
+    }
+
+    /**
+    * start a new step from the beginning
+    */
+    void reset()
+    {
+        position = 0.0;
+    }
+
+    /**
+    * returns the number of samples until the next step starts ( at least 1 )
+    */
+    int getSamplesToNextStep() const
+    {
+        int samples = (int) std::ceil(stepLength - position);
+        return (samples > 1) ? samples : 1;
+    }
+
+    /**
+    * returns the position inside the current step (0 - 1)
+    */
+    double getStepPhase() const
+    {
+        return position / stepLength;
+    }
+
+    /**
+    * returns the change of the step phase for every sample
+    */
+    double getPhaseIncrement() const
+    {
+        return 1.0 / stepLength;
+    }
+
+    /**
+    * move forward, never further than getSamplesToNextStep()
+    *
+    * @param numSamples (int) number of samples to move forward
+    * @return true if a new step starts
+    */
+    bool advance(int numSamples)
+    {
+        position += numSamples;
+
+        if (position >= stepLength)
+        {
+            position -= stepLength; // the fraction of a sample is kept, the steps do not drift
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    /**
+    * change the length of a step and keep the position inside the step
+    *
+    * @param length (double) length of a step in samples
+    */
+    void setStepLength(double length)
+    {
+        if (length < 1.0)
+            length = 1.0;
+
+        if (length == stepLength) // same rate, the position is left exactly as it is
+            return;
+
+        double phase = position / stepLength;
+        stepLength = length;
+        position = phase * stepLength;
+    }
+
+    static constexpr double minRate = 0.01;   // slowest rate, a step every 100 seconds
+
+    double sampleRate = 44100.0;
+    double stepsPerSecond = 0.5;
+    double beatsPerStep = 1.0;
+    double stepLength = 88200.0;    // length of a step in samples
+    double position = 0.0;          // position inside the current step in samples
+};
@@ -0,0 +1,370 @@
+/*
+  ==============================================================================
+
+    VoiceBank.h
+
+    Contains class BankedVoice
+    Contains class VoiceBank
+    Contains class VoiceBankSynthesiser
+
+    Storage of the hot dsp state of all the voices of a synthesiser layer, as
+    arrays with one entry per voice. The juce::SynthesiserVoice objects keep the
+    cold state ( random streams, key signatures, parameters ) and only start and
+    stop the notes of their entry
+
+    The playing voices are rendered together, stage by stage: the oscillators of
+    every voice, then the envelopes of every voice, then the output and the send
+    to the delay of the layer. Each stage is one tight loop over contiguous memory, instead of one
+    loop per voice object that goes through all the stages for every sample
+
+    VoiceBank holds the stages every layer has ( envelope, tail detection,
+    modulation, output and delay send ), a layer derives from it and adds its oscillators and
+    filters ( MelodyVoiceBank, FMVoiceBank )
+
+    Requires <JuceHeader.h> for Synthesiser
+    Requires "BlockEnvelope.h" for the envelopes of the voices
+    Requires "SendDelay.h" for the delay of the layer
+    Requires "VoiceOutput.h" for the output blocks of the voices
+    Requires "ModulationMatrix.h" for the modulation of the voices
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "BlockEnvelope.h"
+#include "SendDelay.h"
+#include "VoiceOutput.h"
+#include "ModulationMatrix.h"
+
+/**
+* a voice whose dsp state lives in a VoiceBank
+*/
+class BankedVoice
+{
+public:
+    virtual ~BankedVoice() {}
+
+    /**
+    * called by the bank once the tail of the note has faded out ( once per note )
+    */
+    virtual void noteFinished() = 0;
+};
+
+/**
+* hot dsp state of the voices of a layer and the stages shared by the layers
+*
+* @param voice (int) index of the voice in the bank
+* @param sampleRate (float) sample rate of the voice
+* @param startSample (int) position of the first sample in the output buffer
+* @param numSamples (int) number of samples, maxBlockSize at most
+*/
+class VoiceBank
+{
+public:
+    static constexpr int maxVoices = 8;     // voices of a layer
+    static constexpr int maxBlockSize = VoiceOutput::maxBlockSize;
+
+    /**
+    * connect a voice to its entry of the bank
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param owner (BankedVoice*) the voice, told when its note has finished
+    */
+    void setOwner(int voice, BankedVoice* owner)
+    {
+        jassert(voice < maxVoices);
+        owners[voice] = owner;
+    }
+
+    /**
+    * set the sample rate of the envelope of a voice
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param sampleRate (float) sample rate of the voice
+    */
+    void prepareVoice(int voice, float sampleRate)
+    {
+        envelopes.setSampleRate(voice, sampleRate);
+        playing[voice] = false;
+    }
+
+    /**
+    * set the delay the voices of the bank send to
+    *
+    * @param _sendDelay (SendDelay*) delay of the layer, nullptr for no send
+    */
+    void setSendDelay(SendDelay* _sendDelay)
+    {
+        sendDelay = _sendDelay;
+    }
+
+    /**
+    * set the envelope parameters of a voice, set by the voice when a note starts
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param parameters (const BlockEnvelope::Parameters&) times in seconds, sustain level and curves
+    */
+    void setEnvelopeParameters(int voice, const BlockEnvelope::Parameters& parameters)
+    {
+        envelopes.setParameters(voice, parameters);
+    }
+
+    /**
+    * set the level a voice sends to the delay of the layer, without modulation
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param level (float) send level (0 - 1)
+    */
+    void setSendLevel(int voice, float level)
+    {
+        sendLevels[voice] = level;
+    }
+
+    /**
+    * set the stereo position of a voice
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(int voice, float pan)
+    {
+        stereoPositions[voice] = pan;
+        outputs[voice].setStereoPosition(pan);
+    }
+
+    /**
+    * connect a voice to the modulation matrix
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param matrix (ModulationMatrix*) matrix of the processor
+    * @param matrixIndex (int) index of the voice in the matrix
+    */
+    void setModulation(int voice, ModulationMatrix* matrix, int matrixIndex)
+    {
+        modulations[voice].setMatrix(matrix, matrixIndex);
+    }
+
+    /**
+    * start the note of a voice, after its envelope parameters are set
+    *
+    * @param voice (int) index of the voice in the bank
+    * @param velocity (float) velocity of the note (0 - 1)
+    */
+    void startVoice(int voice, float velocity)
+    {
+        playing[voice] = true;
+        ending[voice] = false;
+        modulations[voice].noteOn(velocity);
+        envelopes.reset(voice);
+        envelopes.noteOn(voice);
+    }
+
+    /**
+    * release the note of a voice, it plays until its tail has faded out
+    *
+    * @param voice (int) index of the voice in the bank
+    */
+    void releaseVoice(int voice)
+    {
+        envelopes.noteOff(voice);
+        ending[voice] = true;
+    }
+
+    /**
+    * stop a voice straight away
+    *
+    * @param voice (int) index of the voice in the bank
+    */
+    void stopVoice(int voice)
+    {
+        playing[voice] = false;
+    }
+
+    /**
+    * returns true while the voice is playing its note or its tail
+    *
+    * @param voice (int) index of the voice in the bank
+    */
+    bool isPlaying(int voice) const
+    {
+        return playing[voice];
+    }
+
+protected:
+    /**
+    * list the playing voices of a range
+    *
+    * @param firstVoice (int) index of the first voice
+    * @param numVoices (int) number of voices
+    * @return number of playing voices
+    */
+    int collectActiveVoices(int firstVoice, int numVoices)
+    {
+        numActive = 0;
+
+        for (int v = firstVoice; v < firstVoice + numVoices; v++)
+        {
+            if (playing[v])
+                active[numActive++] = v;
+        }
+
+        return numActive;
+    }
+
+    /**
+    * read the modulation of the send level, stereo position and gain of the playing voices ( once per block )
+    *
+    * @param startSample (int) position of the first sample in the output buffer
+    * @param numSamples (int) number of samples
+    */
+    void updateModulation(int startSample, int numSamples)
+    {
+        int lastSample = startSample + numSamples - 1;
+
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            const VoiceModulation& modulation = modulations[v];
+
+            outputs[v].setStereoPosition(modulation.getPan(stereoPositions[v], lastSample));
+            startGains[v] = modulation.getGain(startSample - 1);
+            endGains[v] = modulation.getGain(lastSample);
+            startSends[v] = startGains[v] * modulation.getSendLevel(sendLevels[v], startSample - 1);
+            endSends[v] = endGains[v] * modulation.getSendLevel(sendLevels[v], lastSample);
+            rendered[v] = numSamples;
+        }
+    }
+
+    /**
+    * envelope stage, writes the envelopes of all the playing voices together, a block at a time
+    *
+    * @param numSamples (int) number of samples
+    */
+    void renderEnvelopes(int numSamples)
+    {
+        float* blocks[maxVoices];
+        int ends[maxVoices];
+
+        for (int a = 0; a < numActive; a++)
+        {
+            blocks[a] = envelopeBlocks[active[a]];
+        }
+
+        envelopes.process(active, numActive, blocks, ends, numSamples);
+
+        for (int a = 0; a < numActive; a++)
+        {
+            envelopeEnds[active[a]] = ends[a];
+        }
+    }
+
+    /**
+    * envelope stage, multiply the block of every playing voice by its envelope
+    *
+    * @param numSamples (int) number of samples
+    */
+    void applyEnvelopes(int numSamples)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            juce::FloatVectorOperations::multiply(outputs[v].getBlock(), envelopeBlocks[v], numSamples);
+        }
+    }
+
+    /**
+    * find the released voices whose envelope became silent in this block, the block of a voice ends on its first silent sample
+    * the echoes of the voice carry on in the delay of the layer
+    */
+    void findTails()
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+
+            if (ending[v] && ! envelopes.isActive(v))
+            {
+                rendered[v] = juce::jmax(1, envelopeEnds[v]);
+                playing[v] = false;
+                owners[v]->noteFinished();
+            }
+        }
+    }
+
+    /**
+    * output stage, add the block of every playing voice to the output buffer and to the send bus of the delay
+    * the send bus has the same sample positions as the output buffer
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to the synthesiser
+    * @param startSample (int) position of the first sample in the output buffer
+    */
+    void mixInto(juce::AudioBuffer<float>& outputBuffer, int startSample)
+    {
+        for (int a = 0; a < numActive; a++)
+        {
+            int v = active[a];
+            modulations[v].setEnvelope(envelopeBlocks[v][rendered[v] - 1]);
+
+            if (sendDelay != nullptr)
+                outputs[v].sendTo(sendDelay->getSendBus(), startSample, rendered[v], startSends[v], endSends[v]);
+
+            outputs[v].mixInto(outputBuffer, startSample, rendered[v], startGains[v], endGains[v]);
+        }
+    }
+
+    // playing voices of the block being rendered
+    int active[maxVoices] = {};
+    int numActive = 0;
+
+    // hot state, one entry per voice
+    VoiceOutput outputs[maxVoices];                         // output blocks and stereo positions
+    alignas(16) float envelopeBlocks[maxVoices][maxBlockSize] = {};
+    BlockEnvelope envelopes;                                // one lane per voice
+    int envelopeEnds[maxVoices] = {};                       // samples of the block until the envelope is silent
+    int rendered[maxVoices] = {};                           // samples of the block the voice plays
+    float startGains[maxVoices] = {};
+    float endGains[maxVoices] = {};
+    float startSends[maxVoices] = {};                       // gain times send level
+    float endSends[maxVoices] = {};
+    bool playing[maxVoices] = {};
+    bool ending[maxVoices] = {};                            // released, plays until its tail is silent
+
+    // state only read once per block or per note
+    VoiceModulation modulations[maxVoices];
+    float sendLevels[maxVoices] = {};                       // send level without modulation
+    float stereoPositions[maxVoices] = {};                  // position without modulation
+    BankedVoice* owners[maxVoices] = {};
+    SendDelay* sendDelay = nullptr;                         // delay of the layer
+
+    static_assert(maxVoices <= BlockEnvelope::maxLanes, "one envelope lane per voice");
+};
+
+/**
+* synthesiser that renders all its voices through a VoiceBank, stage by stage, instead of one voice at a time
+*
+* @param Bank the bank of the layer, with render(outputBuffer, startSample, numSamples, firstVoice, numVoices)
+* @return getBank() (Bank&) the bank the voices are connected to
+*/
+template <typename Bank>
+class VoiceBankSynthesiser : public juce::Synthesiser
+{
+public:
+
+    /**
+    * returns the bank the voices of the synthesiser are connected to
+    */
+    Bank& getBank()
+    {
+        return bank;
+    }
+
+protected:
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        bank.render(outputAudio, startSample, numSamples, 0, getNumVoices());
+    }
+
+private:
+    Bank bank;
+};
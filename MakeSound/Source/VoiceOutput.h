@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    VoiceOutput.h
+
+    Contains class VoiceOutput
+
+    Mono scratch block for a synthesiser voice. The voice renders its samples into
+    the block, then the block is added to every output channel with one vectorised
+    gain-and-add per channel (instead of addSample() for every sample and channel)
+
+    The block can also be added to a send bus ( sendTo() ) at a send level
+
+    Requires <JuceHeader.h> for AudioBuffer and FloatVectorOperations
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/**
+* mono scratch block with a stereo position, used by the voices to write their output
+*
+* @param pan (float) stereo position of the voice (-1 left, 0 centre, 1 right)
+* @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+* @param sendBuffer (juce::AudioBuffer<float>&) send bus of the layer
+* @param startSample (int) position of the first sample in outputBuffer
+* @param numSamples (int) number of samples rendered into the block
+* @param gain (float) gain applied while mixing
+* @param startGain (float) gain at the start of the block ( a gain ramp )
+* @param endGain (float) gain at the end of the block
+* @return getBlock() (float*) the scratch block, holds maxBlockSize samples
+*/
+class VoiceOutput
+{
+public:
+    static constexpr int maxBlockSize = 256; // voices render in chunks of at most this many samples
+
+    /**
+    * returns the scratch block that the voice renders into
+    */
+    float* getBlock()
+    {
+        return block;
+    }
+
+    /**
+    * set the stereo position of the voice (equal-power, centre is unity gain)
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        float angle = (juce::jlimit(-1.0f, 1.0f, pan) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+        targetGains[0] = std::cos(angle) * juce::MathConstants<float>::sqrt2;
+        targetGains[1] = std::sin(angle) * juce::MathConstants<float>::sqrt2;
+    }
+
+    /**
+    * add the rendered block to all the channels of the output buffer
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+    * @param startSample (int) position of the first sample in outputBuffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param gain (float) gain applied while mixing
+    */
+    void mixInto(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, float gain = 1.0f)
+    {
+        mixInto(outputBuffer, startSample, numSamples, gain, gain);
+    }
+
+    /**
+    * add the rendered block to all the channels of the output buffer with a gain ramp ( modulated gain )
+    *
+    * @param outputBuffer (juce::AudioBuffer<float>&) buffer passed to renderNextBlock()
+    * @param startSample (int) position of the first sample in outputBuffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param startGain (float) gain at the start of the block
+    * @param endGain (float) gain at the end of the block
+    */
+    void mixInto(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples, float startGain, float endGain)
+    {
+        addTo(outputBuffer, startSample, numSamples, startGain, endGain);
+
+        currentGains[0] = targetGains[0];
+        currentGains[1] = targetGains[1];
+    }
+
+    /**
+    * add the rendered block to a send bus ( e.g. of a SendDelay ) with the stereo position of the voice
+    * called before mixInto(), which moves the stereo position on to the next block
+    *
+    * @param sendBuffer (juce::AudioBuffer<float>&) send bus, same positions as the output buffer
+    * @param startSample (int) position of the first sample in sendBuffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param startGain (float) send level at the start of the block
+    * @param endGain (float) send level at the end of the block
+    */
+    void sendTo(juce::AudioBuffer<float>& sendBuffer, int startSample, int numSamples, float startGain, float endGain)
+    {
+        if (startGain > 0.0f || endGain > 0.0f)
+            addTo(sendBuffer, startSample, numSamples, startGain, endGain);
+    }
+
+private:
+    /**
+    * add the block to all the channels of a buffer with a gain ramp, panned from the current to the target position
+    *
+    * @param buffer (juce::AudioBuffer<float>&) buffer to add to
+    * @param startSample (int) position of the first sample in buffer
+    * @param numSamples (int) number of samples rendered into the block
+    * @param startGain (float) gain at the start of the block
+    * @param endGain (float) gain at the end of the block
+    */
+    void addTo(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, float startGain, float endGain)
+    {
+        int numChannels = buffer.getNumChannels();
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* out = buffer.getWritePointer(chan, startSample);
+
+            float start = startGain;
+            float end = endGain;
+
+            if (numChannels > 1 && chan < 2) // stereo position, not for mono or extra channels
+            {
+                start *= currentGains[chan];
+                end *= targetGains[chan];
+            }
+
+            if (start == end)
+            {
+                juce::FloatVectorOperations::addWithMultiply(out, block, end, numSamples);
+            }
+            else // the position or the gain changed, ramp over this block
+            {
+                float increment = (end - start) / numSamples;
+
+                for (int i = 0; i < numSamples; i++)
+                {
+                    out[i] += block[i] * (start + increment * i);
+                }
+            }
+        }
+    }
+
+    alignas(16) float block[maxBlockSize] = {};
+    float currentGains[2] = { 1.0f, 1.0f };
+    float targetGains[2] = { 1.0f, 1.0f };
+};
@@ -10,6 +10,12 @@
     Requires <JuceHeader.h> 
     Requires "Oscillator.h" to generate oscillators 
     Requires "KeySignatures.h" to set the key of the played notes
+    Requires "VoiceOutput.h" to write the output of the voice
+    Requires "RandomStream.h" for the random values
+    Requires "NoteRenderCache.h" to replay notes rendered in advance
+    Requires "ModulationMatrix.h" for the gain, pan and delay send modulation
+    Requires "SendDelay.h" for the delay of the layer
+    Requires "BlockEnvelope.h" for the envelope of the voice
 
   ==============================================================================
 */
@@ -19,6 +25,15 @@
 #include <JuceHeader.h>
 #include "Oscillator.h"
 #include "KeySignatures.h"
+#include "VoiceOutput.h"
+#include "RandomStream.h"
+#include "NoteRenderCache.h"
+#include "ModulationMatrix.h"
+#include "SendDelay.h"
+#include "BlockEnvelope.h"
+
+// cache of pre-rendered pulse notes, the end state lets a voice carry on live after the cached audio
+using PulseNoteCache = NoteRenderCache<KeySignatures::SequenceState>;
 
 // ===========================
 // ===========================
@@ -43,7 +58,6 @@ public:
 * inherits from juce::SynthesiserVoice
 *
 * @param sampleRate (float) sample rate
-* @param volumeInput (std::atomic<float>) pointer to volume
 * @param instensity (float) set ADSR value
 * @param _selectedMode (setModeLimit(std::vector<int>) vector of modes (the number of each mode)
 * @output getMode() outputs the mode (int) ( this is set whenever a key is pressed )
@@ -53,6 +67,9 @@ class pulseSynthVoice : public juce::SynthesiserVoice
 public:
     pulseSynthVoice() {}
 
+    // longest release set in setADSRValues() ( e^4 seconds at velocity 1 )
+    static constexpr float maxTailSeconds = 54.6f;
+
     /**
     * set sample rate 
     * 
@@ -61,34 +78,109 @@ public:
     void init(float sampleRate)
     {
         // set sample rate for oscillators and envelop
-        env.setSampleRate(sampleRate);
+        env.setSampleRate(0, sampleRate);
         key.setOscillatorParams(sampleRate);
+        key.generateNotesForModes(4);   // enough octaves for every velocity
+        releaseCachedNote();            // the cache is prepared again
+    }
 
-        // smooth value setting for volume
-        smoothVolume.reset(sampleRate, 1.0f);
-        smoothVolume.setCurrentAndTargetValue(0.0);
+    /*
+    * set the mode ( the base note is not set, user is free to play in other keys)
+    *
+    * @param _mode (int) mode number, e.g. 0 = ionian
+    */
+    void setMode(int _mode)
+    {
+        mode = _mode;
     }
 
     /**
-    * set pointer to volume parameter
+    * set the seed of the random streams of the voice ( the voice and its key signature use two streams )
     *
-    * @param volumeInput pointer to volume input
+    * @param seed (juce::uint64) seed of the processor
+    * @param voiceIndex (int) index of the voice, every voice of every layer needs a different index
     */
-    void setVolumePointer(std::atomic<float>* volumeInput)
+    void setRandomSeed(juce::uint64 seed, int voiceIndex)
     {
-        volume = volumeInput;
+        randomSeed = seed;
+        random.setSeed(seed, 2 * voiceIndex);
+        key.setRandomSeed(seed, 2 * voiceIndex + 1);
     }
 
-    /*
-    * set the mode ( the base note is not set, user is free to play in other keys)
+    /**
+    * set the cache of pre-rendered notes - called once per block before rendering
+    * 
+    * @param cache (PulseNoteCache*) cache shared by the voices of the layer
+    * @param enabled (bool) true to replay the notes from the cache ( the notes are then rendered from a known state )
+    */
+    void setNoteCache(PulseNoteCache* cache, bool enabled)
+    {
+        noteCache = cache;
+        cacheEnabled = enabled;
+    }
+
+    /**
+    * render the start of a note for the cache, the same way a voice renders it ( called on the cache thread )
+    * 
+    * @param cacheKey (KeySignatures&) key signature used by the cache thread, set up like the one of a voice
+    * @param noteKey (const PulseNoteCache::NoteKey&) inputs of the note
+    * @param audio (float*) block to write the note into ( no envelope )
+    * @param numSamples (int) number of samples
+    * @param endState (KeySignatures::SequenceState&) state of the sequencer at the end of the audio
+    */
+    static void renderCachedNote(KeySignatures& cacheKey, const PulseNoteCache::NoteKey& noteKey, float* audio, int numSamples, KeySignatures::SequenceState& endState)
+    {
+        setupKey(cacheKey, noteKey.note, noteKey.velocity / 127.0f, noteKey.mode);
+        cacheKey.setPulseSpeed(noteKey.speed);
+        cacheKey.resetState(noteKey.seed, noteKey.getStreamIndex());
+        cacheKey.renderSequence(audio, numSamples);
+        cacheKey.saveState(endState);
+    }
+
+    /**
+    * set the tempo and position of the host - called once per block before rendering
     *
-    * @param _mode (int) mode number, e.g. 0 = ionian
+    * @param sync (bool) true if the steps follow the host tempo
+    * @param bpm (double) tempo of the host in beats per minute
+    * @param ppqPosition (double) position of the host in beats at the start of the block
+    * @param hostPlaying (bool) true if the host is playing
     */
-    void setMode(int _mode)
+    void setHostTempo(bool sync, double bpm, double ppqPosition, bool hostPlaying)
     {
-        mode = _mode;
+        key.setHostTempo(sync, bpm, ppqPosition, hostPlaying);
     }
 
+    /**
+    * set the stereo position of the voice
+    *
+    * @param pan (float) -1 left, 0 centre, 1 right
+    */
+    void setStereoPosition(float pan)
+    {
+        stereoPosition = pan;
+        output.setStereoPosition(pan);
+    }
+
+    /**
+    * connect the voice to the modulation matrix ( gain, pan and delay send, the notes themselves are cached and stay unmodulated )
+    *
+    * @param matrix (ModulationMatrix*) matrix of the processor
+    * @param voiceIndex (int) index of the voice in the matrix
+    */
+    void setModulation(ModulationMatrix* matrix, int voiceIndex)
+    {
+        modulation.setMatrix(matrix, voiceIndex);
+    }
+
+    /**
+    * set the delay the voice sends to
+    *
+    * @param _sendDelay (SendDelay*) delay of the layer
+    */
+    void setSendDelay(SendDelay* _sendDelay)
+    {
+        sendDelay = _sendDelay;
+    }
 
     //--------------------------------------------------------------------------
     /**
@@ -106,17 +198,32 @@ public:
 
         // get local reference of the base note
         baseNote = midiNoteNumber;
-        float numOctaves = ceil(velocity * 3) + 1; // set the number of octaves according the velocity
-        
-        // set freqeuncies 
-        key.generateNotesForModes(numOctaves);
-        key.changeMode(baseNote, mode, numOctaves);  // the mode is updated whenever a note starts for FMSynth.h
-        
-        // set lfo frequency accroding to velocity
-        float lfoFrequency = velocity / 10; // scaled to between 0 and 0.1
-        key.setLfofreq(lfoFrequency);
+        releaseCachedNote();
+
+        if (noteCache != nullptr && cacheEnabled) // the note only depends on its inputs, it can be replayed from the cache
+        {
+            PulseNoteCache::NoteKey noteKey;
+            noteKey.note = midiNoteNumber;
+            noteKey.velocity = juce::roundToInt(velocity * 127.0f);
+            noteKey.mode = mode;
+            noteKey.speed = pulseSpeedChange;
+            noteKey.seed = randomSeed;
+
+            setupKey(key, noteKey.note, noteKey.velocity / 127.0f, noteKey.mode);
+            key.setPulseSpeed(noteKey.speed);
+            key.resetState(noteKey.seed, noteKey.getStreamIndex());
+
+            cacheSlot = noteCache->acquire(noteKey);    // -1 on a miss, the note is rendered live
+            replayPosition = 0;
+        }
+        else
+        {
+            setupKey(key, midiNoteNumber, velocity, mode);  // the mode is updated whenever a note starts for FMSynth.h
+            key.resetSequence();                            // the first pulse starts with the note
+        }
 
         setADSRValues(velocity); // set ADSR values
+        modulation.noteOn(velocity);
     }
 
     /**
@@ -127,7 +234,7 @@ public:
     void setADSRValues(float instensity)
     {
         
-        float envelopeRelease = exp (instensity * 6.0f - 2.0f); // scaled value (range e^-2 to e^3)
+        float envelopeRelease = exp (instensity * 6.0f - 2.0f); // scaled value (range e^-2 to e^4)
         float sustainParameter;
 
         if (instensity > 0.8f) // sustain value is low if internsity is high
@@ -145,14 +252,15 @@ public:
         }
 
         // envelopes
-        juce::ADSR::Parameters envParams;       // create insatnce of ADSR envelop
+        BlockEnvelope::Parameters envParams;    // create insatnce of ADSR envelop
         envParams.attack = 0.1f;                // fade in
         envParams.decay = 0.15f;                // fade down to sustain level
         envParams.sustain = sustainParameter;    // vol level
         envParams.release = envelopeRelease;    // fade out 
-        env.setParameters(envParams);           // set the envelop parameters
-        env.reset();
-        env.noteOn();
+        envParams.releaseCurve = BlockEnvelope::exponential;    // the long release fades out like a natural decay
+        env.setParameters(0, envParams);        // set the envelop parameters
+        env.reset(0);
+        env.noteOn(0);
     }
 
     //--------------------------------------------------------------------------
@@ -167,12 +275,13 @@ public:
     {
         if (allowTailOff) // allow slow release of note
         {
-            env.noteOff();
+            env.noteOff(0);
             ending = true;
         }
         else // shut off note
         {
             clearCurrentNote();
+            releaseCachedNote();
             playing = false;
         }
     }
@@ -189,38 +298,70 @@ public:
      */
     void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override
     {
-        if (playing) // check to see if this voice should be playing
-        {
-            // smooth value for volume
-            smoothVolume.setTargetValue(*volume); 
-            float gainVal = smoothVolume.getNextValue();
+        if (playing)
+            key.alignToHost(startSample); // step boundaries follow the host beats when tempo sync is on
 
-            // DSP loop (from startSample up to startSample + numSamples)
-            for (int sampleIndex = startSample; sampleIndex < (startSample + numSamples); sampleIndex++)
+        // render in chunks of the scratch block size, as long as this voice should be playing
+        while (playing && numSamples > 0)
+        {
+            int blockSize = juce::jmin(numSamples, VoiceOutput::maxBlockSize);
+            float* block = output.getBlock();
+            int rendered = 0;
+            float envVal = 0.0f;
+
+            // modulation, read once per chunk ( at the end of the chunk )
+            int lastSample = startSample + blockSize - 1;
+            output.setStereoPosition(modulation.getPan(stereoPosition, lastSample));
+            float startGain = modulation.getGain(startSample - 1);
+            float endGain = modulation.getGain(lastSample);
+            float startSend = startGain * modulation.getSendLevel(sendLevel, startSample - 1);
+            float endSend = endGain * modulation.getSendLevel(sendLevel, lastSample);
+
+            int replayed = 0;
+
+            if (cacheSlot >= 0) // copy the cached audio of the note
             {
-                float envVal = env.getNextSample(); // get envelop value
-                key.setPulseSpeed(pulseSpeedChange); // change the pulse speed  
-                key.changeFreq();                   // change freq every one second
+                replayed = juce::jmin(blockSize, noteCache->getEntryLength() - replayPosition);
+                juce::FloatVectorOperations::copy(block, noteCache->getAudio(cacheSlot) + replayPosition, replayed);
+                replayPosition += replayed;
 
-                // output
-                float currentSample = key.randomNoteGenerator() * envVal;
-
-                // for each channel, write the currentSample float to the output
-                for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
+                if (replayPosition >= noteCache->getEntryLength()) // end of the cached audio, carry on live from its end state
                 {
-                    // The output sample is scaled by 0.2 so that it is not too loud by default
-                    outputBuffer.addSample(chan, sampleIndex, currentSample * gainVal);
+                    key.loadState(noteCache->getEndState(cacheSlot));
+                    releaseCachedNote();
                 }
+            }
 
-                if (ending) // if it is entering the ending phase
-                { 
-                    if (envVal < 0.0001) // turn off the sound envelope < 0.0001
-                    {
-                        clearCurrentNote();
-                        playing = false;
-                    }
-                }
+            if (replayed < blockSize)
+            {
+                // sequencer, rendered in spans between the step boundaries (mono, into the scratch block)
+                key.setPulseSpeed(pulseSpeedChange);
+                key.renderSequence(block + replayed, blockSize - replayed);
+            }
+
+            // envelope, rendered for the whole block, it ends on its first silent sample once the note is released
+            rendered = env.process(0, envelopeBlock, blockSize);
+            juce::FloatVectorOperations::multiply(block, envelopeBlock, rendered);
+
+            if (rendered > 0)
+                envVal = envelopeBlock[rendered - 1];
+
+            if (! env.isActive(0)) // turn off the sound, the envelope is silent
+            {
+                clearCurrentNote();
+                releaseCachedNote();
+                playing = false;
             }
+
+            // add the block to every channel of the output
+            modulation.setEnvelope(envVal);
+
+            if (sendDelay != nullptr)
+                output.sendTo(sendDelay->getSendBus(), startSample, rendered, startSend, endSend);
+
+            output.mixInto(outputBuffer, startSample, rendered, startGain, endGain);
+            startSample += rendered;
+            numSamples -= rendered;
         }
     }
     //--------------------------------------------------------------------------
@@ -253,16 +394,41 @@ public:
 
     //--------------------------------------------------------------------------
 private:
+    /**
+    * set up the key signature for a note
+    *
+    * @param noteKey (KeySignatures&) key signature to set up
+    * @param midiNoteNumber (int) base note of the sequence
+    * @param velocity (float) sets the number of octaves and the lfo frequency
+    * @param noteMode (int) mode number, e.g. 0 = ionian
+    */
+    static void setupKey(KeySignatures& noteKey, int midiNoteNumber, float velocity, int noteMode)
+    {
+        int numOctaves = (int) ceil(velocity * 3) + 1;  // set the number of octaves according the velocity
+        noteKey.changeMode(midiNoteNumber, noteMode, numOctaves);
+        noteKey.setLfofreq(velocity / 10);              // scaled to between 0 and 0.1
+    }
+
+    /**
+    * stop replaying the cached note, the cache can reuse its slot
+    */
+    void releaseCachedNote()
+    {
+        if (cacheSlot >= 0)
+            noteCache->release(cacheSlot);
+
+        cacheSlot = -1;
+    }
+
     //--------------------------------------------------------------------------
     bool playing = false;       // set default value for playing to be false
     bool ending = false;        // bool to determine the moment the note is released
-    juce::ADSR env;             // envelope for synthesiser
-
-    std::atomic<float>* volume;              // volume parameter
-    juce::SmoothedValue<float> smoothVolume; // smooth value
+    BlockEnvelope env;          // envelope for synthesiser ( lane 0 )
+    alignas(16) float envelopeBlock[VoiceOutput::maxBlockSize] = {};
 
     // used to set the key of sequencer 
     KeySignatures key;
+    VoiceOutput output;             // scratch block the voice renders into
     int baseNote;
     int numOctaves;
     int mode = 0;                   // set default value of the mode ( ionian )
@@ -270,6 +436,21 @@ private:
     // pulse speed default value
     float pulseSpeedChange = 0.5;
 
-    juce::Random random;            // random is called to select the notes to be played
+    RandomStream random;            // random is called to select the notes to be played
+    juce::uint64 randomSeed = 0;    // seed of the processor, part of the inputs of a cached note
+
+    // cache of pre-rendered notes
+    PulseNoteCache* noteCache = nullptr;
+    bool cacheEnabled = false;
+    int cacheSlot = -1;             // slot of the note being replayed, -1 if the note is rendered live
+    int replayPosition = 0;         // position in the cached audio
+
+    // modulation matrix
+    VoiceModulation modulation;
+    float stereoPosition = 0.0f;    // position of the voice without modulation
+
+    // send to the delay of the layer
+    SendDelay* sendDelay = nullptr;
+    float sendLevel = 0.5f;         // send level without modulation
 
 };
@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    AP3Plugin.cpp
+
+    Compiles the processor and the editor of AP3 into the test target.
+    A console app has no JucePluginDefines.h, so the plugin settings of
+    AP3.jucer are defined here
+
+  ==============================================================================
+*/
+
+#define JucePlugin_Name                 "AP3"
+#define JucePlugin_IsSynth              1
+#define JucePlugin_WantsMidiInput       1
+#define JucePlugin_ProducesMidiOutput   0
+#define JucePlugin_IsMidiEffect         0
+
+#include "../../../AP3/Source/PluginProcessor.cpp"
+#include "../../../AP3/Source/PluginEditor.cpp"
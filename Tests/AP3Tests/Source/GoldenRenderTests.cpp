@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    GoldenRenderTests.cpp
+
+    Contains class AP3GoldenRenderTests
+
+    Renders fixed midi scenarios through AP3AudioProcessor and compares the
+    output and the realtime factor with Golden.txt. AP3 has no random
+    source, so the renders do not need a seed
+
+    Requires "RenderHarness.h" for the scenarios and the golden file
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+#include "../../../AP3/Source/PluginProcessor.h"
+
+/**
+* golden renders of AP3
+*/
+class AP3GoldenRenderTests : public juce::UnitTest
+{
+public:
+    AP3GoldenRenderTests() : juce::UnitTest("AP3 golden renders", "AP3") {}
+
+    void runTest() override
+    {
+        for (auto& scenario : getScenarios())
+        {
+            beginTest(scenario.name);
+
+            RenderHarness::checkScenario(*this, createProcessor, scenario);
+        }
+    }
+
+private:
+    /**
+    * returns a new processor, every render starts from a new instance
+    */
+    static std::unique_ptr<juce::AudioProcessor> createProcessor()
+    {
+        return std::make_unique<AP3AudioProcessor>();
+    }
+
+    /**
+    * returns the scenarios, every note plays the unison saws and the sampler. The saws are turned up
+    * in every scenario, the sample of the sampler is not on every machine and they would render silence
+    */
+    static std::vector<RenderHarness::Scenario> getScenarios()
+    {
+        std::vector<RenderHarness::Scenario> scenarios;
+
+        // low-register melody, through the delay
+        RenderHarness::Scenario lowMelody("lowMelody", 8.0);
+        const int melodyNotes[] = { 36, 38, 40, 41, 43, 45, 47 };
+
+        for (int i = 0; i < 7; i++)
+        {
+            lowMelody.note(i * 0.75, 0.6, melodyNotes[i], 0.8f);
+        }
+
+        lowMelody.parameter("synthLevel", 0.5f).parameter("delayLevel", 0.5f);
+        scenarios.push_back(lowMelody);
+
+        // mid-range pads, two held chords with every unison saw
+        RenderHarness::Scenario pads("midPads", 8.0);
+        pads.note(0.0, 3.0, 60, 0.7f).note(0.0, 3.0, 64, 0.7f).note(0.0, 3.0, 67, 0.7f)
+            .note(3.0, 3.0, 62, 0.9f).note(3.0, 3.0, 65, 0.9f).note(3.0, 3.0, 69, 0.9f)
+            .parameter("synthLevel", 0.5f).parameter("unisonVoices", 16.0f).parameter("unisonWidth", 1.0f);
+        scenarios.push_back(pads);
+
+        // fast high sequence, more notes than voices so that voices are stolen
+        RenderHarness::Scenario highSequence("highSequence", 6.0);
+
+        for (int i = 0; i < 40; i++)
+        {
+            highSequence.note(i * 0.125, 0.25, 72 + (i * 5) % 25, 0.6f);
+        }
+
+        highSequence.parameter("synthLevel", 0.5f).parameter("delayLevel", 0.3f).parameter("delayModDepth", 5.0f);
+        scenarios.push_back(highSequence);
+
+        // sustain pedal sweeps over repeated chords
+        RenderHarness::Scenario sustainSweeps("sustainSweeps", 8.0);
+        sustainSweeps.note(0.0, 0.5, 48, 0.8f).note(0.0, 0.5, 55, 0.8f).note(2.0, 0.5, 50, 0.8f).note(2.0, 0.5, 57, 0.8f)
+                     .sweep(0.0, 3.0, 64, 0, 127).sweep(3.0, 3.0, 64, 127, 0).parameter("synthLevel", 0.5f);
+        scenarios.push_back(sustainSweeps);
+
+        return scenarios;
+    }
+};
+
+static AP3GoldenRenderTests ap3GoldenRenderTests;
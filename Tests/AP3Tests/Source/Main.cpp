@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Test target of AP3: runs the unit tests of the "AP3" category
+    with a fixed seed and returns 1 if any of them failed
+
+    AP3Tests             compare the renders with Golden.txt
+    AP3Tests --record    write the renders of this build to Golden.txt
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;    // message manager for the processors
+
+    return RenderHarness::runTests(argc, argv, "AP3", "AP3Tests.jucer");
+}
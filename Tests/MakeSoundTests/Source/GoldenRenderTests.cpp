@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    GoldenRenderTests.cpp
+
+    Contains class MakeSoundGoldenRenderTests
+
+    Renders fixed midi scenarios through MakeSoundAudioProcessor with a fixed
+    seed, one per layer of the keyboard split plus a controller sweep, and
+    compares the output and the realtime factor with Golden.txt
+
+    Requires "RenderHarness.h" for the scenarios and the golden file
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+#include "../../../MakeSound/Source/PluginProcessor.h"
+
+/**
+* golden renders of MakeSound
+*/
+class MakeSoundGoldenRenderTests : public juce::UnitTest
+{
+public:
+    MakeSoundGoldenRenderTests() : juce::UnitTest("MakeSound golden renders", "MakeSound") {}
+
+    void runTest() override
+    {
+        for (auto& scenario : getScenarios())
+        {
+            beginTest(scenario.name);
+
+            RenderHarness::checkScenario(*this, createProcessor, scenario);
+        }
+    }
+
+private:
+    /**
+    * returns a new processor with the fixed seed, every render starts from a new instance
+    */
+    static std::unique_ptr<juce::AudioProcessor> createProcessor()
+    {
+        auto processor = std::make_unique<MakeSoundAudioProcessor>();
+        processor->setRandomSeed(RenderHarness::randomSeed);
+        return std::move(processor);
+    }
+
+    /**
+    * returns the scenarios, the keyboard split sends C2 and below to the melody layer,
+    * C#2 to B2 to the fm pads and C3 and above to the pulse layer
+    */
+    static std::vector<RenderHarness::Scenario> getScenarios()
+    {
+        std::vector<RenderHarness::Scenario> scenarios;
+
+        // low-register melody
+        RenderHarness::Scenario lowMelody("lowMelody", 8.0);
+        const int melodyNotes[] = { 24, 26, 28, 29, 31, 33, 35 };
+
+        for (int i = 0; i < 7; i++)
+        {
+            lowMelody.note(i * 0.75, 0.6, melodyNotes[i], 0.8f);
+        }
+
+        scenarios.push_back(lowMelody);
+
+        // mid-range fm pads, two held chords
+        RenderHarness::Scenario fmPads("midFmPads", 8.0);
+        fmPads.note(0.0, 3.0, 36, 0.7f).note(0.0, 3.0, 40, 0.7f).note(0.0, 3.0, 43, 0.7f)
+              .note(3.0, 3.0, 38, 0.9f).note(3.0, 3.0, 41, 0.9f).note(3.0, 3.0, 45, 0.9f);
+        scenarios.push_back(fmPads);
+
+        // high pulse sequences, overlapping notes with the step sequencer running free
+        RenderHarness::Scenario highPulse("highPulse", 6.0);
+        highPulse.note(0.0, 2.0, 60, 0.5f).note(0.5, 2.0, 67, 0.7f).note(1.0, 2.0, 72, 0.9f).note(1.5, 2.0, 79, 1.0f)
+                 .parameter("pulseSync", 0.0f);
+        scenarios.push_back(highPulse);
+
+        // mod wheel sweeps routed to the cutoff and the pan of every layer
+        RenderHarness::Scenario ccSweeps("ccSweeps", 8.0);
+        ccSweeps.note(0.0, 6.0, 30, 0.8f).note(0.0, 6.0, 36, 0.8f).note(0.0, 6.0, 43, 0.8f).note(0.5, 5.0, 64, 0.8f)
+                .sweep(0.0, 3.0, 1, 0, 127).sweep(3.0, 3.0, 1, 127, 0)
+                .parameter("mod1Source", 5.0f).parameter("mod1Destination", 0.0f).parameter("mod1Amount", 1.0f)
+                .parameter("mod2Source", 5.0f).parameter("mod2Destination", 3.0f).parameter("mod2Amount", 0.5f);
+        scenarios.push_back(ccSweeps);
+
+        return scenarios;
+    }
+};
+
+static MakeSoundGoldenRenderTests makeSoundGoldenRenderTests;
@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Test target of MakeSound: runs the unit tests of the "MakeSound" category
+    with a fixed seed and returns 1 if any of them failed
+
+    MakeSoundTests             compare the renders with Golden.txt
+    MakeSoundTests --record    write the renders of this build to Golden.txt
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;    // message manager for the processors
+
+    return RenderHarness::runTests(argc, argv, "MakeSound", "MakeSoundTests.jucer");
+}
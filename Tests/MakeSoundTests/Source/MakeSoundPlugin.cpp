@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    MakeSoundPlugin.cpp
+
+    Compiles the processor and the editor of MakeSound into the test target.
+    A console app has no JucePluginDefines.h, so the plugin settings of
+    MakeSound.jucer are defined here
+
+  ==============================================================================
+*/
+
+#define JucePlugin_Name                 "MakeSound"
+#define JucePlugin_IsSynth              1
+#define JucePlugin_WantsMidiInput       1
+#define JucePlugin_ProducesMidiOutput   0
+#define JucePlugin_IsMidiEffect         0
+
+#include "../../../MakeSound/Source/PluginProcessor.cpp"
+#include "../../../MakeSound/Source/PluginEditor.cpp"
@@ -0,0 +1,296 @@
+/*
+  ==============================================================================
+
+    MultiRateLayerTests.cpp
+
+    Contains class MakeSoundMultiRateLayerTests
+
+    Checks the hand-off between host blocks in MultiRateLayer. Host blocks of
+    odd sizes do not hold a whole number of internal samples, so the output
+    of a layer played in odd blocks has to match the same layer played in one
+    block, every midi event has to land on the internal sample that covers it
+    ( or wait for the next block that renders ), and the layer has to stay
+    active until the interpolators have let out the whole tail
+
+    Requires "MultiRateLayer.h" and "Oversampling.h"
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../MakeSound/Source/MultiRateLayer.h"
+
+/**
+* leftover samples, midi positions and latency of MultiRateLayer across odd block sizes
+*/
+class MakeSoundMultiRateLayerTests : public juce::UnitTest
+{
+public:
+    MakeSoundMultiRateLayerTests() : juce::UnitTest("MakeSound multi-rate layer", "MakeSound") {}
+
+    void runTest() override
+    {
+        for (int factor : { 2, 4 })
+        {
+            beginTest("interpolator latency, factor " + juce::String(factor));
+            checkLatency(factor);
+
+            beginTest("leftover samples are carried across odd block sizes, factor " + juce::String(factor));
+            checkLeftoverSamples(factor);
+
+            beginTest("midi lands on the internal sample that covers it, factor " + juce::String(factor));
+            checkEventPositions(factor);
+
+            beginTest("the layer stays active for the whole tail, factor " + juce::String(factor));
+            checkTail(factor);
+        }
+    }
+
+private:
+    static constexpr int totalSamples = 8192;   // host samples of a whole run
+    static constexpr int maxBlockSize = 512;
+
+    /**
+    * host block sizes that leave 1, 2 or 3 samples over at the internal rate, and blocks too small to render at all
+    */
+    static int getBlockSize(int block)
+    {
+        static const int sizes[] = { 1, 3, 7, 2, 511, 13, 1, 1, 64, 5, 257, 6, 1, 127, 33, 9 };
+        return sizes[block % (int) (sizeof(sizes) / sizeof(sizes[0]))];
+    }
+
+    /**
+    * the test signal at the internal rate, a slow sine on the left and a ramp on the right
+    *
+    * @param bus (juce::AudioBuffer<float>&) internal bus of the layer
+    * @param firstSample (int64_t) index of the first internal sample of the block since the start
+    * @param numLowRateSamples (int) number of internal samples in the block
+    */
+    static void renderSignal(juce::AudioBuffer<float>& bus, int64_t firstSample, int numLowRateSamples)
+    {
+        float* left = bus.getWritePointer(0);
+        float* right = bus.getWritePointer(1);
+
+        for (int i = 0; i < numLowRateSamples; i++)
+        {
+            int64_t n = firstSample + i;
+            left[i] = (float) std::sin(0.01 * (double) n);
+            right[i] = (float) (n % 1000) * 0.001f;
+        }
+    }
+
+    /**
+    * an impulse comes out of the interpolator after getLatency() internal samples at most,
+    * and no more than one internal sample earlier ( the latency is rounded up )
+    */
+    void checkLatency(int factor)
+    {
+        Interpolator interpolator;
+        interpolator.setFactor(factor);
+
+        const int numInputSamples = 64;
+        float input[numInputSamples] = {};
+        float output[numInputSamples * Interpolator::maxFactor] = {};
+        input[0] = 1.0f;
+
+        interpolator.process(input, output, numInputSamples);
+
+        int peak = 0;
+
+        for (int i = 1; i < numInputSamples * factor; i++)
+        {
+            if (std::abs(output[i]) > std::abs(output[peak]))
+                peak = i;
+        }
+
+        int latency = interpolator.getLatency() * factor;
+
+        expectLessOrEqual(peak, latency, "the impulse came out later than the latency");
+        expectGreaterThan(peak, latency - factor, "the latency is more than one internal sample too long");
+    }
+
+    /**
+    * play the same internal signal once in one block and once in odd blocks,
+    * the interpolated output at the host rate has to be the same sample for sample
+    */
+    void checkLeftoverSamples(int factor)
+    {
+        juce::AudioBuffer<float> reference(2, totalSamples);
+        {
+            MultiRateLayer layer;
+            layer.prepare(totalSamples);
+            layer.setFactor(factor);
+
+            juce::MidiBuffer noEvents;
+            int numLowRateSamples = layer.beginBlock(noEvents, totalSamples);
+            expectEquals(numLowRateSamples, totalSamples / factor);
+
+            renderSignal(layer.getLowRateBus(), 0, numLowRateSamples);
+            layer.endBlock(reference, totalSamples, true);
+        }
+
+        MultiRateLayer layer;
+        layer.prepare(maxBlockSize);
+        layer.setFactor(factor);
+
+        juce::AudioBuffer<float> output(2, maxBlockSize);
+        juce::MidiBuffer noEvents;
+        int64_t lowRatePosition = 0;
+        int numEmptyBlocks = 0;
+        float maxError = 0.0f;
+
+        for (int start = 0, block = 0; start < totalSamples; block++)
+        {
+            int numSamples = juce::jmin(getBlockSize(block), totalSamples - start);
+            int numLowRateSamples = layer.beginBlock(noEvents, numSamples);
+
+            if (numLowRateSamples == 0)
+                numEmptyBlocks++;
+
+            renderSignal(layer.getLowRateBus(), lowRatePosition, numLowRateSamples);
+            layer.endBlock(output, numSamples, true);
+            lowRatePosition += numLowRateSamples;
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                for (int i = 0; i < numSamples; i++)
+                {
+                    float error = std::abs(output.getSample(channel, i) - reference.getSample(channel, start + i));
+                    maxError = juce::jmax(maxError, error);
+                }
+            }
+
+            start += numSamples;
+
+            // the internal samples rendered so far cover the host samples played, with less than one internal sample left over
+            expectGreaterOrEqual(lowRatePosition * factor, (int64_t) start);
+            expectLessThan(lowRatePosition * factor, (int64_t) (start + factor));
+        }
+
+        expectGreaterThan(numEmptyBlocks, 0, "no block was too small to render");
+        expectLessThan(maxError, 1.0e-6f, "the output of odd blocks differs from one block");
+    }
+
+    /**
+    * send a note in every block at changing positions, each one has to come out once, in order,
+    * on the internal sample that covers it - or on the first internal sample rendered after it
+    */
+    void checkEventPositions(int factor)
+    {
+        MultiRateLayer layer;
+        layer.prepare(maxBlockSize);
+        layer.setFactor(factor);
+
+        juce::AudioBuffer<float> output(2, maxBlockSize);
+        juce::MidiBuffer events;
+        std::vector<int64_t> sent;          // host positions of the events not rendered yet, in order
+        int64_t lowRatePosition = 0;
+        int numReceived = 0;
+        int numWrongPositions = 0;
+        int numWaitingWhileIdle = 0;
+
+        int start = 0;
+
+        for (int block = 0; start < totalSamples; block++)
+        {
+            int numSamples = juce::jmin(getBlockSize(block), totalSamples - start);
+
+            events.clear();
+            int offset = (block * 5) % numSamples;
+            events.addEvent(juce::MidiMessage::noteOn(1, 60, 1.0f), offset);
+            sent.push_back(start + offset);
+
+            int numLowRateSamples = layer.beginBlock(events, numSamples);
+
+            if (numLowRateSamples > 0)
+            {
+                for (const auto metadata : layer.getLowRateEvents())
+                {
+                    if (numReceived >= (int) sent.size())
+                    {
+                        numWrongPositions++;
+                        break;
+                    }
+
+                    int64_t hostPosition = sent[(size_t) numReceived++];
+                    int64_t expected = juce::jmax(hostPosition / factor, lowRatePosition);
+
+                    if (lowRatePosition + metadata.samplePosition != expected)
+                        numWrongPositions++;
+                }
+            }
+
+            layer.endBlock(output, numSamples, false);
+            lowRatePosition += numLowRateSamples;
+            start += numSamples;
+
+            // events of a block with no internal samples wait, the layer has to be called again
+            if (numLowRateSamples == 0 && ! layer.isActive())
+                numWaitingWhileIdle++;
+        }
+
+        // one more block for the events still waiting
+        events.clear();
+        int numLowRateSamples = layer.beginBlock(events, maxBlockSize);
+        expectGreaterThan(numLowRateSamples, 0);
+
+        for (const auto metadata : layer.getLowRateEvents())
+        {
+            juce::ignoreUnused(metadata);
+            numReceived++;
+        }
+
+        layer.endBlock(output, maxBlockSize, false);
+
+        expectEquals(numReceived, (int) sent.size(), "events were lost or doubled");
+        expectEquals(numWrongPositions, 0, "events landed on the wrong internal sample");
+        expectEquals(numWaitingWhileIdle, 0, "the layer was idle with events waiting");
+    }
+
+    /**
+    * render a block that ends on an impulse, then keep calling the layer in small blocks until it is no longer active,
+    * nothing but silence may come out after that
+    */
+    void checkTail(int factor)
+    {
+        MultiRateLayer layer;
+        layer.prepare(maxBlockSize);
+        layer.setFactor(factor);
+
+        juce::AudioBuffer<float> output(2, maxBlockSize);
+        juce::MidiBuffer noEvents;
+
+        int numLowRateSamples = layer.beginBlock(noEvents, 64);
+        layer.getLowRateBus().setSample(0, numLowRateSamples - 1, 1.0f);
+        layer.getLowRateBus().setSample(1, numLowRateSamples - 1, 1.0f);
+        layer.endBlock(output, 64, true);
+
+        float peakWhileActive = 0.0f;
+        int numBlocks = 0;
+
+        while (layer.isActive() && numBlocks < 1000)
+        {
+            layer.beginBlock(noEvents, 3);
+            layer.endBlock(output, 3, false);
+            peakWhileActive = juce::jmax(peakWhileActive, output.getMagnitude(0, 3));
+            numBlocks++;
+        }
+
+        expect(! layer.isActive(), "the layer never went idle");
+        expectGreaterThan(peakWhileActive, 0.5f, "the impulse did not come out while the layer was active");
+
+        // what is left in the interpolators once the layer is idle
+        float peakAfter = 0.0f;
+
+        for (int block = 0; block < 64; block++)
+        {
+            layer.beginBlock(noEvents, 3);
+            layer.endBlock(output, 3, false);
+            peakAfter = juce::jmax(peakAfter, output.getMagnitude(0, 3));
+        }
+
+        expectLessThan(peakAfter, 1.0e-6f, "the layer went idle before the end of the tail");
+    }
+};
+
+static MakeSoundMultiRateLayerTests makeSoundMultiRateLayerTests;
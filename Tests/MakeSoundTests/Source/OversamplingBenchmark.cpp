@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    OversamplingBenchmark.cpp
+
+    Contains class MakeSoundOversamplingBenchmark
+
+    Renders the same fm pad chords through MakeSoundAudioProcessor with the fm
+    layer at 1x, 2x and 4x and logs the render time of each factor and its
+    cpu cost relative to 1x. Every factor is rendered a few times and the
+    fastest render is kept, so one slow run does not skew the multipliers
+
+    Requires "RenderHarness.h" for the scenario and the render loop
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+#include "../../../MakeSound/Source/PluginProcessor.h"
+
+/**
+* cpu cost of the oversampling of the fm layer
+*/
+class MakeSoundOversamplingBenchmark : public juce::UnitTest
+{
+public:
+    MakeSoundOversamplingBenchmark() : juce::UnitTest("MakeSound fm oversampling benchmark", "MakeSound") {}
+
+    void runTest() override
+    {
+        beginTest("fm layer at 1x, 2x and 4x");
+
+        // every fm note at once, the layer is the only one playing
+        RenderHarness::Scenario fmPads("fmOversampling", 10.0);
+
+        for (int note = 36; note < 48; note++)
+        {
+            fmPads.note(0.0, 8.0, note, 0.8f);
+        }
+
+        const char* factorNames[] = { "1x", "2x", "4x" };
+        double baseSeconds = 0.0;
+
+        for (int factor = 0; factor < 3; factor++)
+        {
+            RenderHarness::Scenario scenario = fmPads;
+            scenario.parameter("liveOversampling", (float) factor);
+            double bestSeconds = 0.0;
+
+            for (int run = 0; run < numRuns; run++)
+            {
+                MakeSoundAudioProcessor processor;
+                processor.setRandomSeed(RenderHarness::randomSeed);
+                auto result = RenderHarness::render(processor, scenario);
+
+                expect(result.audio.getMagnitude(0, result.audio.getNumSamples()) > 0.0001f, juce::String(factorNames[factor]) + " renders silence");
+
+                if (run == 0 || result.cpuSeconds < bestSeconds)
+                    bestSeconds = result.cpuSeconds;
+            }
+
+            if (factor == 0)
+                baseSeconds = bestSeconds;
+
+            logMessage(juce::String(factorNames[factor]) + ": " + juce::String(bestSeconds * 1000.0, 1) + " ms for "
+                       + juce::String(scenario.seconds, 1) + " s, " + juce::String(scenario.seconds / juce::jmax(1.0e-9, bestSeconds), 1)
+                       + "x realtime, " + juce::String(bestSeconds / juce::jmax(1.0e-9, baseSeconds), 2) + "x the cpu of 1x");
+        }
+    }
+
+private:
+    static constexpr int numRuns = 3;
+};
+
+static MakeSoundOversamplingBenchmark makeSoundOversamplingBenchmark;
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    PhaseSoakTests.cpp
+
+    Contains class MakeSoundPhaseSoakTests
+
+    Runs the ramps and the fixed point phase accumulators of Oscillator.h for
+    hours of samples. A float accumulator stalls or drifts long before that
+    ( a float sample counter stops at 2^24 samples, about 349 s at 48 kHz ),
+    so every check is made at the end of the soak as well as along the way
+
+    Requires "Oscillator.h" for LinearIncrease and the oscillators
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../MakeSound/Source/Oscillator.h"
+
+/**
+* long runs of LinearIncrease and the fixed point phases
+*/
+class MakeSoundPhaseSoakTests : public juce::UnitTest
+{
+public:
+    MakeSoundPhaseSoakTests() : juce::UnitTest("MakeSound phase soak", "MakeSound") {}
+
+    void runTest() override
+    {
+        beginTest("LinearIncrease resets on time for hours");
+        soakRamp();
+
+        beginTest("fixed point phases keep their rate for hours");
+        soakPhasor(0.0017f);    // one cycle every ten minutes
+        soakPhasor(440.0f);
+    }
+
+private:
+    static constexpr float sampleRate = 48000.0f;
+    static constexpr int64_t soakSamples = (int64_t) 4 * 3600 * 48000;  // 4 hours
+    static constexpr int blockSize = 512;
+    static_assert(soakSamples % blockSize == 0, "the phasor soak checks whole blocks");
+
+    /**
+    * run a 360 s ramp for the whole soak, block by block and sample by sample, and check
+    * that both give the same output, that every ramp ends at the same value and resets to 0
+    */
+    void soakRamp()
+    {
+        const double durationInSeconds = 360.0;
+        const int64_t durationInSamples = (int64_t) (durationInSeconds * sampleRate);
+        const float endPoint = (float) ((durationInSamples - 1) / (double) durationInSamples);
+
+        LinearIncrease blockRamp, sampleRamp;
+        blockRamp.setSampleRate(sampleRate);
+        blockRamp.setDuration(durationInSeconds);
+        sampleRamp.setSampleRate(sampleRate);
+        sampleRamp.setDuration(durationInSeconds);
+
+        float block[blockSize];
+        float previous = -1.0f;
+        int64_t lastReset = 0;
+        int numResets = 0;
+        int numMismatches = 0;
+        int numBadResets = 0;
+
+        for (int64_t start = 0; start < soakSamples; start += blockSize)
+        {
+            int numSamples = (int) juce::jmin((int64_t) blockSize, soakSamples - start);
+            blockRamp.process(block, numSamples);
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                if (sampleRamp.process() != block[i])
+                    numMismatches++;
+
+                // the ramp went back to the start, the ramp before it must have run its whole length
+                if (block[i] < previous)
+                {
+                    numResets++;
+
+                    if (block[i] != 0.0f || previous != endPoint || start + i - lastReset != durationInSamples)
+                        numBadResets++;
+
+                    lastReset = start + i;
+                }
+
+                previous = block[i];
+            }
+        }
+
+        expectEquals(numMismatches, 0, "LinearIncrease::process() and the block process differ");
+        expectEquals(numBadResets, 0, "a ramp reset early, late or not from its end point");
+        expectEquals(numResets, (int) (soakSamples / durationInSamples) - 1, "the ramp stopped resetting");
+        expectEquals(previous, endPoint, "the last ramp of the soak did not reach its end point");
+    }
+
+    /**
+    * run a phasor for the whole soak and compare its phase with the exact phase of its frequency,
+    * the error may only grow by the rounding of the phase increment ( half a step of the fixed point phase per sample )
+    *
+    * @param frequency (float) frequency of the phasor in Hz
+    */
+    void soakPhasor(float frequency)
+    {
+        Oscillator phasor;
+        phasor.setSampleRate(sampleRate);
+        phasor.setFrequency(frequency);
+
+        const double cyclesPerSample = (double) frequency / sampleRate;
+        const double incrementRounding = 0.5 / 4294967296.0;    // cycles per sample
+        const double outputRounding = 1.0e-7;                   // the phase is output as a float
+        double maxError = 0.0;
+        double maxAllowedError = 0.0;
+        int numBadSamples = 0;
+        float block[blockSize];
+
+        for (int64_t start = 0; start < soakSamples; start += blockSize)
+        {
+            phasor.process(block, blockSize);
+
+            // phase of the last sample of the block, process() moves the phase before it outputs it
+            int64_t n = start + blockSize;
+            double exact = (double) n * cyclesPerSample;
+            exact -= std::floor(exact);
+            double error = std::abs(block[blockSize - 1] - exact);
+            error = juce::jmin(error, 1.0 - error);     // either side of the wrap
+            double allowedError = n * incrementRounding + outputRounding;
+
+            if (error > allowedError)
+                numBadSamples++;
+
+            maxError = juce::jmax(maxError, error);
+            maxAllowedError = allowedError;
+        }
+
+        logMessage(juce::String(frequency, 4) + " Hz: largest phase error " + juce::String(maxError, 9)
+                   + " cycles, bound after the soak " + juce::String(maxAllowedError, 9) + " cycles");
+        expectEquals(numBadSamples, 0, juce::String(frequency, 4) + " Hz phasor drifted further than its increment rounding");
+    }
+};
+
+static MakeSoundPhaseSoakTests makeSoundPhaseSoakTests;
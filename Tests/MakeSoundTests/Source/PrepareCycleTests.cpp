@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    PrepareCycleTests.cpp
+
+    Contains class MakeSoundPrepareCycleTests
+
+    Prepares one MakeSoundAudioProcessor again and again at 44.1, 48, 96 and
+    192 kHz, playing a note on every layer after each prepare, and checks
+    that nothing leaks or grows when re-preparing. The arena and the reverb
+    keep the memory of the highest rate ( they report their capacity ), so the
+    first pass through the rates only reaches the high-water mark. The memory
+    at every rate in the second pass is the baseline, and every later pass
+    has to match it
+
+    Requires "RenderHarness.h" for the block size and the seed
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Shared/RenderHarness.h"
+#include "../../../MakeSound/Source/PluginProcessor.h"
+
+/**
+* memory of MakeSound over repeated prepareToPlay() calls
+*/
+class MakeSoundPrepareCycleTests : public juce::UnitTest
+{
+public:
+    MakeSoundPrepareCycleTests() : juce::UnitTest("MakeSound prepare cycles", "MakeSound") {}
+
+    void runTest() override
+    {
+        beginTest("re-preparing keeps the dsp memory");
+        cyclePrepare(false, 1000);
+
+        // every allocation of the note cache fills its slots ( 64 MB ), so it gets fewer cycles
+        beginTest("re-preparing keeps the dsp memory with the note cache");
+        cyclePrepare(true, 20);
+    }
+
+private:
+    /**
+    * prepare a processor at every sample rate in turn and compare its memory with the second cycle
+    *
+    * @param noteCache (bool) use the note cache of the pulse layer
+    * @param numCycles (int) number of times to go through the sample rates
+    */
+    void cyclePrepare(bool noteCache, int numCycles)
+    {
+        const double sampleRates[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+        size_t baseline[4] = {};    // memory at every rate once the high-water mark is reached
+
+        MakeSoundAudioProcessor processor;
+        processor.setRandomSeed(RenderHarness::randomSeed);
+        RenderHarness::setParameter(processor, "noteCache", noteCache ? 1.0f : 0.0f);
+
+        juce::AudioBuffer<float> block(2, RenderHarness::blockSize);
+        juce::MidiBuffer midi;
+        int numChanged = 0;
+
+        for (int cycle = 0; cycle < numCycles; cycle++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                processor.setPlayConfigDetails(0, 2, sampleRates[i], RenderHarness::blockSize);
+                processor.prepareToPlay(sampleRates[i], RenderHarness::blockSize);
+
+                // one note on every layer of the keyboard split, so the voices run at the new rate
+                midi.clear();
+                midi.addEvent(juce::MidiMessage::noteOn(1, 30, 0.8f), 0);
+                midi.addEvent(juce::MidiMessage::noteOn(1, 40, 0.8f), 0);
+                midi.addEvent(juce::MidiMessage::noteOn(1, 60, 0.8f), 0);
+                block.clear();
+                processor.processBlock(block, midi);
+
+                size_t bytes = processor.getDspMemoryBytes();
+
+                if (cycle == 1)
+                {
+                    baseline[i] = bytes;
+                    logMessage(juce::String(sampleRates[i] * 0.001, 1) + " kHz: " + juce::String((juce::int64) bytes) + " bytes");
+                }
+                else if (cycle > 1 && bytes != baseline[i])
+                {
+                    if (numChanged == 0)
+                        logMessage("cycle " + juce::String(cycle) + " at " + juce::String(sampleRates[i] * 0.001, 1) + " kHz: "
+                                   + juce::String((juce::int64) bytes) + " bytes, baseline " + juce::String((juce::int64) baseline[i]));
+
+                    numChanged++;
+                }
+            }
+        }
+
+        processor.releaseResources();
+        expectEquals(numChanged, 0, "the dsp memory changed after the second cycle of sample rates");
+    }
+};
+
+static MakeSoundPrepareCycleTests makeSoundPrepareCycleTests;
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    StepSequencerTests.cpp
+
+    Contains class MakeSoundStepSequencerTests
+
+    Checks the timing of StepSequencer: the step boundaries it announces are
+    the sample offsets where the steps really start ( also when the length of
+    a step is not a whole number of samples ), the step length it picks when
+    it follows the host tempo, and the slowest rate it allows
+
+    Requires "StepSequencer.h"
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../MakeSound/Source/StepSequencer.h"
+
+/**
+* step boundaries, tempo sync and the minimum rate of StepSequencer
+*/
+class MakeSoundStepSequencerTests : public juce::UnitTest
+{
+public:
+    MakeSoundStepSequencerTests() : juce::UnitTest("MakeSound step sequencer", "MakeSound") {}
+
+    void runTest() override
+    {
+        beginTest("step boundaries are sample offsets");
+        checkBoundaries(3.0);           // 16000 samples per step
+        checkBoundaries(7.0);           // 6857.14... samples per step
+        checkBoundaries(1000.0 / 3.0);  // 144 samples per step, the rate is not exact in a double
+
+        beginTest("the position inside a step is kept when the rate changes");
+        checkRateChange();
+
+        beginTest("tempo sync");
+        checkTempo();
+
+        beginTest("minimum rate");
+        checkMinimumRate();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int numSteps = 20000;
+
+    /**
+    * move through many steps in chunks of random length, never further than the next boundary,
+    * and check that every step starts on the first sample at or after k * stepLength
+    *
+    * @param stepsPerSecond (double) rate of the steps
+    */
+    void checkBoundaries(double stepsPerSecond)
+    {
+        StepSequencer sequencer;
+        sequencer.setSampleRate(sampleRate);
+        sequencer.setRate(stepsPerSecond);
+        sequencer.reset();
+
+        const double stepLength = sampleRate / stepsPerSecond;
+        juce::Random random(getRandom().nextInt64());
+
+        int64_t samplePosition = 0;
+        int step = 0;
+        int numEarly = 0;
+        int numLate = 0;
+        int numWrongOffsets = 0;
+
+        while (step < numSteps)
+        {
+            int toNextStep = sequencer.getSamplesToNextStep();
+            int chunk = 1 + random.nextInt(toNextStep);
+            bool newStep = sequencer.advance(chunk);
+            samplePosition += chunk;
+
+            // the boundary was announced as a sample offset, the step must start exactly there
+            if (newStep != (chunk == toNextStep))
+                numWrongOffsets++;
+
+            if (newStep)
+            {
+                step++;
+
+                // within one sample of the exact boundary, and the error does not grow with the steps
+                double boundary = step * stepLength;
+
+                if ((double) samplePosition < boundary - 1.0e-6)
+                    numEarly++;
+
+                if ((double) samplePosition >= boundary + 1.0 + 1.0e-6)
+                    numLate++;
+            }
+        }
+
+        expectEquals(numWrongOffsets, 0, "a step started before or after the announced offset");
+        expectEquals(numEarly, 0, "a step started before its boundary");
+        expectEquals(numLate, 0, "a step started more than a sample after its boundary");
+    }
+
+    /**
+    * a quarter of the way into a step, a rate twice as slow leaves the phase where it is
+    */
+    void checkRateChange()
+    {
+        StepSequencer sequencer;
+        sequencer.setSampleRate(sampleRate);
+        sequencer.setRate(2.0);    // 24000 samples per step
+        sequencer.reset();
+
+        expect(! sequencer.advance(6000));
+        expectWithinAbsoluteError(sequencer.getStepPhase(), 0.25, 1.0e-12);
+
+        sequencer.setRate(1.0);    // 48000 samples per step
+
+        expectWithinAbsoluteError(sequencer.getStepPhase(), 0.25, 1.0e-12);
+        expectEquals(sequencer.getSamplesToNextStep(), 36000);
+        expectWithinAbsoluteError(sequencer.getPhaseIncrement(), 1.0 / 48000.0, 1.0e-15);
+    }
+
+    /**
+    * a step lasts the power of two number of beats closest to the free rate,
+    * and the host beat position sets the position inside the step
+    */
+    void checkTempo()
+    {
+        StepSequencer sequencer;
+        sequencer.setSampleRate(sampleRate);
+
+        // 120 bpm is 2 beats per second
+        sequencer.setTempo(120.0, 2.0);    // 1 beat per step
+        sequencer.reset();
+        expectEquals(sequencer.getSamplesToNextStep(), 24000);
+
+        sequencer.setTempo(120.0, 3.0);    // 2/3 beat rounds to 1/2 beat
+        sequencer.reset();
+        expectEquals(sequencer.getSamplesToNextStep(), 12000);
+
+        sequencer.setTempo(120.0, 0.3);    // 6.7 beats round to 8 beats
+        sequencer.reset();
+        expectEquals(sequencer.getSamplesToNextStep(), 192000);
+
+        sequencer.setTempo(90.0, 1.5);     // 1 beat at 90 bpm
+        sequencer.reset();
+        expectEquals(sequencer.getSamplesToNextStep(), 32000);
+
+        // a quarter beat into the third beat
+        sequencer.setTempo(120.0, 2.0);
+        sequencer.setBeatPosition(2.25);
+        expectWithinAbsoluteError(sequencer.getStepPhase(), 0.25, 1.0e-12);
+        expectEquals(sequencer.getSamplesToNextStep(), 18000);
+
+        // half beat steps, 2.375 beats is 3/4 of the fifth step
+        sequencer.setTempo(120.0, 4.0);
+        sequencer.setBeatPosition(2.375);
+        expectWithinAbsoluteError(sequencer.getStepPhase(), 0.75, 1.0e-12);
+        expectEquals(sequencer.getSamplesToNextStep(), 3000);
+
+        // the next step starts on the half beat
+        expect(sequencer.advance(3000));
+        expectWithinAbsoluteError(sequencer.getStepPhase(), 0.0, 1.0e-12);
+    }
+
+    /**
+    * rates below 0.01 steps per second ( and 0 ) are held at 0.01, a step every 100 seconds
+    */
+    void checkMinimumRate()
+    {
+        const int slowestStep = (int) (100.0 * sampleRate);
+
+        StepSequencer sequencer;
+        sequencer.setSampleRate(sampleRate);
+
+        for (auto rate : { 0.01, 0.001, 0.0, -5.0 })
+        {
+            sequencer.setRate(rate);
+            sequencer.reset();
+            expectEquals(sequencer.getSamplesToNextStep(), slowestStep);
+        }
+
+        // following the host tempo, 200 beats per step at 120 bpm round to 256 beats
+        sequencer.setTempo(120.0, 0.0);
+        sequencer.reset();
+        expectEquals(sequencer.getSamplesToNextStep(), 256 * 24000);
+    }
+};
+
+static MakeSoundStepSequencerTests makeSoundStepSequencerTests;
@@ -0,0 +1,447 @@
+/*
+  ==============================================================================
+
+    RenderHarness.h
+
+    Contains namespace RenderHarness and class GoldenFile
+
+    Golden-render regression harness shared by the test targets of the plugins.
+    A scenario is a fixed list of midi events ( and parameter values ) that is
+    rendered offline through a plugin processor. The rendered audio is reduced
+    to a hash and the speed of the render to a realtime factor ( seconds of
+    audio rendered per second of cpu time ), and both are compared with the
+    values recorded in the golden file of the target
+
+    The golden file is a text file with one line per scenario:
+        <scenario name> <hash of the output> <realtime factor>
+    Running the test target with --record renders every scenario and writes the
+    measured values instead of comparing them ( after a change of the sound
+    that is intended, or on a new build machine ). With --no-timing as well,
+    only the hashes are written and the realtime factors already in the file
+    are kept, for a machine whose speed is not the reference. A scenario whose
+    realtime factor is "-" has no baseline, its speed is logged but not checked
+
+    Every scenario is rendered twice, by two new processors, and both renders
+    have to give the same hash, so a render that depends on anything but its
+    scenario and the seed fails before it is compared with the golden file
+
+    The output is quantised to 16 bits before it is hashed, so the hash does not
+    depend on the last bits of the floating point maths
+
+    Requires <JuceHeader.h> for AudioProcessor, MidiBuffer and UnitTest
+    Requires <map> and <vector> for the golden values and the scenarios
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <iostream>
+#include <map>
+#include <vector>
+
+/**
+* golden values of the scenarios of a test target, read from and written to a text file
+*
+* @param file (const juce::File&) golden file of the test target
+* @param name (const juce::String&) name of the scenario
+* @param hash (juce::String) hash of the rendered output ( hexadecimal )
+* @param realtimeFactor (double) seconds of audio rendered per second of cpu time
+*/
+class GoldenFile
+{
+public:
+    struct Entry
+    {
+        juce::String hash;
+        double realtimeFactor = 0.0;    // 0 if there is no baseline
+    };
+
+    /**
+    * read the golden values, lines starting with # are comments, the realtime factor may be left out or "-"
+    *
+    * @param _file (const juce::File&) golden file of the test target
+    */
+    void load(const juce::File& _file)
+    {
+        file = _file;
+        entries.clear();
+        juce::StringArray lines;
+        lines.addLines(file.loadFileAsString());
+
+        for (auto& line : lines)
+        {
+            auto tokens = juce::StringArray::fromTokens(line.trim(), true);
+
+            if (tokens.size() < 2 || tokens[0].startsWith("#"))
+                continue;
+
+            entries[tokens[0]] = { tokens[1], tokens.size() > 2 ? tokens[2].getDoubleValue() : 0.0 };   // "-" reads as 0
+        }
+    }
+
+    /**
+    * write the golden values back to the file, sorted by scenario name
+    */
+    bool save() const
+    {
+        juce::String text = "# golden renders: <scenario> <hash of the output> <realtime factor>\n"
+                            "# written by running the test target with --record, a realtime factor of - has no baseline\n";
+
+        for (auto& entry : entries)
+        {
+            juce::String realtimeFactor = entry.second.realtimeFactor > 0.0 ? juce::String(entry.second.realtimeFactor, 1) : juce::String("-");
+            text << entry.first << " " << entry.second.hash << " " << realtimeFactor << "\n";
+        }
+
+        return file.replaceWithText(text);
+    }
+
+    /**
+    * returns the golden values of a scenario, nullptr if it has not been recorded
+    *
+    * @param name (const juce::String&) name of the scenario
+    */
+    const Entry* find(const juce::String& name) const
+    {
+        auto found = entries.find(name);
+        return found != entries.end() ? &found->second : nullptr;
+    }
+
+    /**
+    * record the values of a scenario
+    *
+    * @param name (const juce::String&) name of the scenario
+    * @param entry (const Entry&) hash and realtime factor
+    */
+    void set(const juce::String& name, const Entry& entry)
+    {
+        entries[name] = entry;
+    }
+
+private:
+    juce::File file;
+    std::map<juce::String, Entry> entries;
+};
+
+namespace RenderHarness
+{
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+    static constexpr juce::uint64 randomSeed = 0x4d616b65536f756eULL;  // fixed seed of every render
+    static constexpr double realtimeTolerance = 0.75;  // a render may be 25% slower than the baseline before it fails ( timing noise )
+
+    /**
+    * options of the test run, set by main()
+    */
+    struct Settings
+    {
+        bool record = false;    // write the golden values instead of comparing them
+        bool recordTiming = true;   // write the realtime factors as well as the hashes
+        GoldenFile golden;
+    };
+
+    inline Settings& getSettings()
+    {
+        static Settings settings;
+        return settings;
+    }
+
+    /**
+    * a fixed midi sequence and the parameter values it is rendered with
+    */
+    struct Scenario
+    {
+        /**
+        * @param _name (const juce::String&) name of the scenario, one word ( key of the golden file )
+        * @param _seconds (double) length of the render in seconds
+        */
+        Scenario(const juce::String& _name, double _seconds) : name(_name), seconds(_seconds) {}
+
+        juce::String name;
+        double seconds = 0.0;
+        std::vector<std::pair<double, juce::MidiMessage>> events;   // time in seconds and message
+        std::vector<std::pair<juce::String, float>> parameters;     // parameter id and value ( not normalised )
+
+        /**
+        * add a note
+        *
+        * @param start (double) start of the note in seconds
+        * @param length (double) length of the note in seconds
+        * @param note (int) midi note number
+        * @param velocity (float) 0 - 1
+        */
+        Scenario& note(double start, double length, int note, float velocity)
+        {
+            events.push_back({ start, juce::MidiMessage::noteOn(1, note, velocity) });
+            events.push_back({ start + length, juce::MidiMessage::noteOff(1, note) });
+            return *this;
+        }
+
+        /**
+        * add a controller sweep from one value to another, one event every 10 ms
+        *
+        * @param start (double) start of the sweep in seconds
+        * @param length (double) length of the sweep in seconds
+        * @param controller (int) midi controller number
+        * @param from (int) first value (0 - 127)
+        * @param to (int) last value (0 - 127)
+        */
+        Scenario& sweep(double start, double length, int controller, int from, int to)
+        {
+            int numSteps = juce::jmax(1, (int) (length * 100.0));
+
+            for (int step = 0; step <= numSteps; step++)
+            {
+                int value = from + juce::roundToInt((to - from) * step / (double) numSteps);
+                events.push_back({ start + length * step / numSteps, juce::MidiMessage::controllerEvent(1, controller, value) });
+            }
+
+            return *this;
+        }
+
+        /**
+        * set a parameter before the render
+        *
+        * @param id (const juce::String&) parameter id
+        * @param value (float) value in the range of the parameter
+        */
+        Scenario& parameter(const juce::String& id, float value)
+        {
+            parameters.push_back({ id, value });
+            return *this;
+        }
+    };
+
+    /**
+    * result of a render
+    */
+    struct Render
+    {
+        juce::AudioBuffer<float> audio;
+        double rate = sampleRate;
+        double cpuSeconds = 0.0;
+
+        double getRealtimeFactor() const
+        {
+            return audio.getNumSamples() / rate / juce::jmax(1.0e-9, cpuSeconds);
+        }
+    };
+
+    /**
+    * set a parameter of a processor by id
+    *
+    * @param processor (juce::AudioProcessor&) processor of the plugin
+    * @param id (const juce::String&) parameter id
+    * @param value (float) value in the range of the parameter
+    */
+    inline bool setParameter(juce::AudioProcessor& processor, const juce::String& id, float value)
+    {
+        for (auto* p : processor.getParameters())
+        {
+            if (auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(p))
+            {
+                if (parameter->paramID == id)
+                {
+                    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+    * render a scenario through a processor, block by block as a host would
+    *
+    * @param processor (juce::AudioProcessor&) processor of the plugin, new or released
+    * @param scenario (const Scenario&) midi and parameters
+    * @param rate (double) sample rate in Hz
+    */
+    inline Render render(juce::AudioProcessor& processor, const Scenario& scenario, double rate = sampleRate)
+    {
+        for (auto& parameter : scenario.parameters)
+        {
+            if (! setParameter(processor, parameter.first, parameter.second))
+                jassertfalse;   // unknown parameter id in the scenario
+        }
+
+        processor.setNonRealtime(false);
+        processor.setPlayConfigDetails(0, 2, rate, blockSize);
+        processor.prepareToPlay(rate, blockSize);
+
+        Render result;
+        result.rate = rate;
+        int totalSamples = (int) (scenario.seconds * rate);
+        result.audio.setSize(2, totalSamples);
+
+        juce::AudioBuffer<float> block(2, blockSize);
+        juce::MidiBuffer midi;
+        double startTime = juce::Time::getMillisecondCounterHiRes();
+
+        for (int start = 0; start < totalSamples; start += blockSize)
+        {
+            int numSamples = juce::jmin(blockSize, totalSamples - start);
+            midi.clear();
+
+            for (auto& event : scenario.events)
+            {
+                int position = (int) (event.first * rate) - start;
+
+                if (position >= 0 && position < numSamples)
+                    midi.addEvent(event.second, position);
+            }
+
+            block.setSize(2, numSamples, false, false, true);
+            block.clear();
+            processor.processBlock(block, midi);
+
+            for (int chan = 0; chan < 2; chan++)
+            {
+                result.audio.copyFrom(chan, start, block, chan, 0, numSamples);
+            }
+        }
+
+        result.cpuSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        processor.releaseResources();
+        return result;
+    }
+
+    /**
+    * returns the hash of the audio quantised to 16 bits ( 64 bit fnv-1a, hexadecimal )
+    *
+    * @param audio (const juce::AudioBuffer<float>&) rendered audio
+    */
+    inline juce::String hashAudio(const juce::AudioBuffer<float>& audio)
+    {
+        juce::uint64 hash = 0xcbf29ce484222325ULL;
+
+        for (int chan = 0; chan < audio.getNumChannels(); chan++)
+        {
+            const float* samples = audio.getReadPointer(chan);
+
+            for (int i = 0; i < audio.getNumSamples(); i++)
+            {
+                auto quantised = (juce::uint16) (juce::int16) juce::jlimit(-32768, 32767, juce::roundToInt(samples[i] * 32767.0f));
+                hash = (hash ^ (quantised & 0xff)) * 0x100000001b3ULL;
+                hash = (hash ^ (quantised >> 8)) * 0x100000001b3ULL;
+            }
+        }
+
+        return juce::String::toHexString((juce::int64) hash);
+    }
+
+    /**
+    * render a scenario twice and compare it with the golden file ( or record it with --record )
+    *
+    * @param test (juce::UnitTest&) test that reports the results
+    * @param createProcessor (CreateProcessor) returns a new processor of the plugin ( std::unique_ptr ), set up with the fixed seed
+    * @param scenario (const Scenario&) midi and parameters
+    */
+    template <typename CreateProcessor>
+    void checkScenario(juce::UnitTest& test, CreateProcessor createProcessor, const Scenario& scenario)
+    {
+        auto result = render(*createProcessor(), scenario);
+        auto repeat = render(*createProcessor(), scenario);
+        GoldenFile::Entry measured { hashAudio(result.audio), juce::jmax(result.getRealtimeFactor(), repeat.getRealtimeFactor()) };
+        auto& settings = getSettings();
+
+        test.logMessage(scenario.name + ": hash " + measured.hash + ", realtime factor " + juce::String(measured.realtimeFactor, 1));
+        test.expect(result.audio.getMagnitude(0, result.audio.getNumSamples()) > 0.0001f, scenario.name + " renders silence");
+        test.expectEquals(hashAudio(repeat.audio), measured.hash, scenario.name + " sounds different when it is rendered again");
+
+        auto* golden = settings.golden.find(scenario.name);
+
+        if (settings.record)
+        {
+            if (! settings.recordTiming)
+                measured.realtimeFactor = golden != nullptr ? golden->realtimeFactor : 0.0;
+
+            settings.golden.set(scenario.name, measured);
+            return;
+        }
+
+        if (golden == nullptr)
+        {
+            test.expect(false, scenario.name + " has no golden render, run the test target with --record");
+            return;
+        }
+
+        test.expectEquals(measured.hash, golden->hash, scenario.name + " sounds different from its golden render");
+
+        if (golden->realtimeFactor <= 0.0)
+        {
+            test.logMessage(scenario.name + " has no realtime baseline, its speed is not checked");
+            return;
+        }
+
+        test.expect(measured.realtimeFactor >= golden->realtimeFactor * realtimeTolerance,
+                    scenario.name + " renders at " + juce::String(measured.realtimeFactor, 1) + "x realtime, the baseline is "
+                    + juce::String(golden->realtimeFactor, 1) + "x");
+    }
+
+    /**
+    * returns the file next to the project file of the test target, found by walking up from the executable
+    *
+    * @param projectFileName (const juce::String&) name of the .jucer file of the test target
+    * @param fileName (const juce::String&) name of the file next to it
+    */
+    inline juce::File findProjectFile(const juce::String& projectFileName, const juce::String& fileName)
+    {
+        auto dir = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getParentDirectory();
+
+        while (! dir.isRoot())
+        {
+            if (dir.getChildFile(projectFileName).existsAsFile())
+                return dir.getChildFile(fileName);
+
+            dir = dir.getParentDirectory();
+        }
+
+        return juce::File::getCurrentWorkingDirectory().getChildFile(fileName);
+    }
+
+    /**
+    * run the tests of a category with a fixed seed and report the result, the body of main() of a test target
+    *
+    * @param argc (int) arguments of main()
+    * @param argv (char*[]) arguments of main(), --record writes the golden file ( only the hashes with --no-timing ),
+    *        --golden <file> uses another golden file
+    * @param category (const juce::String&) category of the tests to run
+    * @param projectFileName (const juce::String&) name of the .jucer file of the test target
+    * @return 0 if every test passed, 1 otherwise
+    */
+    inline int runTests(int argc, char* argv[], const juce::String& category, const juce::String& projectFileName)
+    {
+        juce::ArgumentList args(argc, argv);
+        auto& settings = getSettings();
+        settings.record = args.containsOption("--record");
+        settings.recordTiming = ! args.containsOption("--no-timing");
+
+        auto goldenFile = args.containsOption("--golden") ? juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--golden"))
+                                                          : findProjectFile(projectFileName, "Golden.txt");
+        settings.golden.load(goldenFile);
+
+        juce::UnitTestRunner runner;
+        runner.setAssertOnFailure(false);
+        runner.runTestsInCategory(category, (juce::int64) randomSeed);
+
+        int failures = 0;
+
+        for (int i = 0; i < runner.getNumResults(); i++)
+        {
+            failures += runner.getResult(i)->failures;
+        }
+
+        if (settings.record)
+        {
+            if (! settings.golden.save())
+                return 1;
+
+            std::cout << "golden renders written to " << goldenFile.getFullPathName() << std::endl;
+        }
+
+        return failures > 0 ? 1 : 0;
+    }
+}